@@ -1,15 +0,0 @@
-#version 410 core
-
-layout (location = 0) in vec3 position;
-layout (location = 1) in vec3 normal;
-layout (location = 2) in vec3 tangent;
-layout (location = 3) in vec2 texCoords;
-
-uniform mat4 u_transform;
-uniform mat4 u_projection;
-uniform mat4 u_view;
-
-void main() {
-    vec4 objPosition = u_transform * vec4(position, 1.0);
-    gl_Position = u_projection * u_view * objPosition;
-}
@@ -1,14 +1,17 @@
 #version 410 core
+
+#ifdef HAS_TEXTURE
 in vec2 textureCoords;
+uniform sampler2D texture_diffuse;
+#endif
 
 out vec4 color;
 
 uniform vec3 u_objectColor;
 
-uniform sampler2D texture_diffuse;
-
 void main() {
-    vec4 textureColor = texture(texture_diffuse, textureCoords);
-    
-    color = vec4(u_objectColor, 1.0f) * textureColor;
+    color = vec4(u_objectColor, 1.0f);
+#ifdef HAS_TEXTURE
+    color *= texture(texture_diffuse, textureCoords);
+#endif
 }
@@ -1,18 +1,50 @@
 #version 410 core
+// Unlit family, variant defines: HAS_TEXTURE, INSTANCING, SKINNING (inserted by ShaderFamily)
+
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec3 tangent;
 layout (location = 3) in vec2 texCoords;
+#ifdef INSTANCING
+layout (location = INSTANCE_LOCATION0) in vec4 i_transformRow0;
+layout (location = INSTANCE_LOCATION1) in vec4 i_transformRow1;
+layout (location = INSTANCE_LOCATION2) in vec4 i_transformRow2;
+#endif
+#ifdef SKINNING
+layout (location = BONE_INDEX_LOCATION) in vec4 boneIndices;
+layout (location = BONE_WEIGHT_LOCATION) in vec4 boneWeights;
+uniform mat4 u_bones[MAX_BONES];
+#endif
 
+#ifdef HAS_TEXTURE
 out vec2 textureCoords;
+uniform vec4 u_diffuseTransform;    // atlas page: uv scale (xy) and offset (zw)
+#endif
 
 uniform mat4 u_transform;
 uniform mat4 u_projection;
 uniform mat4 u_view;
+uniform vec3 u_positionOffset;
+uniform vec3 u_positionScale;
+
+mat4 modelTransform() {
+#ifdef INSTANCING
+    return transpose(mat4(i_transformRow0, i_transformRow1, i_transformRow2, vec4(0.0, 0.0, 0.0, 1.0)));
+#else
+    return u_transform;
+#endif
+}
 
 void main() {
-    vec4 objPosition = u_transform * vec4(position, 1.0);
-    gl_Position = u_projection * u_view * objPosition;
+    vec4 localPosition = vec4(position * u_positionScale + u_positionOffset, 1.0);
+#ifdef SKINNING
+    mat4 skin = boneWeights.x * u_bones[int(boneIndices.x)] + boneWeights.y * u_bones[int(boneIndices.y)]
+              + boneWeights.z * u_bones[int(boneIndices.z)] + boneWeights.w * u_bones[int(boneIndices.w)];
+    localPosition = skin * localPosition;
+#endif
+    gl_Position = u_projection * u_view * modelTransform() * localPosition;
 
-    textureCoords = texCoords;
+#ifdef HAS_TEXTURE
+    textureCoords = texCoords * u_diffuseTransform.xy + u_diffuseTransform.zw;
+#endif
 }
@@ -1,40 +1,63 @@
 #version 410 core
 
+#if LIGHT_COUNT > 0
+#define LIGHT_ARRAY LIGHT_COUNT
+#else
+#define LIGHT_ARRAY 1
+#endif
+
+#ifdef HAS_NORMAL_MAP
 in vec2 textureCoords;
 in mat3 tbnMatrix;
-in vec3 toLightVector[4];
+uniform sampler2D normal_MAP;
+#else
+in vec3 surfaceNormal;
+#endif
+#ifdef HAS_TEXTURE
+in vec2 diffuseCoords;
+uniform sampler2D texture_diffuse;
+#endif
+in vec3 toLightVector[LIGHT_ARRAY];
 in vec3 toCameraVector;
 
 out vec4 outColor;
 
 uniform vec3 u_objectColor;
-uniform vec3 u_lightColor[4];
-uniform float u_intensity[4];
-uniform vec3 u_attenuation[4];
+uniform vec3 u_lightColor[LIGHT_ARRAY];
+uniform float u_intensity[LIGHT_ARRAY];
+uniform vec3 u_attenuation[LIGHT_ARRAY];
 
 uniform float u_spectralReflectivity;
 uniform float u_shineDamper;
 
-uniform sampler2D texture_diffuse;
-uniform sampler2D normal_MAP;
-
 
 void main() {
-    vec4 textureColor = texture(texture_diffuse, textureCoords);
+#ifdef HAS_TEXTURE
+    vec4 textureColor = texture(texture_diffuse, diffuseCoords);
+#else
+    vec4 textureColor = vec4(1.0f);
+#endif
+#ifdef HAS_NORMAL_MAP
+    // Normal map normals (z is rebuilt from xy, so two channel BC5 normal maps work as well)
+    vec2 normalXY = (255.0f/128.0f) * texture(normal_MAP, textureCoords).rg - 1.0f;
+    vec3 mapNormal = vec3(normalXY, sqrt(max(1.0f - dot(normalXY, normalXY), 0.0f)));
+    vec3 unitNormal = normalize(tbnMatrix * mapNormal);
+#else
+    vec3 unitNormal = normalize(surfaceNormal);
+#endif
+    vec3 unitToCamera = normalize(toCameraVector);
 
     vec4 totalDiffuse = vec4(0.0f);
     vec3 totalSpecular = vec3(0.0f);
-    for(int i = 0; i < 4; i++) {
+    for(int i = 0; i < LIGHT_COUNT; i++) {
         // Point light extras
         float dist = length(toLightVector[i]);
         float attFactor = u_attenuation[i].x + (u_attenuation[i].y * dist) + (u_attenuation[i].z * (dist * dist));
-        // Diffuse lighting with normal map normals
-        vec3 unitNormal = normalize(tbnMatrix * (((255.0f/128.0f) * texture(normal_MAP, textureCoords).rgb - 1.0f)));
+        // Diffuse lighting
         vec3 unitToLight = normalize(toLightVector[i]);
         float brightness = max(dot(unitNormal, unitToLight), 0.0f);
         totalDiffuse += (vec4((brightness * u_lightColor[i]), 1.0f) / attFactor) * u_intensity[i];
         // Specular lighting
-        vec3 unitToCamera = normalize(toCameraVector);
         vec3 lightDirection = -unitToLight;
         vec3 reflectedLightDir = reflect(lightDirection, unitNormal);
         float specularFactor = max(dot(reflectedLightDir, unitToCamera), 0.0f);
@@ -46,8 +69,3 @@ void main() {
     
     outColor = (totalDiffuse * (vec4(u_objectColor, 1.0f) * textureColor)) + vec4(totalSpecular, 1.0f);
 }
-
-
-
-
-
@@ -1,32 +1,94 @@
 #version 410 core
+// Lit family, variant defines: LIGHT_COUNT, HAS_TEXTURE, HAS_NORMAL_MAP, INSTANCING, SKINNING (inserted by ShaderFamily)
+
+#if LIGHT_COUNT > 0
+#define LIGHT_ARRAY LIGHT_COUNT
+#else
+#define LIGHT_ARRAY 1
+#endif
 
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec3 tangent;
 layout (location = 3) in vec2 texCoords;
+#ifdef INSTANCING
+layout (location = INSTANCE_LOCATION0) in vec4 i_transformRow0;
+layout (location = INSTANCE_LOCATION1) in vec4 i_transformRow1;
+layout (location = INSTANCE_LOCATION2) in vec4 i_transformRow2;
+#endif
+#ifdef SKINNING
+layout (location = BONE_INDEX_LOCATION) in vec4 boneIndices;
+layout (location = BONE_WEIGHT_LOCATION) in vec4 boneWeights;
+uniform mat4 u_bones[MAX_BONES];
+#endif
 
+#ifdef HAS_NORMAL_MAP
 out vec2 textureCoords;
 out mat3 tbnMatrix;
-out vec3 toLightVector[4];
+#else
+out vec3 surfaceNormal;
+#endif
+#ifdef HAS_TEXTURE
+out vec2 diffuseCoords;
+uniform vec4 u_diffuseTransform;    // atlas page: uv scale (xy) and offset (zw)
+#endif
+out vec3 toLightVector[LIGHT_ARRAY];
 out vec3 toCameraVector;
 
-uniform vec3 u_lightPosition[4];
+uniform vec3 u_lightPosition[LIGHT_ARRAY];
 uniform mat4 u_transform;
 uniform mat4 u_projection;
 uniform mat4 u_view;
+uniform vec3 u_positionOffset;
+uniform vec3 u_positionScale;
+uniform bool u_packedVertex;
+
+// Packed vertices: 16 bit positions relative to the mesh bounds, octahedral normals / tangents
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2((n.x >= 0.0) ? -t : t, (n.y >= 0.0) ? -t : t);
+    return normalize(n);
+}
+
+mat4 modelTransform() {
+#ifdef INSTANCING
+    return transpose(mat4(i_transformRow0, i_transformRow1, i_transformRow2, vec4(0.0, 0.0, 0.0, 1.0)));
+#else
+    return u_transform;
+#endif
+}
 
 void main() {
-    vec4 objPosition = u_transform * vec4(position, 1.0);
+    mat4 model = modelTransform();
+    vec4 localPosition = vec4(position * u_positionScale + u_positionOffset, 1.0);
+    vec3 vertexNormal = (u_packedVertex ? octDecode(normal.xy) : normal);
+    vec3 vertexTangent = (u_packedVertex ? octDecode(tangent.xy) : tangent);
+#ifdef SKINNING
+    mat4 skin = boneWeights.x * u_bones[int(boneIndices.x)] + boneWeights.y * u_bones[int(boneIndices.y)]
+              + boneWeights.z * u_bones[int(boneIndices.z)] + boneWeights.w * u_bones[int(boneIndices.w)];
+    localPosition = skin * localPosition;
+    vertexNormal = mat3(skin) * vertexNormal;
+    vertexTangent = mat3(skin) * vertexTangent;
+#endif
+    vec4 objPosition = model * localPosition;
     gl_Position = u_projection * u_view * objPosition;
 
+#ifdef HAS_NORMAL_MAP
     // Calculate normal, (orthogonalized) tangent and bitangent for normal mapping
-    vec3 n = normalize((u_transform * vec4(normal, 0.0)).xyz);
-    vec3 t = normalize((u_transform * vec4(tangent, 0.0)).xyz);
+    vec3 n = normalize((model * vec4(vertexNormal, 0.0)).xyz);
+    vec3 t = normalize((model * vec4(vertexTangent, 0.0)).xyz);
     t = normalize(t - (dot(t, n) * n));
     vec3 b = cross(t, n);
     tbnMatrix = mat3(t, b, n);
-    
-    for(int i = 0; i < 4; i++) { toLightVector[i] = u_lightPosition[i] - objPosition.xyz; }
-    toCameraVector = (inverse(u_view) * vec4(0.0,0.0,0.0,1.0)).xyz - objPosition.xyz;
     textureCoords = texCoords;
+#else
+    surfaceNormal = (model * vec4(vertexNormal, 0.0)).xyz;
+#endif
+#ifdef HAS_TEXTURE
+    diffuseCoords = texCoords * u_diffuseTransform.xy + u_diffuseTransform.zw;
+#endif
+
+    for(int i = 0; i < LIGHT_COUNT; i++) { toLightVector[i] = u_lightPosition[i] - objPosition.xyz; }
+    toCameraVector = (inverse(u_view) * vec4(0.0,0.0,0.0,1.0)).xyz - objPosition.xyz;
 }
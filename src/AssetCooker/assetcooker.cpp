@@ -0,0 +1,209 @@
+//  assetcooker.cpp
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+// -----------------------------------------------------------------------
+// Offline asset cooking: converts source models and their textures into
+// the forms the runtime loads without any parsing or decoding
+//
+//  - models:   welded and cache optimized meshes with bounds, written as
+//              the binary mesh cache next to the source ("<model>.amc")
+//  - textures: precomputed mip chains, block compressed into a KTX next
+//              to the source (BC5 for normal maps)
+//
+// An input is only rebuilt if its content hash differs from the one stored
+// in its cooked output. Models and textures are cooked on all cores.
+//
+// usage: arealGLCook [-j threads] [--force] [--no-textures] models-or-directories...
+// -----------------------------------------------------------------------
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <dirent.h>
+
+#include "Loader.h"
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "Hash.h"
+#include "TextureCompressor.h"
+
+using namespace arealGL;
+
+struct CookStats {
+    std::atomic<int> cooked { 0 };
+    std::atomic<int> skipped { 0 };
+    std::atomic<int> failed { 0 };
+};
+
+static std::mutex outputMutex;
+
+static void report(const std::string& line) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    std::cout <<line <<std::endl;
+}
+
+static bool isModelFile(const std::string& path) {
+    std::string ext = path.substr(path.find_last_of('.') + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    for(const char* known : { "obj", "fbx", "dae", "3ds", "blend", "gltf", "glb", "ply" }) {
+        if(ext == known) { return true; }
+    }
+    return false;
+}
+
+// Model files of a path (directories are scanned recursively)
+static void collectModels(const std::string& path, std::vector<std::string>& models) {
+    DIR* dir = opendir(path.c_str());
+    if(dir == nullptr) {
+        if(isModelFile(path)) { models.push_back(path); }
+        return;
+    }
+    while(const dirent* entry = readdir(dir)) {
+        const std::string name = entry->d_name;
+        if(name == "." || name == "..") { continue; }
+        collectModels(path + "/" + name, models);
+    }
+    closedir(dir);
+}
+
+// Cook one model into its mesh cache, returns the textures it references (path -> normal map)
+static std::map<std::string, bool> cookModel(const std::string& path, bool force, CookStats& stats) {
+    std::map<std::string, bool> textures;
+    const std::string directory = path.substr(0, path.find_last_of('/'));
+    std::vector<MeshData> meshes;
+    const MappedFile source(path);
+    const uint64_t hash = (source.isOpen() ? hashFNV1a(source.getData(), source.getSize()) : 0);
+    MeshCache::Header header;
+    MeshCache cache;
+    if(!force && MeshCache::readHeader(path, header) && (header.flags & MeshCache::FLAG_COOKED) && header.sourceHash == hash && cache.open(path)) {
+        for(uint i = 0; i < cache.getMeshCount(); i++) { meshes.push_back(cache.getMeshInfo(i)); }
+        stats.skipped++;
+    } else {
+        const auto start = std::chrono::high_resolution_clock::now();
+        const uint cookFlags = aiProcess_GenSmoothNormals | aiProcess_RemoveRedundantMaterials | aiProcess_OptimizeMeshes;
+        if(!Loader::ImportMeshData(path, meshes, cookFlags) || !MeshCache::write(path, meshes, MeshCache::FLAG_COOKED)) {
+            report(" ERROR: cooking model " + path);
+            stats.failed++;
+            return textures;
+        }
+        size_t vertices = 0, indices = 0;
+        for(const MeshData& mesh : meshes) { vertices += mesh.vertices.size(); indices += mesh.getIndexCount(); }
+        const float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        report(MeshCache::cachePath(path) + "  " + std::to_string(meshes.size()) + " meshes  " + std::to_string(vertices) + " vertices  "
+               + std::to_string(indices / 3) + " triangles  (" + std::to_string((int)ms) + " ms)");
+        stats.cooked++;
+    }
+    for(const MeshData& mesh : meshes) {
+        if(!mesh.textureDiffuse.empty()) { textures[directory + "/" + mesh.textureDiffuse] |= false; }
+        if(!mesh.textureSpecular.empty()) { textures[directory + "/" + mesh.textureSpecular] |= false; }
+        if(!mesh.textureNormal.empty()) { textures[directory + "/" + mesh.textureNormal] = true; }
+    }
+    // Images embedded in a glTF file stay in the model (there is no file to put a KTX next to)
+    for(auto it = textures.begin(); it != textures.end(); ) {
+        it = (GltfParser::isEmbeddedImagePath(it->first) ? textures.erase(it) : std::next(it));
+    }
+    return textures;
+}
+
+static void cookTexture(const std::string& path, bool normalMap, bool force, ThreadPool* blockPool, CookStats& stats) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    const texcompress::Result result = texcompress::compressFile(path, BlockFormat::NONE, normalMap, true, force, blockPool);
+    if(!result.ok) {
+        report(" ERROR: cooking texture " + path);
+        stats.failed++;
+    } else if(result.skipped) {
+        stats.skipped++;
+    } else {
+        const float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        report(texcompress::ktxPath(path) + "  " + blockFormatName(result.format) + "  " + std::to_string(result.width) + "x" + std::to_string(result.height)
+               + "  " + std::to_string(result.sourceBytes / 1024) + " KB -> " + std::to_string(result.compressedBytes / 1024) + " KB  (" + std::to_string((int)ms) + " ms)");
+        stats.cooked++;
+    }
+}
+
+int main(int argc, char** argv) {
+    uint threads = 0;
+    bool force = false;
+    bool cookTextures = true;
+    std::vector<std::string> models;
+    for(int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if(arg == "-j" && i + 1 < argc) { threads = (uint)std::atoi(argv[++i]); }
+        else if(arg == "--force") { force = true; }
+        else if(arg == "--no-textures") { cookTextures = false; }
+        else { collectModels(arg, models); }
+    }
+    if(models.empty()) {
+        std::cout <<"usage: arealGLCook [-j threads] [--force] [--no-textures] models-or-directories..." <<std::endl;
+        return 1;
+    }
+    
+    const auto start = std::chrono::high_resolution_clock::now();
+    ThreadPool pool(threads == 0 ? std::max(std::thread::hardware_concurrency(), 1u) : threads);
+    CookStats stats;
+    
+    // Models: one task each
+    std::vector<std::future<std::map<std::string, bool>>> modelTasks;
+    for(const std::string& path : models) {
+        modelTasks.push_back(pool.enqueue([path, force, &stats]() { return cookModel(path, force, stats); }));
+    }
+    std::map<std::string, bool> textures;
+    for(auto& task : modelTasks) {
+        for(const auto& texture : task.get()) { textures[texture.first] |= texture.second; }
+    }
+    
+    // Textures: one task each if there are enough of them, else one after the other
+    // with the block rows of each level spread over the pool
+    if(cookTextures) {
+        if(textures.size() >= pool.getThreadCount()) {
+            std::vector<std::future<void>> textureTasks;
+            for(const auto& texture : textures) {
+                const std::string path = texture.first;
+                const bool normalMap = texture.second;
+                textureTasks.push_back(pool.enqueue([path, normalMap, force, &stats]() { cookTexture(path, normalMap, force, nullptr, stats); }));
+            }
+            for(std::future<void>& task : textureTasks) { task.get(); }
+        } else {
+            for(const auto& texture : textures) { cookTexture(texture.first, texture.second, force, &pool, stats); }
+        }
+    }
+    
+    const float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout <<"cooked " <<stats.cooked <<", up to date " <<stats.skipped <<", failed " <<stats.failed
+              <<"  (" <<models.size() <<" models, " <<textures.size() <<" textures, " <<pool.getThreadCount() <<" threads, " <<seconds <<" s)" <<std::endl;
+    return (stats.failed == 0 ? 0 : 1);
+}
@@ -0,0 +1,193 @@
+//  benchmark.cpp
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+// -----------------------------------------------------------------------
+// Micro benchmarks: arealGLx math vs. glm
+//
+// Every operation is timed for float and double. The bulk kernels are
+// additionally run at every SIMD level the cpu supports; build with
+// AREALGL_NO_SIMD defined to get the pure scalar build of arealGLx.
+//
+// usage: arealGLBench [iterations]
+// -----------------------------------------------------------------------
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+#include "Vec3.h"
+#include "Vec4.h"
+#include "Mat4.h"
+#include "Matrix_Transformation.h"
+#include "Bulk_Transformation.h"
+#include "Simd.h"
+
+#include <glm.hpp>
+#include <gtc/matrix_transform.hpp>
+
+using namespace std;
+
+// Keep the compiler from optimizing the measured work away (value is treated as read and modified)
+template <typename T>
+inline void doNotOptimize(T& value) { asm volatile("" : "+m"(value) : : "memory"); }
+inline void clobber() { asm volatile("" : : : "memory"); }
+
+template <typename F>
+double nsPerOp(size_t iterations, size_t opsPerIteration, F&& func) {
+    // warm up the caches and the branch predictors
+    for(size_t i = 0; i < iterations / 10 + 1; i++) { func(); }
+    const auto start = chrono::high_resolution_clock::now();
+    for(size_t i = 0; i < iterations; i++) { func(); }
+    const auto end = chrono::high_resolution_clock::now();
+    return chrono::duration<double, nano>(end - start).count() / (double(iterations) * double(opsPerIteration));
+}
+
+void printHeader() {
+    cout <<left <<setw(22) <<"operation" <<setw(8) <<"type" <<setw(10) <<"library" <<setw(8) <<"simd"
+         <<right <<setw(12) <<"ns/op" <<setw(14) <<"Mops/s" <<endl;
+    cout <<string(74, '-') <<endl;
+}
+
+void printResult(const string& op, const string& type, const string& lib, const string& simd, double ns) {
+    cout <<left <<setw(22) <<op <<setw(8) <<type <<setw(10) <<lib <<setw(8) <<simd
+         <<right <<fixed <<setprecision(3) <<setw(12) <<ns <<setprecision(1) <<setw(14) <<(1000.0 / ns) <<endl;
+}
+
+template <typename T> T rnd() { return static_cast<T>(rand()) / static_cast<T>(RAND_MAX) * static_cast<T>(2) - static_cast<T>(1); }
+
+
+// ------------------------ PER OBJECT OPERATIONS ------------------------
+
+template <typename T>
+void benchObjects(const string& type, size_t iterations) {
+    typedef arealGLx::_Vec3<T> xvec3;
+    typedef arealGLx::_Vec4<T> xvec4;
+    typedef arealGLx::_Mat4<T> xmat4;
+    typedef glm::tvec3<T, glm::highp> gvec3;
+    typedef glm::tvec4<T, glm::highp> gvec4;
+    typedef glm::tmat4x4<T, glm::highp> gmat4;
+    const string simd = arealGLx::simdLevelName(arealGLx::SimdLevel::SCALAR);
+    
+    xvec4 xa(rnd<T>(), rnd<T>(), rnd<T>(), rnd<T>()), xb(rnd<T>(), rnd<T>(), rnd<T>(), rnd<T>()), xc;
+    gvec4 ga(xa.x, xa.y, xa.z, xa.w), gb(xb.x, xb.y, xb.z, xb.w), gc;
+    printResult("vec4 add", type, "arealGLx", simd, nsPerOp(iterations, 1, [&]() { doNotOptimize(xa); xc = xa + xb; doNotOptimize(xc); }));
+    printResult("vec4 add", type, "glm", "-", nsPerOp(iterations, 1, [&]() { doNotOptimize(ga); gc = ga + gb; doNotOptimize(gc); }));
+    printResult("vec4 mul", type, "arealGLx", simd, nsPerOp(iterations, 1, [&]() { doNotOptimize(xa); xc = xa * xb; doNotOptimize(xc); }));
+    printResult("vec4 mul", type, "glm", "-", nsPerOp(iterations, 1, [&]() { doNotOptimize(ga); gc = ga * gb; doNotOptimize(gc); }));
+    
+    xvec3 xv(rnd<T>(), rnd<T>(), rnd<T>()), xw(rnd<T>(), rnd<T>(), rnd<T>()), xr;
+    gvec3 gv(xv.x, xv.y, xv.z), gw(xw.x, xw.y, xw.z), gr;
+    T sink = 0;
+    printResult("vec3 dot", type, "arealGLx", simd, nsPerOp(iterations, 1, [&]() { doNotOptimize(xv); sink = arealGLx::dot(xv, xw); doNotOptimize(sink); }));
+    printResult("vec3 dot", type, "glm", "-", nsPerOp(iterations, 1, [&]() { doNotOptimize(gv); sink = glm::dot(gv, gw); doNotOptimize(sink); }));
+    printResult("vec3 normalize", type, "arealGLx", simd, nsPerOp(iterations, 1, [&]() { doNotOptimize(xv); xr = arealGLx::normalize(xv); doNotOptimize(xr); }));
+    printResult("vec3 normalize", type, "glm", "-", nsPerOp(iterations, 1, [&]() { doNotOptimize(gv); gr = glm::normalize(gv); doNotOptimize(gr); }));
+    
+    xmat4 xm = arealGLx::translate(arealGLx::rotate(xmat4(), T(0.5), xvec3(0, 1, 0)), xvec3(1, 2, 3)), xn;
+    gmat4 gm = glm::translate(glm::rotate(gmat4(T(1)), T(0.5), gvec3(0, 1, 0)), gvec3(1, 2, 3)), gn;
+    printResult("mat4 mul", type, "arealGLx", simd, nsPerOp(iterations, 1, [&]() { doNotOptimize(xm); xn = xm * xm; doNotOptimize(xn); }));
+    printResult("mat4 mul", type, "glm", "-", nsPerOp(iterations, 1, [&]() { doNotOptimize(gm); gn = gm * gm; doNotOptimize(gn); }));
+    printResult("inverse_mat", type, "arealGLx", simd, nsPerOp(iterations, 1, [&]() { doNotOptimize(xm); xn = arealGLx::inverse_mat(xm); doNotOptimize(xn); }));
+    printResult("inverse", type, "glm", "-", nsPerOp(iterations, 1, [&]() { doNotOptimize(gm); gn = glm::inverse(gm); doNotOptimize(gn); }));
+    
+    xvec3 eye(1, 2, 3), center(0, 0, 0), up(0, 1, 0);
+    gvec3 geye(1, 2, 3), gcenter(0, 0, 0), gup(0, 1, 0);
+    printResult("lookAt", type, "arealGLx", simd, nsPerOp(iterations, 1, [&]() { doNotOptimize(eye); xn = arealGLx::lookAt(eye, center, up); doNotOptimize(xn); }));
+    printResult("lookAt", type, "glm", "-", nsPerOp(iterations, 1, [&]() { doNotOptimize(geye); gn = glm::lookAt(geye, gcenter, gup); doNotOptimize(gn); }));
+    T fov = T(0.9);
+    printResult("perspective", type, "arealGLx", simd, nsPerOp(iterations, 1, [&]() { doNotOptimize(fov); xn = arealGLx::perspective(fov, T(1.33), T(0.1), T(1000)); doNotOptimize(xn); }));
+    printResult("perspective", type, "glm", "-", nsPerOp(iterations, 1, [&]() { doNotOptimize(fov); gn = glm::perspective(fov, T(1.33), T(0.1), T(1000)); doNotOptimize(gn); }));
+}
+
+
+// ------------------------ BULK OPERATIONS ------------------------
+
+template <typename T>
+void benchBulkGlm(const string& type, size_t iterations, size_t count) {
+    typedef glm::tvec3<T, glm::highp> gvec3;
+    typedef glm::tvec4<T, glm::highp> gvec4;
+    typedef glm::tmat4x4<T, glm::highp> gmat4;
+    const gmat4 m = glm::translate(glm::rotate(gmat4(T(1)), T(0.5), gvec3(0, 1, 0)), gvec3(1, 2, 3));
+    vector<gvec3> in(count, gvec3(rnd<T>(), rnd<T>(), rnd<T>())), out(count);
+    vector<gmat4> min(count, m), mout(count);
+    printResult("points (loop)", type, "glm", "-", nsPerOp(iterations, count, [&]() {
+        for(size_t i = 0; i < count; i++) { out[i] = gvec3(m * gvec4(in[i], T(1))); }
+        clobber();
+    }));
+    printResult("matrices (loop)", type, "glm", "-", nsPerOp(iterations, count, [&]() {
+        for(size_t i = 0; i < count; i++) { mout[i] = m * min[i]; }
+        clobber();
+    }));
+}
+
+template <typename T>
+void benchBulk(const string& type, const string& simd, size_t iterations, size_t count) {
+    typedef arealGLx::_Vec3<T> xvec3;
+    typedef arealGLx::_Mat4<T> xmat4;
+    typedef arealGLx::_AABB<T> xaabb;
+    const xmat4 m = arealGLx::translate(arealGLx::rotate(xmat4(), T(0.5), xvec3(0, 1, 0)), xvec3(1, 2, 3));
+    vector<xvec3> in(count, xvec3(rnd<T>(), rnd<T>(), rnd<T>())), out(count);
+    vector<xmat4> min(count, m), mout(count);
+    vector<xaabb> bin(count, xaabb(xvec3(-1), xvec3(1))), bout(count);
+    printResult("transformPoints", type, "arealGLx", simd, nsPerOp(iterations, count, [&]() { arealGLx::transformPoints(m, in.data(), out.data(), count); clobber(); }));
+    printResult("transformDirections", type, "arealGLx", simd, nsPerOp(iterations, count, [&]() { arealGLx::transformDirections(m, in.data(), out.data(), count); clobber(); }));
+    printResult("multiplyMatrices", type, "arealGLx", simd, nsPerOp(iterations, count, [&]() { arealGLx::multiplyMatrices(m, min.data(), mout.data(), count); clobber(); }));
+    printResult("transformAABBs", type, "arealGLx", simd, nsPerOp(iterations, count, [&]() { arealGLx::transformAABBs(m, bin.data(), bout.data(), count); clobber(); }));
+}
+
+
+int main(int argc, const char* argv[]) {
+    const size_t iterations = (argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000);
+    const size_t bulkCount = 4096;
+    const size_t bulkIterations = (iterations / bulkCount > 0 ? iterations / bulkCount : 1) * 16;
+    const arealGLx::SimdLevel supported = arealGLx::simdLevel();
+    
+    cout <<"arealGLx vs. glm  (cpu: " <<arealGLx::simdLevelName(supported) <<", iterations: " <<iterations <<")" <<endl <<endl;
+    printHeader();
+    benchObjects<float>("float", iterations);
+    benchObjects<double>("double", iterations);
+    
+    cout <<endl <<"bulk operations (" <<bulkCount <<" elements, ns per element)" <<endl <<endl;
+    printHeader();
+    benchBulkGlm<float>("float", bulkIterations, bulkCount);
+    benchBulkGlm<double>("double", bulkIterations, bulkCount);
+    for(int level = 0; level <= static_cast<int>(supported); level++) {
+        arealGLx::forceSimdLevel(static_cast<arealGLx::SimdLevel>(level));
+        benchBulk<float>("float", arealGLx::simdLevelName(arealGLx::simdLevel()), bulkIterations, bulkCount);
+    }
+    // double always runs the scalar reference
+    benchBulk<double>("double", arealGLx::simdLevelName(arealGLx::SimdLevel::SCALAR), bulkIterations, bulkCount);
+    
+    return 0;
+}
@@ -41,12 +41,16 @@ int main() {
     Window window { "arealGL TEST", 1024, 768, false };
     const MouseClient& mouse = window.mouseClient();
     const KeyboardClient& keyboard = window.keyboardClient();
-    Loader loader = Loader();
+    Loader loader;
     BatchRenderer batchRender = BatchRenderer();
     FrameBuffer fboMSAA = FrameBuffer(window.width(), window.height(), true);
     FrameBuffer fboIntermediate = FrameBuffer(window.width(), window.height(), false);
     Camera camera;
     Timer timer;
+    TextureStreamer textureStreamer;
+    textureStreamer.setViewportHeight(window.height());
+    loader.setTextureStreamer(&textureStreamer);
+    batchRender.setTextureStreamer(&textureStreamer);
     
     const glm::mat4 projection = glm::perspective(window.fieldOfView(), (window.width() / window.height()), 0.1f, 1000.0f);
     
@@ -56,23 +60,26 @@ int main() {
     const Light rightLampLight = Light(glm::vec3(-4.0f, 6.0f, 4.0f), CL_BLUE, glm::vec3(1.0f, 0.1f, 0.02f), 2.0f);
     const std::vector<Light> lights { sunLight, leftLampLight, rightLampLight };
     
-    // Load Shaders
+    // Mount the asset packs, if they were built (arealGLPack)
+    FileSystem::instance().mount(SHADER_BASEPATH + "shaders.pak", SHADER_BASEPATH);
+    FileSystem::instance().mount(MODEL_BASEPATH + "models.pak", MODEL_BASEPATH);
+    
+    // Load Shaders (each family compiles the variants its meshes need on first use)
     std::shared_ptr<Shader> basicShader = std::make_shared<BasicShader>();
-    std::shared_ptr<Shader> basicNoTexShader = std::make_shared<BasicNoTexShader>();
     std::shared_ptr<Shader> lightShader = std::make_shared<LightShader>(lights);
     std::shared_ptr<Shader> fboShader = std::make_shared<FboShader>();
     
-    // Load Models
+    // Load Models (complex models stream in the background, cubes are shown until they are resident)
     std::shared_ptr<Model> sunModel = loader.LoadSimpleModelFromFile(MODEL_BASEPATH + "shpere.obj");
-    std::shared_ptr<Model> nanosuitModel = loader.LoadComplexModelFromFile(MODEL_BASEPATH + "nanosuit/nanosuit.obj");
-    std::shared_ptr<Model> boxModel = loader.LoadComplexModelFromFile(MODEL_BASEPATH + "cube/cube.obj");
-    std::shared_ptr<Model> floorModel = loader.LoadComplexModelFromFile(MODEL_BASEPATH + "cube3/cube.obj");
-    std::shared_ptr<Model> lampModel = loader.LoadComplexModelFromFile(MODEL_BASEPATH + "cube2/cube2.obj");
+    std::shared_ptr<Model> nanosuitModel = loader.LoadComplexModelAsync(MODEL_BASEPATH + "nanosuit/nanosuit.obj");
+    std::shared_ptr<Model> boxModel = loader.LoadComplexModelAsync(MODEL_BASEPATH + "cube/cube.obj");
+    std::shared_ptr<Model> floorModel = loader.LoadComplexModelAsync(MODEL_BASEPATH + "cube3/cube.obj");
+    std::shared_ptr<Model> lampModel = loader.LoadComplexModelAsync(MODEL_BASEPATH + "cube2/cube2.obj");
     // Simple quad model to render FBO texture on
     RenderQuad renderQuad;
     
     // Create Entities (and set the translations)
-    std::shared_ptr<Renderable3D> sun = std::make_shared<Renderable3D>(sunModel, basicNoTexShader, glm::vec3(0.0f, 10.0f, -10.0f), CL_YELLOW_PALE);
+    std::shared_ptr<Renderable3D> sun = std::make_shared<Renderable3D>(sunModel, basicShader, glm::vec3(0.0f, 10.0f, -10.0f), CL_YELLOW_PALE);
     std::shared_ptr<Renderable3D> nanosuit = std::make_shared<Renderable3D>(nanosuitModel, lightShader, glm::vec3(0.0f, -0.45f, 0.0f), glm::vec3(0.25f), CL_WHITE);
     std::shared_ptr<Renderable3D> floor = std::make_shared<Renderable3D>(floorModel, lightShader, glm::vec3(0.0f, -10.5f, 0.0f), CL_WHITE);
     std::shared_ptr<Renderable3D> leftLamp = std::make_shared<Renderable3D>(lampModel, basicShader, glm::vec3(4.0f, 6.0f, 4.0f), glm::vec3(0.2f), CL_GREEN);
@@ -85,6 +92,9 @@ int main() {
         timer.limitFPSstart();
         // window.clear();
         
+        // Upload finished background loads (within the per frame budget)
+        loader.processUploads();
+        
         if(keyboard.KeyIsPressed(GLFW_KEY_A)) { camera.changePosition(MoveDirection::LEFT, 0.02f); }
         if(keyboard.KeyIsPressed(GLFW_KEY_D)) { camera.changePosition(MoveDirection::RIGHT, 0.02f); }
         if(keyboard.KeyIsPressed(GLFW_KEY_W)) { camera.changePosition(MoveDirection::FORWARD, 0.02f); }
@@ -92,7 +102,7 @@ int main() {
         camera.changeLineOfSight(mouse.GetMouseX(), mouse.GetMouseY(), true);
         
         // spin the box
-        box->setAngle(0.01f);
+        box->rotate(0.01f, glm::vec3(0.0f, 1.0f, 0.0f));
     
         batchRender.submit(sun);
         batchRender.submit(nanosuit);
@@ -104,6 +114,8 @@ int main() {
         // Render scene to the multisampled FrameBuffer
         fboMSAA.setAsRenderTarget();
         batchRender.render(camera, projection);
+        // Stream texture mip levels by what was just rendered
+        textureStreamer.update();
         // Combine multisampled scene into another FrameBuffer
         fboMSAA.resolveToFBO(fboIntermediate);
         // And render that to the actual Window
@@ -119,5 +131,7 @@ int main() {
         timer.limitFPSend();
     }
     
+    // Free the cached models while the GL context still exists
+    AssetRegistry::instance().shutdown();
     return 0;
 }
@@ -0,0 +1,136 @@
+//  packtool.cpp
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+// -----------------------------------------------------------------------
+// Builds a single file asset pack from a directory. Every file below the
+// directory is stored under its relative path, LZ4 compressed if that
+// saves at least ~10%. The runtime mounts the pack at the directory's
+// base path, e.g. FileSystem::instance().mount("models.pak", MODEL_BASEPATH)
+//
+// --strip-sources leaves out source models that have a cooked mesh cache
+// and images that have a cooked .ktx (see arealGLCook)
+//
+// usage: arealGLPack [--strip-sources] output.pak directory
+// -----------------------------------------------------------------------
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <dirent.h>
+
+#include "PackFile.h"
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include "CompressedTexture.h"
+
+using namespace arealGL;
+
+static bool hasSuffix(const std::string& str, const std::string& suffix) {
+    return (str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0);
+}
+
+// Files of a directory (recursively), with their path relative to the root
+static void collectFiles(const std::string& root, const std::string& relative, std::vector<PackFile::Source>& files) {
+    const std::string path = (relative.empty() ? root : root + "/" + relative);
+    DIR* dir = opendir(path.c_str());
+    if(dir == nullptr) {
+        // Block compressed textures are uploaded straight from the mapping, they stay stored
+        files.push_back({ relative, path, CompressedTexture::isCompressedPath(path) });
+        return;
+    }
+    while(const dirent* entry = readdir(dir)) {
+        const std::string name = entry->d_name;
+        // Shader program binaries are driver specific, they stay in the local cache
+        if(name == "." || name == ".." || hasSuffix(name, ".tmp") || hasSuffix(name, ".glbin")) { continue; }
+        collectFiles(root, (relative.empty() ? name : relative + "/" + name), files);
+    }
+    closedir(dir);
+}
+
+static bool isImageFile(const std::string& path) {
+    std::string ext = path.substr(path.find_last_of('.') + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    for(const char* known : { "png", "jpg", "jpeg", "tga", "bmp", "psd", "gif", "hdr" }) {
+        if(ext == known) { return true; }
+    }
+    return false;
+}
+
+// True if the runtime never reads the file because a cooked version exists
+static bool isCookedSource(const std::string& path) {
+    MeshCache::Header header;
+    if(MeshCache::readHeader(path, header) && (header.flags & MeshCache::FLAG_COOKED)) { return true; }
+    return (isImageFile(path) && getFileInfo(path.substr(0, path.find_last_of('.')) + ".ktx").exists);
+}
+
+int main(int argc, char** argv) {
+    bool stripSources = false;
+    std::vector<std::string> args;
+    for(int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if(arg == "--strip-sources") { stripSources = true; }
+        else { args.push_back(arg); }
+    }
+    if(args.size() != 2) {
+        std::cout <<"usage: arealGLPack [--strip-sources] output.pak directory" <<std::endl;
+        return 1;
+    }
+    const std::string packPath = args[0];
+    std::string root = args[1];
+    while(root.size() > 1 && root.back() == '/') { root.pop_back(); }
+    
+    const auto start = std::chrono::high_resolution_clock::now();
+    std::vector<PackFile::Source> files;
+    collectFiles(root, "", files);
+    const std::string packName = packPath.substr(packPath.find_last_of('/') + 1);
+    files.erase(std::remove_if(files.begin(), files.end(), [&](const PackFile::Source& f) {
+        return (f.path == packName || (stripSources && isCookedSource(f.file)));
+    }), files.end());
+    if(!PackFile::write(packPath, files)) { return 1; }
+    
+    // Report the result
+    PackFile pack;
+    if(!pack.open(packPath)) { return 1; }
+    uint64_t size = 0, stored = 0;
+    uint32_t compressed = 0;
+    for(uint32_t i = 0; i < pack.getEntryCount(); i++) {
+        const PackFile::Entry& e = pack.getEntry(i);
+        size += e.size;
+        stored += e.storedSize;
+        compressed += (e.compression != PackFile::COMPRESSION_NONE ? 1 : 0);
+    }
+    const float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout <<packPath <<"  " <<pack.getEntryCount() <<" files (" <<compressed <<" compressed)  "
+              <<(size / 1024) <<" KB -> " <<(stored / 1024) <<" KB  (" <<seconds <<" s)" <<std::endl;
+    return 0;
+}
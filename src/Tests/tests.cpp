@@ -0,0 +1,341 @@
+//  tests.cpp
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+// -----------------------------------------------------------------------
+// Unit tests of the bulk math kernels (Bulk_Transformation.h)
+//
+// Every dispatched float kernel is run at every SIMD level the cpu
+// supports and compared against a scalar reference computed in double.
+// Each kernel is checked with counts that are not a multiple of the
+// vector width (including 0), in place (input == output) and for writes
+// past the end of the output.
+//
+// usage: arealGLTests          (exit code 0 if all tests passed)
+// -----------------------------------------------------------------------
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+
+#include "Vec3.h"
+#include "Mat4.h"
+#include "Mat3x4.h"
+#include "Quat.h"
+#include "AABB.h"
+#include "Matrix_Transformation.h"
+#include "Bulk_Transformation.h"
+#include "Simd.h"
+
+using namespace std;
+using namespace arealGLx;
+
+static int failures = 0;
+static int checks = 0;
+
+static void check(bool ok, const string& test, const string& simd, size_t count, const string& detail = "") {
+    checks++;
+    if(!ok) {
+        failures++;
+        cout <<" FAILED: " <<test <<"  (" <<simd <<", count " <<count <<") " <<detail <<endl;
+    }
+}
+
+static bool near(double a, double b, double tolerance = 1e-4) { return fabs(a - b) <= tolerance * (fabs(b) > 1.0 ? fabs(b) : 1.0); }
+
+static float rnd() { return static_cast<float>(rand()) / static_cast<float>(RAND_MAX) * 2.0f - 1.0f; }
+static vec3 rndVec3() { return vec3(rnd(), rnd(), rnd()); }
+static vec3 rndScale() { return vec3(1.25f + rnd() * 0.75f, 1.25f + rnd() * 0.75f, 1.25f + rnd() * 0.75f); }
+static quat rndQuat() {
+    const quat q(rnd(), rnd(), rnd(), rnd());
+    const float len = sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+    return quat(q.x / len, q.y / len, q.z / len, q.w / len);
+}
+
+static mat4 rndAffine() {
+    const vec3 axis = rndVec3() + vec3(0.0f, 2.0f, 0.0f);
+    return translate(rotate(mat4(), rnd() * 3.0f, axis), rndVec3() * 10.0f) * scale(mat4(), rndScale());
+}
+
+// An output element that is not part of the range, it must not be written
+static const float SENTINEL = 12345.0f;
+
+static bool untouched(const float* p, size_t n) {
+    for(size_t i = 0; i < n; i++) { if(p[i] != SENTINEL) { return false; } }
+    return true;
+}
+
+template <typename V>
+static vector<V> sentinelOutput(size_t count) {
+    vector<V> out(count + 1);
+    float* p = reinterpret_cast<float*>(out.data());
+    for(size_t i = 0; i < (count + 1) * sizeof(V) / sizeof(float); i++) { p[i] = SENTINEL; }
+    return out;
+}
+
+template <typename V>
+static bool lastUntouched(const vector<V>& out) { return untouched(reinterpret_cast<const float*>(&out.back()), sizeof(V) / sizeof(float)); }
+
+static bool equal(const float* a, const double* b, size_t n, string& detail) {
+    for(size_t i = 0; i < n; i++) {
+        if(!near(a[i], b[i])) { detail = "element " + to_string(i) + ": " + to_string(a[i]) + " != " + to_string(b[i]); return false; }
+    }
+    return true;
+}
+
+
+// ------------------------ SCALAR REFERENCES (DOUBLE) ------------------------
+
+static vector<double> refPoints(const mat4& m, const vector<vec3>& in, size_t count, bool w) {
+    vector<double> out;
+    for(size_t i = 0; i < count; i++) {
+        for(int r = 0; r < 3; r++) {
+            double v = (w ? double(m[3][r]) : 0.0);
+            for(int c = 0; c < 3; c++) { v += double(m[c][r]) * double(in[i][c]); }
+            out.push_back(v);
+        }
+    }
+    return out;
+}
+
+static vector<double> refMatrices(const mat4& l, const vector<mat4>& in, size_t count) {
+    vector<double> out;
+    for(size_t i = 0; i < count; i++) {
+        for(int c = 0; c < 4; c++) {
+            for(int r = 0; r < 4; r++) {
+                double v = 0.0;
+                for(int k = 0; k < 4; k++) { v += double(l[k][r]) * double(in[i][c][k]); }
+                out.push_back(v);
+            }
+        }
+    }
+    return out;
+}
+
+static vector<double> refAffines(const mat3x4& l, const vector<mat3x4>& in, size_t count) {
+    vector<double> out;
+    for(size_t i = 0; i < count; i++) {
+        for(int r = 0; r < 3; r++) {
+            for(int c = 0; c < 4; c++) {
+                double v = (c == 3 ? double(l[r][3]) : 0.0);
+                for(int k = 0; k < 3; k++) { v += double(l[r][k]) * double(in[i][k][c]); }
+                out.push_back(v);
+            }
+        }
+    }
+    return out;
+}
+
+static vector<double> refAABBs(const mat4& m, const vector<aabb>& in, size_t count) {
+    vector<double> out(count * 6);
+    for(size_t i = 0; i < count; i++) {
+        // bounds of the eight transformed corners
+        for(int corner = 0; corner < 8; corner++) {
+            for(int r = 0; r < 3; r++) {
+                double v = m[3][r];
+                for(int c = 0; c < 3; c++) { v += double(m[c][r]) * double((corner >> c) & 1 ? in[i].max[c] : in[i].min[c]); }
+                if(corner == 0 || v < out[i * 6 + r]) { out[i * 6 + r] = v; }
+                if(corner == 0 || v > out[i * 6 + 3 + r]) { out[i * 6 + 3 + r] = v; }
+            }
+        }
+    }
+    return out;
+}
+
+struct dquat { double x, y, z, w; };
+
+static dquat toDouble(const quat& q) { return dquat { q.x, q.y, q.z, q.w }; }
+
+static dquat normalized(const dquat& q) {
+    const double len = sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+    return dquat { q.x / len, q.y / len, q.z / len, q.w / len };
+}
+
+static void append(vector<double>& out, const dquat& q) { out.insert(out.end(), { q.x, q.y, q.z, q.w }); }
+
+static vector<double> refQuatMul(const vector<quat>& a, const vector<quat>& b, size_t count) {
+    vector<double> out;
+    for(size_t i = 0; i < count; i++) {
+        const dquat p = toDouble(a[i]), q = toDouble(b[i]);
+        append(out, dquat { p.w * q.x + p.x * q.w + p.y * q.z - p.z * q.y,
+                            p.w * q.y + p.y * q.w + p.z * q.x - p.x * q.z,
+                            p.w * q.z + p.z * q.w + p.x * q.y - p.y * q.x,
+                            p.w * q.w - p.x * q.x - p.y * q.y - p.z * q.z });
+    }
+    return out;
+}
+
+static vector<double> refQuatNormalize(const vector<quat>& in, size_t count) {
+    vector<double> out;
+    for(size_t i = 0; i < count; i++) { append(out, normalized(toDouble(in[i]))); }
+    return out;
+}
+
+// nlerp (spherical = false) or slerp along the shortest arc
+static vector<double> refQuatBlend(const vector<quat>& a, const vector<quat>& b, float t, size_t count, bool spherical) {
+    vector<double> out;
+    for(size_t i = 0; i < count; i++) {
+        const dquat p = toDouble(a[i]);
+        dquat q = toDouble(b[i]);
+        double d = p.x * q.x + p.y * q.y + p.z * q.z + p.w * q.w;
+        if(d < 0.0) { q = dquat { -q.x, -q.y, -q.z, -q.w }; d = -d; }
+        double w1 = 1.0 - t, w2 = t;
+        if(spherical && d < 0.9995) {
+            const double theta = acos(d);
+            w1 = sin((1.0 - t) * theta) / sin(theta);
+            w2 = sin(t * theta) / sin(theta);
+        }
+        append(out, normalized(dquat { p.x * w1 + q.x * w2, p.y * w1 + q.y * w2, p.z * w1 + q.z * w2, p.w * w1 + q.w * w2 }));
+    }
+    return out;
+}
+
+// column-major 4x4 (affine = false) or the row-major upper three rows
+static vector<double> refTRS(const vector<vec3>& t, const vector<quat>& r, const vector<vec3>& s, size_t count, bool affine) {
+    vector<double> out;
+    for(size_t i = 0; i < count; i++) {
+        const dquat q = toDouble(r[i]);
+        double m[4][4] = {   // m[column][row]
+            { (1 - 2 * (q.y * q.y + q.z * q.z)) * s[i].x, 2 * (q.x * q.y + q.w * q.z) * s[i].x, 2 * (q.x * q.z - q.w * q.y) * s[i].x, 0 },
+            { 2 * (q.x * q.y - q.w * q.z) * s[i].y, (1 - 2 * (q.x * q.x + q.z * q.z)) * s[i].y, 2 * (q.y * q.z + q.w * q.x) * s[i].y, 0 },
+            { 2 * (q.x * q.z + q.w * q.y) * s[i].z, 2 * (q.y * q.z - q.w * q.x) * s[i].z, (1 - 2 * (q.x * q.x + q.y * q.y)) * s[i].z, 0 },
+            { t[i].x, t[i].y, t[i].z, 1 }
+        };
+        if(affine) {
+            for(int row = 0; row < 3; row++) { for(int c = 0; c < 4; c++) { out.push_back(m[c][row]); } }
+        } else {
+            for(int c = 0; c < 4; c++) { for(int row = 0; row < 4; row++) { out.push_back(m[c][row]); } }
+        }
+    }
+    return out;
+}
+
+
+// ------------------------ KERNEL TESTS ------------------------
+
+// Runs a kernel into a fresh output and in place (on a copy of the input), compares both with the reference
+template <typename V, typename Kernel>
+static void testKernel(const string& test, const string& simd, size_t count, const vector<V>& input, const vector<double>& expected, Kernel&& kernel) {
+    const size_t floats = count * sizeof(V) / sizeof(float);
+    string detail;
+    vector<V> out = sentinelOutput<V>(count);
+    kernel(input.data(), out.data());
+    check(equal(reinterpret_cast<const float*>(out.data()), expected.data(), floats, detail), test, simd, count, detail);
+    check(lastUntouched(out), test + " (write past the end)", simd, count);
+    
+    vector<V> inPlace = sentinelOutput<V>(count);
+    for(size_t i = 0; i < count; i++) { inPlace[i] = input[i]; }
+    kernel(inPlace.data(), inPlace.data());
+    check(equal(reinterpret_cast<const float*>(inPlace.data()), expected.data(), floats, detail), test + " (in place)", simd, count, detail);
+    check(lastUntouched(inPlace), test + " (in place, write past the end)", simd, count);
+}
+
+static void testLevel(const string& simd, size_t count) {
+    const mat4 m = rndAffine();
+    const mat3x4 m34(rndAffine());
+    vector<vec3> points(count), translations(count), scales(count);
+    vector<mat4> matrices(count);
+    vector<mat3x4> affines(count);
+    vector<aabb> boxes(count);
+    vector<quat> qa(count), qb(count), unnormalized(count);
+    for(size_t i = 0; i < count; i++) {
+        points[i] = rndVec3() * 5.0f;
+        matrices[i] = rndAffine();
+        affines[i] = mat3x4(rndAffine());
+        const vec3 a = rndVec3(), b = rndVec3();
+        boxes[i] = aabb(vec3(min(a.x, b.x), min(a.y, b.y), min(a.z, b.z)), vec3(max(a.x, b.x), max(a.y, b.y), max(a.z, b.z)));
+        qa[i] = rndQuat();
+        qb[i] = rndQuat();
+        unnormalized[i] = quat(qa[i].x * 3.0f, qa[i].y * 3.0f, qa[i].z * 3.0f, qa[i].w * 3.0f);
+        translations[i] = rndVec3() * 10.0f;
+        scales[i] = rndScale();
+    }
+    
+    testKernel("transformPoints mat4", simd, count, points, refPoints(m, points, count, true),
+               [&](const vec3* in, vec3* out) { transformPoints(m, in, out, count); });
+    testKernel("transformDirections mat4", simd, count, points, refPoints(m, points, count, false),
+               [&](const vec3* in, vec3* out) { transformDirections(m, in, out, count); });
+    testKernel("transformPoints mat3x4", simd, count, points, refPoints(m34.toMat4(), points, count, true),
+               [&](const vec3* in, vec3* out) { transformPoints(m34, in, out, count); });
+    testKernel("multiplyMatrices", simd, count, matrices, refMatrices(m, matrices, count),
+               [&](const mat4* in, mat4* out) { multiplyMatrices(m, in, out, count); });
+    testKernel("composeAffine", simd, count, affines, refAffines(m34, affines, count),
+               [&](const mat3x4* in, mat3x4* out) { composeAffine(m34, in, out, count); });
+    testKernel("transformAABBs", simd, count, boxes, refAABBs(m, boxes, count),
+               [&](const aabb* in, aabb* out) { transformAABBs(m, in, out, count); });
+    
+    // quaternions: in place is tested on the first operand
+    testKernel("multiplyQuats", simd, count, qa, refQuatMul(qa, qb, count),
+               [&](const quat* in, quat* out) { multiplyQuats(in, qb.data(), out, count); });
+    testKernel("normalizeQuats", simd, count, unnormalized, refQuatNormalize(unnormalized, count),
+               [&](const quat* in, quat* out) { normalizeQuats(in, out, count); });
+    for(const float t : { 0.0f, 0.3f, 1.0f }) {
+        testKernel("nlerpQuats t=" + to_string(t), simd, count, qa, refQuatBlend(qa, qb, t, count, false),
+                   [&](const quat* in, quat* out) { nlerpQuats(in, qb.data(), t, out, count); });
+        testKernel("slerpQuats t=" + to_string(t), simd, count, qa, refQuatBlend(qa, qb, t, count, true),
+                   [&](const quat* in, quat* out) { slerpQuats(in, qb.data(), t, out, count); });
+    }
+    // (nearly) parallel quaternions take the nlerp fallback of slerp
+    testKernel("slerpQuats parallel", simd, count, qa, refQuatBlend(qa, qa, 0.5f, count, true),
+               [&](const quat* in, quat* out) { slerpQuats(in, qa.data(), 0.5f, out, count); });
+    
+    string detail;
+    vector<mat4> trs = sentinelOutput<mat4>(count);
+    composeTRS(translations.data(), qa.data(), scales.data(), trs.data(), count);
+    check(equal(&trs[0][0].x, refTRS(translations, qa, scales, count, false).data(), count * 16, detail), "composeTRS mat4", simd, count, detail);
+    check(lastUntouched(trs), "composeTRS mat4 (write past the end)", simd, count);
+    vector<mat3x4> trs34 = sentinelOutput<mat3x4>(count);
+    composeTRS(translations.data(), qa.data(), scales.data(), trs34.data(), count);
+    check(equal(&trs34[0][0].x, refTRS(translations, qa, scales, count, true).data(), count * 12, detail), "composeTRS mat3x4", simd, count, detail);
+    check(lastUntouched(trs34), "composeTRS mat3x4 (write past the end)", simd, count);
+}
+
+
+int main() {
+    const SimdLevel supported = simdLevel();
+    // 0, below / above the 2 (AVX) and 4 wide paths, and odd sizes around 8
+    const size_t counts[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 13, 16, 31, 100 };
+    
+    cout <<"arealGLx bulk kernel tests  (cpu: " <<simdLevelName(supported) <<")" <<endl;
+    srand(42);
+    for(int level = 0; level <= static_cast<int>(supported); level++) {
+        forceSimdLevel(static_cast<SimdLevel>(level));
+        const string simd = simdLevelName(simdLevel());
+        const int failuresBefore = failures;
+        for(const size_t count : counts) { testLevel(simd, count); }
+        cout <<"  " <<simd <<": " <<(failures == failuresBefore ? "ok" : to_string(failures - failuresBefore) + " failed") <<endl;
+    }
+    forceSimdLevel(supported);
+    
+    cout <<checks <<" checks, " <<failures <<" failed" <<endl;
+    return (failures == 0 ? 0 : 1);
+}
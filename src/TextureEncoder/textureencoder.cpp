@@ -0,0 +1,94 @@
+//  textureencoder.cpp
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+// -----------------------------------------------------------------------
+// Offline block compression of textures into KTX files (next to the input)
+//
+// BC5 is used for normal maps (two channels, z is rebuilt in the shader),
+// BC3 for images with alpha and BC1 for everything else. The blocks of each
+// level are encoded in parallel on all cores. BC7 can be loaded, but is not
+// produced by this encoder.
+//
+// usage: arealGLTexEncoder [-f auto|bc1|bc3|bc5] [-j threads] [--no-mips] files...
+// -----------------------------------------------------------------------
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+#include "Types.h"
+#include "ThreadPool.h"
+#include "BlockCompression.h"
+#include "TextureCompressor.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+using namespace arealGL;
+
+int main(int argc, char** argv) {
+    BlockFormat forced = BlockFormat::NONE;
+    uint threads = 0;
+    bool mips = true;
+    std::vector<std::string> files;
+    for(int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if(arg == "-f" && i + 1 < argc) {
+            const std::string f = argv[++i];
+            forced = (f == "bc1" ? BlockFormat::BC1 : (f == "bc3" ? BlockFormat::BC3 : (f == "bc5" ? BlockFormat::BC5 : BlockFormat::NONE)));
+        }
+        else if(arg == "-j" && i + 1 < argc) { threads = (uint)std::atoi(argv[++i]); }
+        else if(arg == "--no-mips") { mips = false; }
+        else { files.push_back(arg); }
+    }
+    if(files.empty()) {
+        std::cout <<"usage: arealGLTexEncoder [-f auto|bc1|bc3|bc5] [-j threads] [--no-mips] files..." <<std::endl;
+        return 1;
+    }
+    
+    ThreadPool pool(threads == 0 ? std::max(std::thread::hardware_concurrency(), 1u) : threads);
+    int failed = 0;
+    for(const std::string& path : files) {
+        const auto start = std::chrono::high_resolution_clock::now();
+        const texcompress::Result result = texcompress::compressFile(path, forced, texcompress::isNormalMap(path), mips, true, &pool);
+        if(!result.ok) {
+            std::cerr <<" ERROR: compressing texture " <<path <<std::endl;
+            failed++;
+            continue;
+        }
+        const float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        std::cout <<texcompress::ktxPath(path) <<"  " <<blockFormatName(result.format) <<"  " <<result.width <<"x" <<result.height <<"  "
+                  <<result.levels <<" levels  " <<result.sourceBytes / 1024 <<" KB -> " <<result.compressedBytes / 1024 <<" KB  (" <<ms <<" ms)" <<std::endl;
+    }
+    return (failed == 0 ? 0 : 1);
+}
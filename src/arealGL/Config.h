@@ -41,13 +41,60 @@
 #define SHADER_BASEPATH         std::string("/Users/peter/Documents/github/C++/arealGL/resources/Shaders/")
 #define MODEL_BASEPATH          std::string("/Users/peter/Desktop/graphic_objects/")
 
-#define MAX_LIGHTS              4
+#define SHADER_BINARY_CACHE     true    // linked program binaries on disk (warm starts skip the GLSL compilation)
+#define SHADER_CACHE_PATH       (userCacheDirectory() + "arealGL/shaders/")     // driver specific, kept out of the resources
+
+#define MAX_LIGHTS              4       // largest LIGHT_COUNT of a LightShader variant
+#define MAX_BONES               64      // u_bones of the skinning shader variants
+
+#define INSTANCE_ATTRIB_LOCATION 4      // 3 x vec4 rows of the instance transform (4 - 6)
+#define SKIN_ATTRIB_LOCATION    7       // bone indices and weights (7 - 8)
 
 #define KEY_CODES               512
 #define KEY_BUFFER_SZ           4
 
-#define MIP_MAPPING             true
+#define MESH_CACHE              true    // binary mesh cache next to the source model
+#define MESH_CACHE_EXTENSION    ".amc"
+
+#define NATIVE_OBJ_PARSER       true    // parse .obj / .mtl natively (ASSIMP only for unsupported features)
+#define OBJ_PARSER_THREADS      0       // 0 = hardware threads
+#define OBJ_PARSER_MIN_CHUNK    (1 << 20)       // bytes parsed per task at least
+#define NATIVE_GLTF_PARSER      true    // read .gltf / .glb natively (ASSIMP only for unsupported features)
+
+#define MESH_WELD               true    // merge duplicate vertices at import
+#define MESH_WELD_EPSILON       1e-5f   // attribute difference below which vertices are merged (0 = exact)
+#define MESH_OPTIMIZE           true    // reorder indices and vertices for the GPU caches at import
+#define VERTEX_CACHE_SIZE       16      // post transform cache entries the optimizer assumes
+#define OVERDRAW_THRESHOLD      1.05f   // ACMR increase allowed for overdraw ordering
+
+#define VERTEX_PACKING          true    // quantized 20 byte vertices on the GPU (chosen per mesh)
+#define VERTEX_PACK_MAX_ERROR   0.001f  // largest position quantization step for a packed mesh (model units)
+#define VERTEX_PACK_MAX_UV      2.0f    // texture coordinate range that still fits half floats
+#define MODEL_SHARED_BUFFERS    true    // one vertex / index buffer for all meshes of a model (drawn by range)
+
+#define VFS_LOOSE_FILES         true    // loose files on disk take precedence over mounted packs (development)
+
+#define LOADER_THREADS          0       // background loader workers (0 = hardware threads - 1)
+#define ASYNC_UPLOAD_BUDGET_MS  2.0f    // GL upload time per frame for background loads
+#define ASSET_CACHE_SIZE        8       // released models kept resident for a fast reload (0 = free right away)
+
+#define MIP_MAPPING             true    // mip chains are built on the CPU and uploaded level by level
+#define MIP_FILTER              MipFilter::KAISER       // BOX, KAISER or LANCZOS
+#define MIP_SRGB                true    // color textures are sRGB (mips are filtered in linear space)
 #define ANISOTROPIC_FILTERING   true
+#define COMPRESSED_TEXTURES     true    // prefer a pre-compressed .ktx / .dds next to a texture file (streamed from its mapping)
+
+#define TEXTURE_ATLAS           true    // pack small diffuse textures into shared atlas pages
+#define ATLAS_SIZE              2048
+#define ATLAS_MAX_TEXTURE_SIZE  256     // larger textures keep their own
+#define ATLAS_MIP_LEVELS        4       // mip levels of a page (textures are aligned / padded to 2^(levels - 1))
+
+#define STREAM_MIN_RESIDENT_SIZE 64             // mip levels up to this size are always resident
+#define STREAM_UPLOAD_BUDGET    (4 << 20)       // texture bytes streamed in per frame
+#define STREAM_MEMORY_BUDGET    (256 << 20)     // resident texture bytes before fine levels are dropped
+#define STREAM_LOD_BIAS         0.0f
+#define STREAM_PBO_COUNT        3
+#define STREAM_DECODE_THREADS   1               // workers that decode fine levels from the source again
 
 #define MSAA                    8       // 0 - 2 - 4 - 8
 
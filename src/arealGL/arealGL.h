@@ -35,6 +35,8 @@
 #include "Window.h"
 #include "Camera.h"
 #include "Loader.h"
+#include "FileSystem.h"
+#include "AssetRegistry.h"
 #include "Light.h"
 #include "Timer.h"
 #include "Material.h"
@@ -43,13 +45,15 @@
 #include "Renderable2D.h"
 #include "RenderableGUI.h"
 #include "Mesh.h"
+#include "Model.h"
+#include "InstanceBuffer.h"
+#include "TextureStreamer.h"
 #include "SimpleRenderer.h"
 #include "BatchRenderer.h"
 #include "Shader.h"
+#include "ShaderFamily.h"
 #include "BasicShader.h"
 #include "LightShader.h"
-#include "LightNoTexShader.h"
-#include "BasicNoTexShader.h"
 #include "FboShader.h"
 #include "FrameBuffer.h"
 
@@ -33,8 +33,9 @@
 #define Renderable3D_h
 
 #include "Entity.h"
-#include "Mesh.h"
+#include "Model.h"
 #include "Vec3.h"
+#include "Quat.h"
 
 namespace arealGL {
     
@@ -43,81 +44,75 @@ public:
     const std::shared_ptr<Model> model;
 private:
     glm::vec3 position;
-    glm::vec3 rotation;
+    arealGLx::quat orientation;
     glm::vec3 scale;
-    float angle;
     
 public:    
     Renderable3D(std::shared_ptr<Model> model, std::shared_ptr<Shader> shader)
-    : Entity(shader), model(model), position(glm::vec3()), rotation(glm::vec3()), scale(glm::vec3(1.0f)), angle(0.0f) { }
+    : Entity(shader), model(model), position(glm::vec3()), orientation(arealGLx::quat()), scale(glm::vec3(1.0f)) { }
     
     Renderable3D(std::shared_ptr<Model> model, std::shared_ptr<Shader> shader, const glm::vec3& position, const Color& color)
-    : Entity(shader, color), model(model), position(position), rotation(glm::vec3()), scale(glm::vec3(1.0f)), angle(0.0f) {
-        execPosition();
+    : Entity(shader, color), model(model), position(position), orientation(arealGLx::quat()), scale(glm::vec3(1.0f)) {
+        execTransform();
     }
     
     Renderable3D(std::shared_ptr<Model> model, std::shared_ptr<Shader> shader, glm::vec3&& position, Color&& color)
-    : Entity(shader, std::move(color)), model(model), position(std::move(position)), rotation(glm::vec3()), scale(glm::vec3(1.0f)), angle(0.0f) {
-        execPosition();
+    : Entity(shader, std::move(color)), model(model), position(std::move(position)), orientation(arealGLx::quat()), scale(glm::vec3(1.0f)) {
+        execTransform();
     }
     
     Renderable3D(std::shared_ptr<Model> model, std::shared_ptr<Shader> shader, const glm::vec3& position, const glm::vec3& scale, const Color& color)
-    : Entity(shader, color), model(model), position(position), rotation(glm::vec3()), scale(scale), angle(0.0f) {
-        execPosition();
-        execScale();
+    : Entity(shader, color), model(model), position(position), orientation(arealGLx::quat()), scale(scale) {
+        execTransform();
     }
     
     Renderable3D(std::shared_ptr<Model> model, std::shared_ptr<Shader> shader, glm::vec3&& position, glm::vec3&& scale, Color&& color)
-    : Entity(shader, std::move(color)), model(model), position(std::move(position)), rotation(glm::vec3()), scale(std::move(scale)), angle(0.0f) {
-        execPosition();
-        execScale();
+    : Entity(shader, std::move(color)), model(model), position(std::move(position)), orientation(arealGLx::quat()), scale(std::move(scale)) {
+        execTransform();
     }
     
     Renderable3D(std::shared_ptr<Model> model, std::shared_ptr<Shader> shader, const glm::vec3& position,
-           const glm::vec3& rotation, const glm::vec3& scale, float angle, const Color& color)
-    : Entity(shader, color), model(model), position(position), rotation(rotation), scale(scale), angle(angle) {
-        execPosition();
-        execRotation();
-        execScale();
+           const glm::vec3& axis, const glm::vec3& scale, float angle, const Color& color)
+    : Entity(shader, color), model(model), position(position), orientation(angleAxis(angle, axis)), scale(scale) {
+        execTransform();
     }
     
     Renderable3D(std::shared_ptr<Model> model, std::shared_ptr<Shader> shader, glm::vec3&& position,
-           glm::vec3&& rotation, glm::vec3&& scale, float angle, Color&& color)
-    : Entity(shader, std::move(color)), model(model), position(std::move(position)), rotation(std::move(rotation)), scale(std::move(scale)), angle(angle) {
-        execPosition();
-        execRotation();
-        execScale();
+           glm::vec3&& axis, glm::vec3&& scale, float angle, Color&& color)
+    : Entity(shader, std::move(color)), model(model), position(std::move(position)), orientation(angleAxis(angle, axis)), scale(std::move(scale)) {
+        execTransform();
     }
     
     
-    inline void changePosition(float dx, float dy, float dz) { this->position += glm::vec3(dx, dy, dz); execPosition(); }
-    inline void changePosition(const glm::vec3& dpos) { this->position += dpos; execPosition(); }
-    inline void changeRotation(float drx, float dry, float drz) { this->rotation += glm::vec3(drx, dry, drz); execRotation(); }
-    inline void changeRotation(const glm::vec3& drota) { this->rotation += drota; execRotation(); }
-    inline void changeScale(float dsx, float dsy, float dsz) { this->scale += glm::vec3(dsx, dsy, dsz); execScale(); }
-    inline void changeScale(const glm::vec3& dscale) { this->scale += dscale; execScale(); }
-    inline void changeAngle(float angle) { this->angle += angle; execRotation(); }
-    
-    inline void setPosition(float x, float y, float z) { this->position = glm::vec3(x, y, z); execPosition(); }
-    inline void setPosition(const glm::vec3& position) { this->position = position; execPosition(); }
-    inline void setPosition(glm::vec3&& position) noexcept { this->position = std::move(position); execPosition(); }
-    inline void setRotation(float x, float y, float z) { this->rotation = glm::vec3(x, y, z); execRotation(); }
-    inline void setRotation(const glm::vec3& rotation) { this->rotation = rotation; execRotation(); }
-    inline void setRotation(glm::vec3&& rotation) noexcept { this->rotation = std::move(rotation); execRotation(); }
-    inline void setScale(float x, float y, float z) { this->scale = glm::vec3(x, y, z); execScale(); }
-    inline void setScale(const glm::vec3& scale) { this->scale = scale; execScale(); }
-    inline void setScale(glm::vec3&& scale) noexcept { this->scale = std::move(scale); execScale(); }
-    inline void setAngle(float angle) { this->angle = angle; execRotation(); }
+    inline void changePosition(float dx, float dy, float dz) { this->position += glm::vec3(dx, dy, dz); execTransform(); }
+    inline void changePosition(const glm::vec3& dpos) { this->position += dpos; execTransform(); }
+    inline void changeScale(float dsx, float dsy, float dsz) { this->scale += glm::vec3(dsx, dsy, dsz); execTransform(); }
+    inline void changeScale(const glm::vec3& dscale) { this->scale += dscale; execTransform(); }
+    // Rotate by angle (radians) around the local axis (normalized to keep repeated calls from drifting)
+    inline void rotate(float angle, const glm::vec3& axis) { this->orientation = arealGLx::normalize(this->orientation * angleAxis(angle, axis)); execTransform(); }
+    
+    inline void setPosition(float x, float y, float z) { this->position = glm::vec3(x, y, z); execTransform(); }
+    inline void setPosition(const glm::vec3& position) { this->position = position; execTransform(); }
+    inline void setPosition(glm::vec3&& position) noexcept { this->position = std::move(position); execTransform(); }
+    inline void setScale(float x, float y, float z) { this->scale = glm::vec3(x, y, z); execTransform(); }
+    inline void setScale(const glm::vec3& scale) { this->scale = scale; execTransform(); }
+    inline void setScale(glm::vec3&& scale) noexcept { this->scale = std::move(scale); execTransform(); }
+    inline void setRotation(float angle, const glm::vec3& axis) { this->orientation = angleAxis(angle, axis); execTransform(); }
+    inline void setOrientation(const arealGLx::quat& orientation) { this->orientation = orientation; execTransform(); }
     
     inline glm::vec3 getPosition() const { return this->position; }
-    inline glm::vec3 getRotation() const { return this->rotation; }
     inline glm::vec3 getScale() const { return this->scale; }
-    inline float getAngle() const { return this->angle; }
+    inline arealGLx::quat getOrientation() const { return this->orientation; }
     
 private:
-    inline void execScale() { this->transform = glm::scale(this->transform, this->scale); }
-    inline void execPosition() { this->transform = glm::translate(this->transform, this->position); }
-    inline void execRotation() { this->transform = glm::rotate(this->transform, this->angle, this->rotation); }
+    static inline arealGLx::vec3 toVec3(const glm::vec3& v) { return arealGLx::vec3(v.x, v.y, v.z); }
+    static inline arealGLx::quat angleAxis(float angle, const glm::vec3& axis) { return arealGLx::angleAxis(angle, toVec3(axis)); }
+    
+    // Model matrix = translation * rotation * scale, built directly from the quaternion
+    inline void execTransform() {
+        const arealGLx::mat4 m = arealGLx::composeTRS(toVec3(this->position), this->orientation, toVec3(this->scale));
+        for(int i = 0; i < 4; i++) { this->transform[i] = glm::vec4(m[i].x, m[i].y, m[i].z, m[i].w); }
+    }
     
 };
     
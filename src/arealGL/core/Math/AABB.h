@@ -0,0 +1,70 @@
+//  AABB.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef AABB_h
+#define AABB_h
+
+#include "Math.h"
+#include "Vec3.h"
+
+namespace arealGLx {
+    
+    // Axis aligned bounding box (min / max corner)
+    template <class T>
+    class _AABB {
+        
+    public:
+        _Vec3<T> min, max;
+        
+        _AABB() : min(0), max(0) {}
+        _AABB(const _Vec3<T>& min, const _Vec3<T>& max) : min(min), max(max) {}
+        _AABB(const _AABB& rhs) : min(rhs.min), max(rhs.max) {}
+        
+        _AABB& operator=(const _AABB& rhs) { this->min = rhs.min; this->max = rhs.max; return *this; }
+        
+        _Vec3<T> center() const { return (this->min + this->max) * static_cast<T>(0.5); }
+        _Vec3<T> extent() const { return (this->max - this->min) * static_cast<T>(0.5); }
+        
+        void expand(const _Vec3<T>& p) {
+            for(int i = 0; i < 3; i++) {
+                if(p[i] < this->min[i]) { this->min[i] = p[i]; }
+                if(p[i] > this->max[i]) { this->max[i] = p[i]; }
+            }
+        }
+        
+    };
+    
+    typedef _AABB<float> aabb;
+    typedef _AABB<double> aabbd;
+    
+}
+
+#endif
@@ -0,0 +1,429 @@
+//  Bulk_Transformation.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef Bulk_Transformation_h
+#define Bulk_Transformation_h
+
+// -----------------------------------------------------------------------
+// Transformations over contiguous arrays (culling, skinning, picking).
+// The float versions are dispatched to the best supported instruction set
+// (see Simd.h), every other type uses the scalar reference implementation.
+// Input and output arrays may be the same (in place transformation).
+// -----------------------------------------------------------------------
+
+#include <cstddef>
+#include "Simd.h"
+#include "Mat4.h"
+#include "Mat3x4.h"
+#include "Quat.h"
+#include "Vec3.h"
+#include "AABB.h"
+
+namespace arealGLx {
+    
+    // ------------------------ SCALAR REFERENCE ------------------------
+    
+    // Points: w = 1, the result is not divided by w (affine transformations)
+    template <typename T>
+    void transformPoints(const _Mat4<T>& m, const _Vec3<T>* in, _Vec3<T>* out, size_t count) {
+        for(size_t i = 0; i < count; i++) {
+            const T x = in[i].x, y = in[i].y, z = in[i].z;
+            for(int r = 0; r < 3; r++) { out[i][r] = m[0][r] * x + m[1][r] * y + m[2][r] * z + m[3][r]; }
+        }
+    }
+    
+    // Directions: w = 0, translation is ignored
+    template <typename T>
+    void transformDirections(const _Mat4<T>& m, const _Vec3<T>* in, _Vec3<T>* out, size_t count) {
+        for(size_t i = 0; i < count; i++) {
+            const T x = in[i].x, y = in[i].y, z = in[i].z;
+            for(int r = 0; r < 3; r++) { out[i][r] = m[0][r] * x + m[1][r] * y + m[2][r] * z; }
+        }
+    }
+    
+    // out[i] = lhs * in[i]
+    template <typename T>
+    void multiplyMatrices(const _Mat4<T>& lhs, const _Mat4<T>* in, _Mat4<T>* out, size_t count) {
+        const _Mat4<T> l(lhs);
+        for(size_t i = 0; i < count; i++) { out[i] = l * in[i]; }
+    }
+    
+    // out[i] = lhs * in[i] for affine transforms (e.g. parent * local)
+    template <typename T>
+    void composeAffine(const _Mat3x4<T>& lhs, const _Mat3x4<T>* in, _Mat3x4<T>* out, size_t count) {
+        const _Mat3x4<T> l(lhs);
+        for(size_t i = 0; i < count; i++) { out[i] = l * in[i]; }
+    }
+    
+    template <typename T>
+    void transformPoints(const _Mat3x4<T>& m, const _Vec3<T>* in, _Vec3<T>* out, size_t count) {
+        for(size_t i = 0; i < count; i++) { out[i] = transformPoint(m, in[i]); }
+    }
+    
+    // World space bounds of transformed boxes (J. Arvo, "Transforming Axis-Aligned Bounding Boxes")
+    template <typename T>
+    void transformAABBs(const _Mat4<T>& m, const _AABB<T>* in, _AABB<T>* out, size_t count) {
+        for(size_t i = 0; i < count; i++) {
+            const _AABB<T> box(in[i]);
+            for(int r = 0; r < 3; r++) {
+                T lo = m[3][r], hi = m[3][r];
+                for(int c = 0; c < 3; c++) {
+                    const T a = m[c][r] * box.min[c];
+                    const T b = m[c][r] * box.max[c];
+                    lo += (a < b ? a : b);
+                    hi += (a < b ? b : a);
+                }
+                out[i].min[r] = lo;
+                out[i].max[r] = hi;
+            }
+        }
+    }
+    
+    
+    // ------------------------ QUATERNIONS (SCALAR REFERENCE) ------------------------
+    
+    template <typename T>
+    void multiplyQuats(const _Quat<T>* lhs, const _Quat<T>* rhs, _Quat<T>* out, size_t count) {
+        for(size_t i = 0; i < count; i++) { out[i] = lhs[i] * rhs[i]; }
+    }
+    
+    template <typename T>
+    void normalizeQuats(const _Quat<T>* in, _Quat<T>* out, size_t count) {
+        for(size_t i = 0; i < count; i++) { out[i] = normalize(in[i]); }
+    }
+    
+    // Blend two poses (e.g. two animation keyframes) with one factor
+    template <typename T>
+    void nlerpQuats(const _Quat<T>* q1, const _Quat<T>* q2, T t, _Quat<T>* out, size_t count) {
+        for(size_t i = 0; i < count; i++) { out[i] = nlerp(q1[i], q2[i], t); }
+    }
+    
+    template <typename T>
+    void slerpQuats(const _Quat<T>* q1, const _Quat<T>* q2, T t, _Quat<T>* out, size_t count) {
+        for(size_t i = 0; i < count; i++) { out[i] = slerp(q1[i], q2[i], t); }
+    }
+    
+    template <typename T>
+    void composeTRS(const _Vec3<T>* t, const _Quat<T>* r, const _Vec3<T>* s, _Mat4<T>* out, size_t count) {
+        for(size_t i = 0; i < count; i++) { out[i] = composeTRS(t[i], r[i], s[i]); }
+    }
+    
+    template <typename T>
+    void composeTRS(const _Vec3<T>* t, const _Quat<T>* r, const _Vec3<T>* s, _Mat3x4<T>* out, size_t count) {
+        for(size_t i = 0; i < count; i++) { out[i] = composeTRS_affine(t[i], r[i], s[i]); }
+    }
+    
+    
+#if AREALGL_SIMD_X86
+    // ------------------------ SSE / AVX KERNELS ------------------------
+    
+    namespace simd {
+        
+        AREALGL_TARGET_SSE inline void store3(float* p, __m128 v) {
+            _mm_storel_pi(reinterpret_cast<__m64*>(p), v);
+            _mm_store_ss(p + 2, _mm_movehl_ps(v, v));
+        }
+        
+        AREALGL_TARGET_SSE inline void pointsSSE(const float* m, const float* in, float* out, size_t count, bool w) {
+            const __m128 c0 = _mm_loadu_ps(m), c1 = _mm_loadu_ps(m + 4), c2 = _mm_loadu_ps(m + 8);
+            const __m128 c3 = (w ? _mm_loadu_ps(m + 12) : _mm_setzero_ps());
+            for(size_t i = 0; i < count; i++, in += 3, out += 3) {
+                __m128 r = _mm_add_ps(_mm_mul_ps(c0, _mm_load1_ps(in)), c3);
+                r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_load1_ps(in + 1)));
+                r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_load1_ps(in + 2)));
+                store3(out, r);
+            }
+        }
+        
+        // two points per iteration, one in each 128 bit lane
+        AREALGL_TARGET_AVX inline void pointsAVX(const float* m, const float* in, float* out, size_t count, bool w) {
+            const __m256 c0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m));
+            const __m256 c1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 4));
+            const __m256 c2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 8));
+            const __m256 c3 = (w ? _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 12)) : _mm256_setzero_ps());
+            size_t i = 0;
+            for(; i + 2 <= count; i += 2, in += 6, out += 6) {
+                const __m256 x = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_broadcast_ss(in)), _mm_broadcast_ss(in + 3), 1);
+                const __m256 y = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_broadcast_ss(in + 1)), _mm_broadcast_ss(in + 4), 1);
+                const __m256 z = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_broadcast_ss(in + 2)), _mm_broadcast_ss(in + 5), 1);
+                __m256 r = _mm256_add_ps(_mm256_mul_ps(c0, x), c3);
+                r = _mm256_add_ps(r, _mm256_mul_ps(c1, y));
+                r = _mm256_add_ps(r, _mm256_mul_ps(c2, z));
+                const __m128 lo = _mm256_castps256_ps128(r);
+                const __m128 hi = _mm256_extractf128_ps(r, 1);
+                _mm_storel_pi(reinterpret_cast<__m64*>(out), lo);
+                _mm_store_ss(out + 2, _mm_movehl_ps(lo, lo));
+                _mm_storel_pi(reinterpret_cast<__m64*>(out + 3), hi);
+                _mm_store_ss(out + 5, _mm_movehl_ps(hi, hi));
+            }
+            if(i < count) {
+                const __m128 t0 = _mm256_castps256_ps128(c0), t1 = _mm256_castps256_ps128(c1);
+                const __m128 t2 = _mm256_castps256_ps128(c2), t3 = _mm256_castps256_ps128(c3);
+                __m128 r = _mm_add_ps(_mm_mul_ps(t0, _mm_broadcast_ss(in)), t3);
+                r = _mm_add_ps(r, _mm_mul_ps(t1, _mm_broadcast_ss(in + 1)));
+                r = _mm_add_ps(r, _mm_mul_ps(t2, _mm_broadcast_ss(in + 2)));
+                _mm_storel_pi(reinterpret_cast<__m64*>(out), r);
+                _mm_store_ss(out + 2, _mm_movehl_ps(r, r));
+            }
+            _mm256_zeroupper();
+        }
+        
+        AREALGL_TARGET_SSE inline void matricesSSE(const float* l, const float* in, float* out, size_t count) {
+            const __m128 l0 = _mm_loadu_ps(l), l1 = _mm_loadu_ps(l + 4), l2 = _mm_loadu_ps(l + 8), l3 = _mm_loadu_ps(l + 12);
+            for(size_t i = 0; i < count; i++, in += 16, out += 16) {
+                __m128 col[4];
+                for(int c = 0; c < 4; c++) {
+                    const __m128 v = _mm_loadu_ps(in + 4 * c);
+                    __m128 r = _mm_mul_ps(l0, _mm_shuffle_ps(v, v, _MM_SHUFFLE(0,0,0,0)));
+                    r = _mm_add_ps(r, _mm_mul_ps(l1, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1,1,1,1))));
+                    r = _mm_add_ps(r, _mm_mul_ps(l2, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2,2,2,2))));
+                    col[c] = _mm_add_ps(r, _mm_mul_ps(l3, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3,3,3,3))));
+                }
+                for(int c = 0; c < 4; c++) { _mm_storeu_ps(out + 4 * c, col[c]); }
+            }
+        }
+        
+        // two columns per 256 bit register
+        AREALGL_TARGET_AVX inline void matricesAVX(const float* l, const float* in, float* out, size_t count) {
+            const __m256 l0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(l));
+            const __m256 l1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(l + 4));
+            const __m256 l2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(l + 8));
+            const __m256 l3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(l + 12));
+            for(size_t i = 0; i < count; i++, in += 16, out += 16) {
+                const __m256 v01 = _mm256_loadu_ps(in);
+                const __m256 v23 = _mm256_loadu_ps(in + 8);
+                __m256 r01 = _mm256_mul_ps(l0, _mm256_permute_ps(v01, _MM_SHUFFLE(0,0,0,0)));
+                __m256 r23 = _mm256_mul_ps(l0, _mm256_permute_ps(v23, _MM_SHUFFLE(0,0,0,0)));
+                r01 = _mm256_add_ps(r01, _mm256_mul_ps(l1, _mm256_permute_ps(v01, _MM_SHUFFLE(1,1,1,1))));
+                r23 = _mm256_add_ps(r23, _mm256_mul_ps(l1, _mm256_permute_ps(v23, _MM_SHUFFLE(1,1,1,1))));
+                r01 = _mm256_add_ps(r01, _mm256_mul_ps(l2, _mm256_permute_ps(v01, _MM_SHUFFLE(2,2,2,2))));
+                r23 = _mm256_add_ps(r23, _mm256_mul_ps(l2, _mm256_permute_ps(v23, _MM_SHUFFLE(2,2,2,2))));
+                r01 = _mm256_add_ps(r01, _mm256_mul_ps(l3, _mm256_permute_ps(v01, _MM_SHUFFLE(3,3,3,3))));
+                r23 = _mm256_add_ps(r23, _mm256_mul_ps(l3, _mm256_permute_ps(v23, _MM_SHUFFLE(3,3,3,3))));
+                _mm256_storeu_ps(out, r01);
+                _mm256_storeu_ps(out + 8, r23);
+            }
+            _mm256_zeroupper();
+        }
+        
+        // rows of the result: l[r].x * in0 + l[r].y * in1 + l[r].z * in2 + (0,0,0,l[r].w)
+        AREALGL_TARGET_SSE inline void affinesSSE(const float* l, const float* in, float* out, size_t count) {
+            const __m128 mask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+            __m128 lx[3], ly[3], lz[3], lw[3];
+            for(int r = 0; r < 3; r++) {
+                const __m128 v = _mm_loadu_ps(l + 4 * r);
+                lx[r] = _mm_shuffle_ps(v, v, _MM_SHUFFLE(0,0,0,0));
+                ly[r] = _mm_shuffle_ps(v, v, _MM_SHUFFLE(1,1,1,1));
+                lz[r] = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2,2,2,2));
+                lw[r] = _mm_and_ps(v, mask);
+            }
+            for(size_t i = 0; i < count; i++, in += 12, out += 12) {
+                const __m128 i0 = _mm_loadu_ps(in), i1 = _mm_loadu_ps(in + 4), i2 = _mm_loadu_ps(in + 8);
+                for(int r = 0; r < 3; r++) {
+                    __m128 v = _mm_add_ps(_mm_mul_ps(lx[r], i0), lw[r]);
+                    v = _mm_add_ps(v, _mm_mul_ps(ly[r], i1));
+                    _mm_storeu_ps(out + 4 * r, _mm_add_ps(v, _mm_mul_ps(lz[r], i2)));
+                }
+            }
+        }
+        
+        // box layout: min xyz, max xyz
+        AREALGL_TARGET_SSE inline void aabbsSSE(const float* m, const float* in, float* out, size_t count) {
+            const __m128 c[3] = { _mm_loadu_ps(m), _mm_loadu_ps(m + 4), _mm_loadu_ps(m + 8) };
+            const __m128 t = _mm_loadu_ps(m + 12);
+            for(size_t i = 0; i < count; i++, in += 6, out += 6) {
+                __m128 lo = t, hi = t;
+                for(int k = 0; k < 3; k++) {
+                    const __m128 a = _mm_mul_ps(c[k], _mm_load1_ps(in + k));
+                    const __m128 b = _mm_mul_ps(c[k], _mm_load1_ps(in + 3 + k));
+                    lo = _mm_add_ps(lo, _mm_min_ps(a, b));
+                    hi = _mm_add_ps(hi, _mm_max_ps(a, b));
+                }
+                store3(out, lo);
+                store3(out + 3, hi);
+            }
+        }
+        
+    }
+    
+    
+    // ------------------------ DISPATCHED FLOAT VERSIONS ------------------------
+    
+    inline void transformPoints(const mat4& m, const vec3* in, vec3* out, size_t count) {
+        switch(simdLevel()) {
+            case SimdLevel::AVX: simd::pointsAVX(&m[0].x, &in->x, &out->x, count, true); break;
+            case SimdLevel::SSE: simd::pointsSSE(&m[0].x, &in->x, &out->x, count, true); break;
+            default: transformPoints<float>(m, in, out, count);
+        }
+    }
+    
+    inline void transformDirections(const mat4& m, const vec3* in, vec3* out, size_t count) {
+        switch(simdLevel()) {
+            case SimdLevel::AVX: simd::pointsAVX(&m[0].x, &in->x, &out->x, count, false); break;
+            case SimdLevel::SSE: simd::pointsSSE(&m[0].x, &in->x, &out->x, count, false); break;
+            default: transformDirections<float>(m, in, out, count);
+        }
+    }
+    
+    inline void multiplyMatrices(const mat4& lhs, const mat4* in, mat4* out, size_t count) {
+        switch(simdLevel()) {
+            case SimdLevel::AVX: simd::matricesAVX(&lhs[0].x, &in[0][0].x, &out[0][0].x, count); break;
+            case SimdLevel::SSE: simd::matricesSSE(&lhs[0].x, &in[0][0].x, &out[0][0].x, count); break;
+            default: multiplyMatrices<float>(lhs, in, out, count);
+        }
+    }
+    
+    inline void composeAffine(const mat3x4& lhs, const mat3x4* in, mat3x4* out, size_t count) {
+        switch(simdLevel()) {
+            case SimdLevel::AVX:
+            case SimdLevel::SSE: simd::affinesSSE(&lhs[0].x, &in[0][0].x, &out[0][0].x, count); break;
+            default: composeAffine<float>(lhs, in, out, count);
+        }
+    }
+    
+    inline void transformPoints(const mat3x4& m, const vec3* in, vec3* out, size_t count) {
+        if(simdLevel() == SimdLevel::SCALAR) { transformPoints<float>(m, in, out, count); return; }
+        // reuse the column kernels on the equivalent 4x4 matrix
+        const mat4 m4 = m.toMat4();
+        transformPoints(m4, in, out, count);
+    }
+    
+    // the sse kernel is already bound by the per box dependency chain, so AVX reuses it
+    inline void transformAABBs(const mat4& m, const aabb* in, aabb* out, size_t count) {
+        switch(simdLevel()) {
+            case SimdLevel::AVX:
+            case SimdLevel::SSE: simd::aabbsSSE(&m[0].x, &in->min.x, &out->min.x, count); break;
+            default: transformAABBs<float>(m, in, out, count);
+        }
+    }
+#endif
+    
+    
+#if AREALGL_SIMD_X86 && defined(__SSE2__)
+    // ------------------------ QUATERNIONS (SSE) ------------------------
+    
+    namespace simd {
+        
+        AREALGL_TARGET_SSE inline void quatsMulSSE(const float* a, const float* b, float* out, size_t count) {
+            for(size_t i = 0; i < count; i++, a += 4, b += 4, out += 4) { _mm_storeu_ps(out, quatMul(_mm_loadu_ps(a), _mm_loadu_ps(b))); }
+        }
+        
+        AREALGL_TARGET_SSE inline void quatsNormalizeSSE(const float* in, float* out, size_t count) {
+            for(size_t i = 0; i < count; i++, in += 4, out += 4) { _mm_storeu_ps(out, quatNormalize(_mm_loadu_ps(in))); }
+        }
+        
+        AREALGL_TARGET_SSE inline void quatsNlerpSSE(const float* a, const float* b, float t, float* out, size_t count) {
+            for(size_t i = 0; i < count; i++, a += 4, b += 4, out += 4) { _mm_storeu_ps(out, quatNlerp(_mm_loadu_ps(a), _mm_loadu_ps(b), t)); }
+        }
+        
+        // the weights need acos / sin per quaternion, the blend and normalization are vectorized
+        AREALGL_TARGET_SSE inline void quatsSlerpSSE(const float* a, const float* b, float t, float* out, size_t count) {
+            for(size_t i = 0; i < count; i++, a += 4, b += 4, out += 4) {
+                const __m128 va = _mm_loadu_ps(a), vb = _mm_loadu_ps(b);
+                float w1, w2;
+                slerpWeights(_mm_cvtss_f32(dot4(va, vb)), t, w1, w2);
+                _mm_storeu_ps(out, quatNormalize(_mm_add_ps(_mm_mul_ps(va, _mm_set1_ps(w1)), _mm_mul_ps(vb, _mm_set1_ps(w2)))));
+            }
+        }
+        
+        // rotation columns of the quaternion, scaled (w lane is 0)
+        AREALGL_TARGET_SSE inline void trsColumns(const float* t, const float* r, const float* s, __m128 col[4]) {
+            const __m128 q = _mm_loadu_ps(r);
+            const __m128 q2 = _mm_add_ps(q, q);
+            const __m128 a0 = _mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(3,0,0,1)), _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(3,2,1,1)));     // yy xy xz
+            const __m128 b0 = _mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(3,3,3,2)), _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(3,1,2,2)));     // zz wz wy
+            const __m128 a1 = _mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(3,1,0,0)), _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(3,2,0,1)));     // xy xx yz
+            const __m128 b1 = _mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(3,3,2,3)), _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(3,0,2,2)));     // wz zz wx
+            const __m128 a2 = _mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(3,0,1,0)), _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(3,0,2,2)));     // xz yz xx
+            const __m128 b2 = _mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(3,1,3,3)), _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(3,1,0,1)));     // wy wx yy
+            // _mm_set_ps takes w, z, y, x
+            col[0] = _mm_add_ps(_mm_set_ps(0, 0, 0, 1), _mm_add_ps(_mm_mul_ps(a0, _mm_set_ps(0, 1, 1, -1)), _mm_mul_ps(b0, _mm_set_ps(0, -1, 1, -1))));
+            col[1] = _mm_add_ps(_mm_set_ps(0, 0, 1, 0), _mm_add_ps(_mm_mul_ps(a1, _mm_set_ps(0, 1, -1, 1)), _mm_mul_ps(b1, _mm_set_ps(0, 1, -1, -1))));
+            col[2] = _mm_add_ps(_mm_set_ps(0, 1, 0, 0), _mm_add_ps(_mm_mul_ps(a2, _mm_set_ps(0, -1, 1, 1)), _mm_mul_ps(b2, _mm_set_ps(0, -1, -1, 1))));
+            col[0] = _mm_mul_ps(col[0], _mm_load1_ps(s));
+            col[1] = _mm_mul_ps(col[1], _mm_load1_ps(s + 1));
+            col[2] = _mm_mul_ps(col[2], _mm_load1_ps(s + 2));
+            col[3] = _mm_set_ps(1, t[2], t[1], t[0]);
+        }
+        
+        AREALGL_TARGET_SSE inline void trsMat4SSE(const float* t, const float* r, const float* s, float* out, size_t count) {
+            for(size_t i = 0; i < count; i++, t += 3, r += 4, s += 3, out += 16) {
+                __m128 col[4];
+                trsColumns(t, r, s, col);
+                for(int c = 0; c < 4; c++) { _mm_storeu_ps(out + 4 * c, col[c]); }
+            }
+        }
+        
+        AREALGL_TARGET_SSE inline void trsMat3x4SSE(const float* t, const float* r, const float* s, float* out, size_t count) {
+            for(size_t i = 0; i < count; i++, t += 3, r += 4, s += 3, out += 12) {
+                __m128 col[4];
+                trsColumns(t, r, s, col);
+                _MM_TRANSPOSE4_PS(col[0], col[1], col[2], col[3]);
+                for(int c = 0; c < 3; c++) { _mm_storeu_ps(out + 4 * c, col[c]); }
+            }
+        }
+        
+    }
+    
+    inline void multiplyQuats(const quat* lhs, const quat* rhs, quat* out, size_t count) {
+        if(simdLevel() == SimdLevel::SCALAR) { multiplyQuats<float>(lhs, rhs, out, count); return; }
+        simd::quatsMulSSE(&lhs->x, &rhs->x, &out->x, count);
+    }
+    
+    inline void normalizeQuats(const quat* in, quat* out, size_t count) {
+        if(simdLevel() == SimdLevel::SCALAR) { normalizeQuats<float>(in, out, count); return; }
+        simd::quatsNormalizeSSE(&in->x, &out->x, count);
+    }
+    
+    inline void nlerpQuats(const quat* q1, const quat* q2, float t, quat* out, size_t count) {
+        if(simdLevel() == SimdLevel::SCALAR) { nlerpQuats<float>(q1, q2, t, out, count); return; }
+        simd::quatsNlerpSSE(&q1->x, &q2->x, t, &out->x, count);
+    }
+    
+    inline void slerpQuats(const quat* q1, const quat* q2, float t, quat* out, size_t count) {
+        if(simdLevel() == SimdLevel::SCALAR) { slerpQuats<float>(q1, q2, t, out, count); return; }
+        simd::quatsSlerpSSE(&q1->x, &q2->x, t, &out->x, count);
+    }
+    
+    inline void composeTRS(const vec3* t, const quat* r, const vec3* s, mat4* out, size_t count) {
+        if(simdLevel() == SimdLevel::SCALAR) { composeTRS<float>(t, r, s, out, count); return; }
+        simd::trsMat4SSE(&t->x, &r->x, &s->x, &out[0][0].x, count);
+    }
+    
+    inline void composeTRS(const vec3* t, const quat* r, const vec3* s, mat3x4* out, size_t count) {
+        if(simdLevel() == SimdLevel::SCALAR) { composeTRS<float>(t, r, s, out, count); return; }
+        simd::trsMat3x4SSE(&t->x, &r->x, &s->x, &out[0][0].x, count);
+    }
+#endif
+    
+}
+
+#endif
@@ -0,0 +1,142 @@
+//  Mat3x4.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef Mat3x4_h
+#define Mat3x4_h
+
+// -----------------------------------------------------------------------
+// Affine transformation stored as the upper three rows of a 4x4 matrix.
+// The bottom row of a model transform is always (0,0,0,1), so it is not
+// stored: 48 instead of 64 bytes per transform. Rows are kept row-major,
+// which is the layout the instance attributes are uploaded in.
+// -----------------------------------------------------------------------
+
+#include "Math.h"
+#include "Vec3.h"
+#include "Vec4.h"
+#include "Mat4.h"
+
+namespace arealGLx {
+    
+    template <class T>
+    class _Mat3x4 {
+        
+        typedef _Vec4<T> row;           // rotation / scale (xyz) and translation (w)
+        
+    public:
+        row e[3];                       // three rows = 3 x 4 = 12 elements
+        
+        _Mat3x4() :e{row(1,0,0,0),row(0,1,0,0),row(0,0,1,0)} { }
+        _Mat3x4(const _Vec4<T>& r0, const _Vec4<T>& r1, const _Vec4<T>& r2) :e{r0,r1,r2} { }
+        // the column-major 4x4 matrix is transposed into rows, its bottom row is dropped
+        explicit _Mat3x4(const _Mat4<T>& m)
+        :e{row(m[0][0],m[1][0],m[2][0],m[3][0]),row(m[0][1],m[1][1],m[2][1],m[3][1]),row(m[0][2],m[1][2],m[2][2],m[3][2])} { }
+        _Mat3x4(const _Mat3x4& rhs) :e{rhs[0],rhs[1],rhs[2]} { }
+        
+        // random access operator (rows)
+        _Vec4<T>& operator[](const int& i) { return this->e[i]; /* not save ! */ }
+        const _Vec4<T>& operator[](const int& i) const { return this->e[i]; /* not save ! */ }
+        // operator =
+        _Mat3x4& operator=(const _Mat3x4& r) { this->e[0] = r[0]; this->e[1] = r[1]; this->e[2] = r[2]; return *this; }
+        // operator *=
+        _Mat3x4& operator*=(const _Mat3x4& r) { return (*this = *this * r); }
+        
+        _Mat4<T> toMat4() const {
+            return _Mat4<T>(e[0].x, e[1].x, e[2].x, 0,
+                            e[0].y, e[1].y, e[2].y, 0,
+                            e[0].z, e[1].z, e[2].z, 0,
+                            e[0].w, e[1].w, e[2].w, 1);
+        }
+        
+        _Vec3<T> getTranslation() const { return _Vec3<T>(e[0].w, e[1].w, e[2].w); }
+        
+    };
+    
+    typedef _Mat3x4<float> mat3x4;
+    typedef _Mat3x4<double> mat3x4d;
+    
+    // operator * (compose: apply rhs first, then lhs)
+    template <typename T>
+    _Mat3x4<T> operator*(const _Mat3x4<T>& lhs, const _Mat3x4<T>& rhs) {
+        _Mat3x4<T> Result;
+        for(int r = 0; r < 3; r++) {
+            Result[r] = rhs[0] * lhs[r].x + rhs[1] * lhs[r].y + rhs[2] * lhs[r].z;
+            Result[r].w += lhs[r].w;
+        }
+        return Result;
+    }
+    
+    template <typename T>
+    _Vec3<T> transformPoint(const _Mat3x4<T>& m, const _Vec3<T>& p) {
+        return _Vec3<T>(m[0].x * p.x + m[0].y * p.y + m[0].z * p.z + m[0].w,
+                        m[1].x * p.x + m[1].y * p.y + m[1].z * p.z + m[1].w,
+                        m[2].x * p.x + m[2].y * p.y + m[2].z * p.z + m[2].w);
+    }
+    
+    template <typename T>
+    _Vec3<T> transformDirection(const _Mat3x4<T>& m, const _Vec3<T>& d) {
+        return _Vec3<T>(m[0].x * d.x + m[0].y * d.y + m[0].z * d.z,
+                        m[1].x * d.x + m[1].y * d.y + m[1].z * d.z,
+                        m[2].x * d.x + m[2].y * d.y + m[2].z * d.z);
+    }
+    
+    // Inverse of the 3x3 part (cofactors) and the translation rotated back: -inverse(R) * t
+    template <typename T>
+    _Mat3x4<T> inverse_affine(const _Mat3x4<T>& m) {
+        const T c00 = m[1].y * m[2].z - m[1].z * m[2].y;
+        const T c01 = m[1].z * m[2].x - m[1].x * m[2].z;
+        const T c02 = m[1].x * m[2].y - m[1].y * m[2].x;
+        const T OneOverDeterminant = static_cast<T>(1) / (m[0].x * c00 + m[0].y * c01 + m[0].z * c02);
+        _Mat3x4<T> Result;
+        Result[0] = _Vec4<T>(c00, m[0].z * m[2].y - m[0].y * m[2].z, m[0].y * m[1].z - m[0].z * m[1].y, 0) * OneOverDeterminant;
+        Result[1] = _Vec4<T>(c01, m[0].x * m[2].z - m[0].z * m[2].x, m[0].z * m[1].x - m[0].x * m[1].z, 0) * OneOverDeterminant;
+        Result[2] = _Vec4<T>(c02, m[0].y * m[2].x - m[0].x * m[2].y, m[0].x * m[1].y - m[0].y * m[1].x, 0) * OneOverDeterminant;
+        const _Vec3<T> t = transformDirection(Result, m.getTranslation());
+        Result[0].w = -t.x;
+        Result[1].w = -t.y;
+        Result[2].w = -t.z;
+        return Result;
+    }
+    
+    // Inverse of a rotation + translation only transform (no scale): transpose(R), -transpose(R) * t
+    template <typename T>
+    _Mat3x4<T> inverse_rigid(const _Mat3x4<T>& m) {
+        _Mat3x4<T> Result(_Vec4<T>(m[0].x, m[1].x, m[2].x, 0), _Vec4<T>(m[0].y, m[1].y, m[2].y, 0), _Vec4<T>(m[0].z, m[1].z, m[2].z, 0));
+        const _Vec3<T> t = transformDirection(Result, m.getTranslation());
+        Result[0].w = -t.x;
+        Result[1].w = -t.y;
+        Result[2].w = -t.z;
+        return Result;
+    }
+    
+}
+
+#endif
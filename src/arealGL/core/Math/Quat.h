@@ -0,0 +1,227 @@
+//  Quat.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef Quat_h
+#define Quat_h
+
+// -----------------------------------------------------------------------
+// Rotation quaternion (x, y, z = vector part, w = scalar part).
+// The float multiply / normalize / nlerp use SSE when the target has it,
+// the array versions are in Bulk_Transformation.h.
+// -----------------------------------------------------------------------
+
+#include "Math.h"
+#include "Simd.h"
+#include "Vec3.h"
+#include "Vec4.h"
+#include "Mat4.h"
+#include "Mat3x4.h"
+
+namespace arealGLx {
+    
+    template <class T>
+    class _Quat {
+        
+    public:
+        T x, y, z, w;
+        
+        _Quat() : x(0), y(0), z(0), w(1) {}
+        _Quat(T x, T y, T z, T w) : x(x), y(y), z(z), w(w) {}
+        _Quat(const _Quat& rhs) : x(rhs.x), y(rhs.y), z(rhs.z), w(rhs.w) {}
+        
+        // random access operator
+        T& operator[](const int& i) { return (&x)[i]; /* not save ! */ }
+        const T& operator[](const int& i) const { return (&x)[i]; /* not save ! */ }
+        // operator =
+        _Quat& operator=(const _Quat& rhs) { this->x = rhs.x; this->y = rhs.y; this->z = rhs.z; this->w = rhs.w; return *this; }
+        // operator *=
+        _Quat& operator*=(const _Quat& rhs) { return (*this = *this * rhs); }
+        // operator == and !=
+        bool operator==(const _Quat& rhs) const { return (this->x == rhs.x) && (this->y == rhs.y) && (this->z == rhs.z) && (this->w == rhs.w); }
+        bool operator!=(const _Quat& rhs) const { return !(*this == rhs); }
+        
+        _Quat conjugate() const { return _Quat(-x, -y, -z, w); }
+        
+    };
+    
+    typedef _Quat<float> quat;
+    typedef _Quat<double> quatd;
+    
+    // Rotation of angle (radians) around axis
+    template <typename T>
+    _Quat<T> angleAxis(const T& angle, const _Vec3<T>& axis) {
+        const T s = sin(angle * static_cast<T>(0.5)) / axis.mag();
+        return _Quat<T>(axis.x * s, axis.y * s, axis.z * s, cos(angle * static_cast<T>(0.5)));
+    }
+    
+    template <typename T>
+    T dot(const _Quat<T>& q1, const _Quat<T>& q2) { return (q1.x * q2.x + q1.y * q2.y) + (q1.z * q2.z + q1.w * q2.w); }
+    
+    // operator * (Hamilton product: rotate by rhs first, then by lhs)
+    template <typename T>
+    _Quat<T> operator*(const _Quat<T>& p, const _Quat<T>& q) {
+        return _Quat<T>(p.w * q.x + p.x * q.w + p.y * q.z - p.z * q.y,
+                        p.w * q.y - p.x * q.z + p.y * q.w + p.z * q.x,
+                        p.w * q.z + p.x * q.y - p.y * q.x + p.z * q.w,
+                        p.w * q.w - p.x * q.x - p.y * q.y - p.z * q.z);
+    }
+    
+    template <typename T>
+    _Quat<T> normalize(const _Quat<T>& q) {
+        const T len = sqrt(dot(q, q));
+        if(len <= static_cast<T>(0)) { return _Quat<T>(); }
+        const T inv = static_cast<T>(1) / len;
+        return _Quat<T>(q.x * inv, q.y * inv, q.z * inv, q.w * inv);
+    }
+    
+    template <typename T>
+    _Quat<T> inverse(const _Quat<T>& q) {
+        const T inv = static_cast<T>(1) / dot(q, q);
+        return _Quat<T>(-q.x * inv, -q.y * inv, -q.z * inv, q.w * inv);
+    }
+    
+    // Normalized linear interpolation along the shortest arc
+    template <typename T>
+    _Quat<T> nlerp(const _Quat<T>& q1, const _Quat<T>& q2, const T& t) {
+        const T s = (dot(q1, q2) < static_cast<T>(0) ? -t : t);
+        const T r = static_cast<T>(1) - t;
+        return normalize(_Quat<T>(q1.x * r + q2.x * s, q1.y * r + q2.y * s, q1.z * r + q2.z * s, q1.w * r + q2.w * s));
+    }
+    
+    // Weights of q1 and q2 for the spherical interpolation (falls back to nlerp weights when almost parallel)
+    template <typename T>
+    void slerpWeights(T cosTheta, const T& t, T& w1, T& w2) {
+        const T sign = (cosTheta < static_cast<T>(0) ? static_cast<T>(-1) : static_cast<T>(1));
+        cosTheta *= sign;
+        if(cosTheta > static_cast<T>(0.9995)) {
+            w1 = static_cast<T>(1) - t;
+            w2 = t * sign;
+        } else {
+            const T theta = acos(cosTheta);
+            const T inv = static_cast<T>(1) / sin(theta);
+            w1 = sin((static_cast<T>(1) - t) * theta) * inv;
+            w2 = sin(t * theta) * inv * sign;
+        }
+    }
+    
+    template <typename T>
+    _Quat<T> slerp(const _Quat<T>& q1, const _Quat<T>& q2, const T& t) {
+        T w1, w2;
+        slerpWeights(dot(q1, q2), t, w1, w2);
+        return normalize(_Quat<T>(q1.x * w1 + q2.x * w2, q1.y * w1 + q2.y * w2, q1.z * w1 + q2.z * w2, q1.w * w1 + q2.w * w2));
+    }
+    
+    // Rotate a vector: v + 2w(u x v) + 2u x (u x v)
+    template <typename T>
+    _Vec3<T> rotate(const _Quat<T>& q, const _Vec3<T>& v) {
+        const _Vec3<T> u(q.x, q.y, q.z);
+        const _Vec3<T> uv(u.y * v.z - u.z * v.y, u.z * v.x - u.x * v.z, u.x * v.y - u.y * v.x);
+        const _Vec3<T> t = uv * static_cast<T>(2);
+        const _Vec3<T> ut(u.y * t.z - u.z * t.y, u.z * t.x - u.x * t.z, u.x * t.y - u.y * t.x);
+        return v + t * q.w + ut;
+    }
+    
+    // Translation * Rotation * Scale in one step (no matrix products)
+    template <typename T>
+    _Mat4<T> composeTRS(const _Vec3<T>& t, const _Quat<T>& q, const _Vec3<T>& s) {
+        const T xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+        const T xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+        const T wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+        const T one = static_cast<T>(1), two = static_cast<T>(2);
+        return _Mat4<T>((one - two * (yy + zz)) * s.x, two * (xy + wz) * s.x, two * (xz - wy) * s.x, 0,
+                        two * (xy - wz) * s.y, (one - two * (xx + zz)) * s.y, two * (yz + wx) * s.y, 0,
+                        two * (xz + wy) * s.z, two * (yz - wx) * s.z, (one - two * (xx + yy)) * s.z, 0,
+                        t.x, t.y, t.z, 1);
+    }
+    
+    template <typename T>
+    _Mat3x4<T> composeTRS_affine(const _Vec3<T>& t, const _Quat<T>& q, const _Vec3<T>& s) {
+        return _Mat3x4<T>(composeTRS(t, q, s));
+    }
+    
+    template <typename T>
+    _Mat4<T> toMat4(const _Quat<T>& q) { return composeTRS(_Vec3<T>(0), q, _Vec3<T>(1)); }
+    
+    
+#if AREALGL_SIMD_X86 && defined(__SSE2__)
+    // ------------------------ SSE FLOAT VERSIONS ------------------------
+    
+    namespace simd {
+        
+        inline __m128 quatMul(__m128 p, __m128 q) {
+            const __m128 px = _mm_shuffle_ps(p, p, _MM_SHUFFLE(0,0,0,0));
+            const __m128 py = _mm_shuffle_ps(p, p, _MM_SHUFFLE(1,1,1,1));
+            const __m128 pz = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2,2,2,2));
+            const __m128 pw = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3,3,3,3));
+            // sign masks in x, y, z, w order
+            const __m128 sx = _mm_castsi128_ps(_mm_set_epi32(0x80000000, 0, 0x80000000, 0));            // + - + -
+            const __m128 sy = _mm_castsi128_ps(_mm_set_epi32(0x80000000, 0x80000000, 0, 0));            // + + - -
+            const __m128 sz = _mm_castsi128_ps(_mm_set_epi32(0x80000000, 0, 0, 0x80000000));            // - + + -
+            __m128 r = _mm_mul_ps(pw, q);
+            r = _mm_add_ps(r, _mm_xor_ps(_mm_mul_ps(px, _mm_shuffle_ps(q, q, _MM_SHUFFLE(0,1,2,3))), sx));
+            r = _mm_add_ps(r, _mm_xor_ps(_mm_mul_ps(py, _mm_shuffle_ps(q, q, _MM_SHUFFLE(1,0,3,2))), sy));
+            r = _mm_add_ps(r, _mm_xor_ps(_mm_mul_ps(pz, _mm_shuffle_ps(q, q, _MM_SHUFFLE(2,3,0,1))), sz));
+            return r;
+        }
+        
+        // dot product in all four lanes
+        inline __m128 dot4(__m128 a, __m128 b) {
+            __m128 m = _mm_mul_ps(a, b);
+            m = _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2,3,0,1)));
+            return _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1,0,3,2)));
+        }
+        
+        inline __m128 quatNormalize(__m128 q) {
+            const __m128 len = _mm_sqrt_ps(dot4(q, q));
+            const __m128 valid = _mm_cmpgt_ps(len, _mm_setzero_ps());
+            const __m128 identity = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+            return _mm_or_ps(_mm_and_ps(valid, _mm_div_ps(q, len)), _mm_andnot_ps(valid, identity));
+        }
+        
+        inline __m128 quatNlerp(__m128 a, __m128 b, float t) {
+            const __m128 sign = _mm_and_ps(dot4(a, b), _mm_castsi128_ps(_mm_set1_epi32(0x80000000)));
+            const __m128 vt = _mm_xor_ps(_mm_set1_ps(t), sign);
+            return quatNormalize(_mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(1.0f - t)), _mm_mul_ps(b, vt)));
+        }
+        
+        inline __m128 loadQuat(const quat& q) { return _mm_loadu_ps(&q.x); }
+        inline quat storeQuat(__m128 v) { quat q; _mm_storeu_ps(&q.x, v); return q; }
+        
+    }
+    
+    inline quat operator*(const quat& p, const quat& q) { return simd::storeQuat(simd::quatMul(simd::loadQuat(p), simd::loadQuat(q))); }
+    inline quat normalize(const quat& q) { return simd::storeQuat(simd::quatNormalize(simd::loadQuat(q))); }
+    inline quat nlerp(const quat& q1, const quat& q2, const float& t) { return simd::storeQuat(simd::quatNlerp(simd::loadQuat(q1), simd::loadQuat(q2), t)); }
+#endif
+    
+}
+
+#endif
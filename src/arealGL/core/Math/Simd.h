@@ -0,0 +1,87 @@
+//  Simd.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef Simd_h
+#define Simd_h
+
+// -----------------------------------------------------------------------
+// Runtime selection of the instruction set used by the bulk math kernels.
+// Define AREALGL_NO_SIMD to build the scalar code paths only.
+// -----------------------------------------------------------------------
+
+#if !defined(AREALGL_NO_SIMD) && (defined(__x86_64__) || defined(__i386__))
+#define AREALGL_SIMD_X86    1
+#include <immintrin.h>
+#define AREALGL_TARGET_SSE  __attribute__((target("sse2")))
+#define AREALGL_TARGET_AVX  __attribute__((target("avx")))
+#else
+#define AREALGL_SIMD_X86    0
+#endif
+
+namespace arealGLx {
+    
+    enum class SimdLevel { SCALAR = 0, SSE = 1, AVX = 2 };
+    
+    namespace simd {
+        
+        // best instruction set supported by the executing cpu
+        inline SimdLevel detect() {
+#if AREALGL_SIMD_X86
+            __builtin_cpu_init();
+            if(__builtin_cpu_supports("avx")) { return SimdLevel::AVX; }
+            if(__builtin_cpu_supports("sse2")) { return SimdLevel::SSE; }
+#endif
+            return SimdLevel::SCALAR;
+        }
+        
+        inline SimdLevel& active() { static SimdLevel level = detect(); return level; }
+        
+    }
+    
+    inline SimdLevel simdLevel() { return simd::active(); }
+    
+    // Lower the dispatch level (for testing and benchmarking), never above what the cpu supports
+    inline void forceSimdLevel(SimdLevel level) {
+        const SimdLevel supported = simd::detect();
+        simd::active() = (static_cast<int>(level) < static_cast<int>(supported) ? level : supported);
+    }
+    
+    inline const char* simdLevelName(SimdLevel level) {
+        switch(level) {
+            case SimdLevel::AVX: return "AVX";
+            case SimdLevel::SSE: return "SSE";
+            default: return "SCALAR";
+        }
+    }
+    
+}
+
+#endif
@@ -108,7 +108,7 @@ namespace arealGLx {
     typedef _Vec2<double> vec2d;
     
     template <typename T>
-    _Vec2<T> normalize (const _Vec2<T>& rhs) { return _Vec2<T>(rhs / (float)sqrt((rhs.x * rhs.x) + (rhs.y * rhs.y))); }
+    _Vec2<T> normalize (const _Vec2<T>& rhs) { return _Vec2<T>(rhs / static_cast<T>(sqrt((rhs.x * rhs.x) + (rhs.y * rhs.y)))); }
     template <typename T>
     _Vec2<T> cross(const _Vec2<T>& v1, const _Vec2<T>& v2) { return _Vec2<T>(v1.x * v2.x + v1.y * v2.y); }
     // template <typename T>
@@ -101,9 +101,9 @@ namespace arealGLx {
     typedef _Vec3<double> vec3d;
     
     template <typename T>
-    _Vec3<T> normalize (const _Vec3<T>& rhs) { return _Vec3<T>(rhs / (float)sqrt((rhs.x * rhs.x) + (rhs.y * rhs.y) + (rhs.z * rhs.z))); }
+    _Vec3<T> normalize (const _Vec3<T>& rhs) { return _Vec3<T>(rhs / static_cast<T>(sqrt((rhs.x * rhs.x) + (rhs.y * rhs.y) + (rhs.z * rhs.z)))); }
     template <typename T>
-    _Vec3<T> cross(const _Vec3<T>& v1, const _Vec3<T>& v2) { return _Vec3<T>(v1.x * v2.x + v1.y * v2.y + v1.z * v2.z); }
+    _Vec3<T> cross(const _Vec3<T>& v1, const _Vec3<T>& v2) { return _Vec3<T>(v1.y * v2.z - v1.z * v2.y, v1.z * v2.x - v1.x * v2.z, v1.x * v2.y - v1.y * v2.x); }
     template <typename T>
     T dot(const _Vec3<T>& v1, const _Vec3<T>& v2) { _Vec3<T> tmp(v1 * v2); return tmp.x + tmp.y + tmp.z; }
     
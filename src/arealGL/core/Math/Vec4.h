@@ -108,7 +108,7 @@ namespace arealGLx {
     typedef _Vec4<double> vec4d;
     
     template <typename T>
-    _Vec4<T> normalize (const _Vec4<T>& rhs) { return _Vec4<T>(rhs / (float)sqrt((rhs.x*rhs.x) + (rhs.y*rhs.y) + (rhs.z*rhs.z) + (rhs.w*rhs.w))); }
+    _Vec4<T> normalize (const _Vec4<T>& rhs) { return _Vec4<T>(rhs / static_cast<T>(sqrt((rhs.x*rhs.x) + (rhs.y*rhs.y) + (rhs.z*rhs.z) + (rhs.w*rhs.w)))); }
     template <typename T>
     _Vec4<T> cross(const _Vec4<T>& v1, const _Vec4<T>& v2) { return _Vec4<T>(v1.x * v2.x + v1.y * v2.y + v1.z * v2.z + v1.w * v2.w); }
     // template <typename T>
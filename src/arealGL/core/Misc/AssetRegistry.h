@@ -0,0 +1,219 @@
+//  AssetRegistry.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef AssetRegistry_h
+#define AssetRegistry_h
+
+#include <string>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+
+#include "Model.h"
+#include "FileSystem.h"
+#include "Types.h"
+#include "Config.h"
+
+namespace arealGL {
+
+// Process wide registry of loaded models by canonical path (and retention), so every Loader
+// hands out the same shared Model instead of importing and uploading it again.
+// Models are freed with their last handle, unless they fit into the cache of recently
+// released models (ASSET_CACHE_SIZE), from which they can be acquired again without a reload.
+// Handles must be dropped on the render thread (freeing a Model deletes its GL objects),
+// shutdown() frees the cached models while the GL context still exists.
+class AssetRegistry {
+private:
+    struct Entry {
+        std::weak_ptr<Model> handle;
+        const Model* model = nullptr;
+        std::function<bool()> finishLoad;           // set while the model is loading in the background
+    };
+    
+    struct Released {
+        std::string key;
+        std::unique_ptr<Model> model;
+    };
+    
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    std::list<Released> released;                   // most recently released first
+    size_t cacheSize = ASSET_CACHE_SIZE;
+    
+    AssetRegistry() { }
+    
+public:
+    AssetRegistry(const AssetRegistry& rhs) = delete;
+    AssetRegistry& operator=(const AssetRegistry& rhs) = delete;
+    
+    static AssetRegistry& instance() {
+        static AssetRegistry registry;
+        return registry;
+    }
+    
+    static std::string key(const std::string& path, GeometryRetention retention) {
+        return FileSystem::normalize(path) + "#" + std::to_string((int)retention);
+    }
+    
+    // Shared handle of a registered model (also of one that is still loading), nullptr if there is none
+    std::shared_ptr<Model> find(const std::string& key) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto entry = this->entries.find(key);
+        if(entry == this->entries.end()) { return nullptr; }
+        std::shared_ptr<Model> handle = entry->second.handle.lock();
+        if(handle != nullptr) { return handle; }
+        // Released, but still cached
+        for(auto it = this->released.begin(); it != this->released.end(); ++it) {
+            if(it->key != key) { continue; }
+            handle = this->makeHandle(key, it->model.release());
+            entry->second.handle = handle;
+            this->released.erase(it);
+            return handle;
+        }
+        return nullptr;
+    }
+    
+    // Register a model (replaces any older one of the same key) and return its first handle
+    std::shared_ptr<Model> insert(const std::string& key, std::unique_ptr<Model> model) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        std::shared_ptr<Model> handle = this->makeHandle(key, model.release());
+        this->entries[key] = Entry { handle, handle.get(), nullptr };
+        return handle;
+    }
+    
+    // Unregister a model (e.g. a failed load), its handles stay valid but it is not cached
+    void forget(const std::string& key) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->entries.erase(key);
+    }
+    
+    // A registered model is loading in the background, finish completes that load right away
+    void setLoading(const std::string& key, std::function<bool()> finish) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto entry = this->entries.find(key);
+        if(entry != this->entries.end()) { entry->second.finishLoad = std::move(finish); }
+    }
+    
+    // The background load of a model is done (or abandoned)
+    void setLoaded(const std::string& key) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto entry = this->entries.find(key);
+        if(entry != this->entries.end()) { entry->second.finishLoad = nullptr; }
+    }
+    
+    bool isLoading(const Model* model) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        for(const auto& entry : this->entries) {
+            if(entry.second.model == model) { return (entry.second.finishLoad != nullptr); }
+        }
+        return false;
+    }
+    
+    // Complete the background load of a model, whichever Loader runs it (render thread).
+    // False if the load failed, true if it was loaded already.
+    bool finishLoad(const Model* model) {
+        std::function<bool()> finish;
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            for(const auto& entry : this->entries) {
+                if(entry.second.model == model) { finish = entry.second.finishLoad; break; }
+            }
+        }
+        return (finish ? finish() : true);
+    }
+    
+    // Free all released models (the GL context must still exist)
+    void clear() {
+        std::list<Released> tmpReleased;
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            tmpReleased.swap(this->released);
+            for(const Released& model : tmpReleased) { this->entries.erase(model.key); }
+        }
+    }
+    
+    // Before the GL context is destroyed: free the released models and stop caching,
+    // so the remaining handles free their models right away
+    void shutdown() {
+        this->setCacheSize(0);
+        this->clear();
+    }
+    
+    void setCacheSize(size_t size) {
+        std::list<Released> tmpReleased;
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->cacheSize = size;
+            this->trim(tmpReleased);
+        }
+    }
+    
+    size_t getCachedCount() {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->released.size();
+    }
+    
+private:
+    std::shared_ptr<Model> makeHandle(const std::string& key, Model* model) {
+        return std::shared_ptr<Model>(model, [key](Model* tmpModel) { AssetRegistry::instance().release(key, tmpModel); });
+    }
+    
+    // Called with the last handle of a model: cache it or free it
+    void release(const std::string& key, Model* model) {
+        std::unique_ptr<Model> tmpModel(model);
+        std::list<Released> tmpReleased;            // freed after the lock is dropped
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            auto entry = this->entries.find(key);
+            if(entry == this->entries.end() || entry->second.model != model) { return; }
+            if(this->cacheSize == 0) {
+                this->entries.erase(entry);
+                return;
+            }
+            this->released.push_front(Released { key, std::move(tmpModel) });
+            this->trim(tmpReleased);
+        }
+    }
+    
+    void trim(std::list<Released>& evicted) {
+        while(this->released.size() > this->cacheSize) {
+            this->entries.erase(this->released.back().key);
+            evicted.splice(evicted.begin(), this->released, std::prev(this->released.end()));
+        }
+    }
+    
+};
+
+}
+
+#endif
@@ -0,0 +1,100 @@
+//  AssimpFileSystem.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef AssimpFileSystem_h
+#define AssimpFileSystem_h
+
+#include <string>
+#include <cstring>
+
+#include "FileSystem.h"
+
+#include <IOStream.hpp>
+#include <IOSystem.hpp>
+
+namespace arealGL {
+
+// Read only ASSIMP stream over FileData (loose or packed)
+class AssimpFileStream : public Assimp::IOStream {
+private:
+    FileData file;
+    size_t position = 0;
+    
+public:
+    explicit AssimpFileStream(FileData&& file) : file(std::move(file)) { }
+    
+    size_t Read(void* buffer, size_t size, size_t count) override {
+        if(size == 0 || count == 0) { return 0; }
+        const size_t available = (this->file.getSize() - this->position) / size;
+        const size_t n = std::min(count, available);
+        std::memcpy(buffer, this->file.getData() + this->position, n * size);
+        this->position += n * size;
+        return n;
+    }
+    
+    size_t Write(const void*, size_t, size_t) override { return 0; }
+    
+    aiReturn Seek(size_t offset, aiOrigin origin) override {
+        size_t target = offset;
+        if(origin == aiOrigin_CUR) { target = this->position + offset; }
+        else if(origin == aiOrigin_END) { target = this->file.getSize() - offset; }
+        if(target > this->file.getSize()) { return aiReturn_FAILURE; }
+        this->position = target;
+        return aiReturn_SUCCESS;
+    }
+    
+    size_t Tell() const override { return this->position; }
+    size_t FileSize() const override { return this->file.getSize(); }
+    void Flush() override { }
+    
+};
+
+
+// Lets ASSIMP (and the files a model references, like .mtl) read through the FileSystem
+// Usage: importer.SetIOHandler(new AssimpFileSystem()) (the importer takes ownership)
+class AssimpFileSystem : public Assimp::IOSystem {
+public:
+    bool Exists(const char* path) const override { return FileSystem::instance().exists(path); }
+    char getOsSeparator() const override { return '/'; }
+    
+    Assimp::IOStream* Open(const char* path, const char* mode = "rb") override {
+        if(std::strchr(mode, 'w') != nullptr || std::strchr(mode, 'a') != nullptr) { return nullptr; }
+        FileData file = FileSystem::instance().read(path);
+        return (file.isOpen() ? new AssimpFileStream(std::move(file)) : nullptr);
+    }
+    
+    void Close(Assimp::IOStream* file) override { delete file; }
+    
+};
+
+}
+
+#endif
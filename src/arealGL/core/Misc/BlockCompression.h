@@ -0,0 +1,295 @@
+//  BlockCompression.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef BlockCompression_h
+#define BlockCompression_h
+
+#include <cmath>
+#include <vector>
+#include <future>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include "Types.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+
+// GL enums of the block compressed formats (not all are in the core 4.1 headers)
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT     0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT    0x83F3
+#endif
+#ifndef GL_COMPRESSED_RG_RGTC2
+#define GL_COMPRESSED_RG_RGTC2              0x8DBD
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM       0x8E8C
+#endif
+
+namespace arealGL {
+
+// BC1 = RGB (DXT1), BC3 = RGBA (DXT5), BC5 = two channel RG (normal maps), BC7 = high quality RGBA
+enum class BlockFormat { NONE = 0, BC1, BC3, BC5, BC7 };
+
+inline uint blockBytes(BlockFormat format) { return (format == BlockFormat::BC1 ? 8 : 16); }
+
+inline size_t blockLevelBytes(BlockFormat format, int width, int height) {
+    return (size_t)std::max((width + 3) / 4, 1) * (size_t)std::max((height + 3) / 4, 1) * blockBytes(format);
+}
+
+inline uint blockGLFormat(BlockFormat format) {
+    switch(format) {
+        case BlockFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+        case BlockFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+        default: return 0;
+    }
+}
+
+inline const char* blockFormatName(BlockFormat format) {
+    switch(format) {
+        case BlockFormat::BC1: return "BC1";
+        case BlockFormat::BC3: return "BC3";
+        case BlockFormat::BC5: return "BC5";
+        case BlockFormat::BC7: return "BC7";
+        default: return "NONE";
+    }
+}
+
+
+// ------ BLOCK ENCODERS ------
+// Range fit encoders: the BC1 endpoints are the extremes of the block colors along their
+// principal axis, single channel (BC4 style) blocks use the channel min / max.
+// The per texel index search runs 4 texels at a time with SSE when available.
+
+namespace bc {
+    
+    inline uint16_t packRGB565(float r, float g, float b) {
+        const uint ri = (uint)std::min(std::max(std::lround(r * 31.0f / 255.0f), 0L), 31L);
+        const uint gi = (uint)std::min(std::max(std::lround(g * 63.0f / 255.0f), 0L), 63L);
+        const uint bi = (uint)std::min(std::max(std::lround(b * 31.0f / 255.0f), 0L), 31L);
+        return (uint16_t)((ri << 11) | (gi << 5) | bi);
+    }
+    
+    inline void unpackRGB565(uint16_t c, float* rgb) {
+        const uint r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+        rgb[0] = (float)((r << 3) | (r >> 2));
+        rgb[1] = (float)((g << 2) | (g >> 4));
+        rgb[2] = (float)((b << 3) | (b >> 2));
+    }
+    
+    // Index of the nearest palette entry for each of the 16 texels (SoA input)
+    inline void nearestScalar(const float* r, const float* g, const float* b, const float palette[4][3], uint* out) {
+        for(int i = 0; i < 16; i++) {
+            float best = 1e30f;
+            for(uint p = 0; p < 4; p++) {
+                const float dr = r[i] - palette[p][0], dg = g[i] - palette[p][1], db = b[i] - palette[p][2];
+                const float d = dr * dr + dg * dg + db * db;
+                if(d < best) { best = d; out[i] = p; }
+            }
+        }
+    }
+    
+#if AREALGL_SIMD_X86
+    AREALGL_TARGET_SSE inline void nearestSSE(const float* r, const float* g, const float* b, const float palette[4][3], uint* out) {
+        for(int i = 0; i < 16; i += 4) {
+            const __m128 vr = _mm_loadu_ps(r + i), vg = _mm_loadu_ps(g + i), vb = _mm_loadu_ps(b + i);
+            __m128 best = _mm_set1_ps(1e30f);
+            __m128i index = _mm_setzero_si128();
+            for(int p = 0; p < 4; p++) {
+                const __m128 dr = _mm_sub_ps(vr, _mm_set1_ps(palette[p][0]));
+                const __m128 dg = _mm_sub_ps(vg, _mm_set1_ps(palette[p][1]));
+                const __m128 db = _mm_sub_ps(vb, _mm_set1_ps(palette[p][2]));
+                const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+                const __m128i closer = _mm_castps_si128(_mm_cmplt_ps(d, best));
+                best = _mm_min_ps(d, best);
+                index = _mm_or_si128(_mm_andnot_si128(closer, index), _mm_and_si128(closer, _mm_set1_epi32(p)));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), index);
+        }
+    }
+    
+    // Position of each value between max (0) and min (7), rounded
+    AREALGL_TARGET_SSE inline void stepsSSE(const float* v, float maxV, float scale, int* out) {
+        for(int i = 0; i < 16; i += 4) {
+            const __m128 t = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(maxV), _mm_loadu_ps(v + i)), _mm_set1_ps(scale));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_cvtps_epi32(t));
+        }
+    }
+#endif
+    
+    inline void nearest(const float* r, const float* g, const float* b, const float palette[4][3], uint* out) {
+#if AREALGL_SIMD_X86
+        if(arealGLx::simdLevel() != arealGLx::SimdLevel::SCALAR) { nearestSSE(r, g, b, palette, out); return; }
+#endif
+        nearestScalar(r, g, b, palette, out);
+    }
+    
+    // BC1 color block (always the 4 color mode) from 16 RGBA texels
+    inline void encodeColorBlock(const byte* texels, byte* out) {
+        float r[16], g[16], b[16], mean[3] = { 0.0f, 0.0f, 0.0f };
+        for(int i = 0; i < 16; i++) {
+            r[i] = texels[i * 4 + 0]; g[i] = texels[i * 4 + 1]; b[i] = texels[i * 4 + 2];
+            mean[0] += r[i]; mean[1] += g[i]; mean[2] += b[i];
+        }
+        for(int c = 0; c < 3; c++) { mean[c] /= 16.0f; }
+        // Principal axis of the colors (power iteration on the covariance)
+        float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+        for(int i = 0; i < 16; i++) {
+            const float dr = r[i] - mean[0], dg = g[i] - mean[1], db = b[i] - mean[2];
+            cov[0] += dr * dr; cov[1] += dr * dg; cov[2] += dr * db;
+            cov[3] += dg * dg; cov[4] += dg * db; cov[5] += db * db;
+        }
+        float axis[3] = { 1.0f, 1.0f, 1.0f };
+        for(int it = 0; it < 8; it++) {
+            const float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+            const float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+            const float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+            const float len = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+            if(len <= 0.0f) { break; }
+            axis[0] = x / len; axis[1] = y / len; axis[2] = z / len;
+        }
+        const float axisLen2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+        float minT = 0.0f, maxT = 0.0f;
+        for(int i = 0; i < 16; i++) {
+            const float t = ((r[i] - mean[0]) * axis[0] + (g[i] - mean[1]) * axis[1] + (b[i] - mean[2]) * axis[2]) / axisLen2;
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+        uint16_t c0 = packRGB565(mean[0] + axis[0] * maxT, mean[1] + axis[1] * maxT, mean[2] + axis[2] * maxT);
+        uint16_t c1 = packRGB565(mean[0] + axis[0] * minT, mean[1] + axis[1] * minT, mean[2] + axis[2] * minT);
+        if(c0 < c1) { std::swap(c0, c1); }
+        uint32_t indices = 0;
+        if(c0 != c1) {
+            float palette[4][3];
+            unpackRGB565(c0, palette[0]);
+            unpackRGB565(c1, palette[1]);
+            for(int c = 0; c < 3; c++) {
+                palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+                palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+            }
+            uint nearestIndex[16];
+            nearest(r, g, b, palette, nearestIndex);
+            for(int i = 0; i < 16; i++) { indices |= (nearestIndex[i] << (i * 2)); }
+        }
+        out[0] = (byte)(c0 & 0xFF); out[1] = (byte)(c0 >> 8);
+        out[2] = (byte)(c1 & 0xFF); out[3] = (byte)(c1 >> 8);
+        std::memcpy(out + 4, &indices, 4);
+    }
+    
+    // BC4 style single channel block (also the BC3 alpha block) from a strided channel
+    inline void encodeChannelBlock(const byte* texels, uint channel, byte* out) {
+        float v[16];
+        float minV = 255.0f, maxV = 0.0f;
+        for(int i = 0; i < 16; i++) {
+            v[i] = texels[i * 4 + channel];
+            minV = std::min(minV, v[i]);
+            maxV = std::max(maxV, v[i]);
+        }
+        out[0] = (byte)maxV;
+        out[1] = (byte)minV;
+        uint64_t indices = 0;
+        if(maxV > minV) {
+            int steps[16];
+            const float scale = 7.0f / (maxV - minV);
+#if AREALGL_SIMD_X86
+            if(arealGLx::simdLevel() != arealGLx::SimdLevel::SCALAR) { stepsSSE(v, maxV, scale, steps); }
+            else
+#endif
+            for(int i = 0; i < 16; i++) { steps[i] = (int)std::lround((maxV - v[i]) * scale); }
+            // step 0 = max (index 0), step 7 = min (index 1), the rest are interpolants 2 - 7
+            for(int i = 0; i < 16; i++) {
+                const int s = std::min(std::max(steps[i], 0), 7);
+                const uint64_t index = (s == 0 ? 0 : (s == 7 ? 1 : (uint64_t)(s + 1)));
+                indices |= (index << (i * 3));
+            }
+        }
+        for(int i = 0; i < 6; i++) { out[2 + i] = (byte)((indices >> (i * 8)) & 0xFF); }
+    }
+    
+    inline void encodeBlock(BlockFormat format, const byte* texels, byte* out) {
+        switch(format) {
+            case BlockFormat::BC1: encodeColorBlock(texels, out); break;
+            case BlockFormat::BC3: encodeChannelBlock(texels, 3, out); encodeColorBlock(texels, out + 8); break;
+            case BlockFormat::BC5: encodeChannelBlock(texels, 0, out); encodeChannelBlock(texels, 1, out + 8); break;
+            default: break;
+        }
+    }
+    
+}
+
+
+// Compress an RGBA8 image (block rows are spread over the pool, if given).
+// BC7 has no encoder here, the tool only produces BC1 / BC3 / BC5.
+inline bool compressImage(BlockFormat format, const byte* rgba, int width, int height, std::vector<byte>& out, ThreadPool* pool = nullptr) {
+    if(format != BlockFormat::BC1 && format != BlockFormat::BC3 && format != BlockFormat::BC5) { return false; }
+    const int blocksX = std::max((width + 3) / 4, 1);
+    const int blocksY = std::max((height + 3) / 4, 1);
+    const uint size = blockBytes(format);
+    out.resize(blockLevelBytes(format, width, height));
+    auto encodeRows = [=, &out](int firstRow, int lastRow) {
+        byte texels[64];
+        for(int by = firstRow; by < lastRow; by++) {
+            for(int bx = 0; bx < blocksX; bx++) {
+                // Gather the block (edge texels are repeated for partial blocks)
+                for(int y = 0; y < 4; y++) {
+                    const int sy = std::min(by * 4 + y, height - 1);
+                    for(int x = 0; x < 4; x++) {
+                        const int sx = std::min(bx * 4 + x, width - 1);
+                        std::memcpy(texels + (y * 4 + x) * 4, rgba + ((size_t)sy * width + sx) * 4, 4);
+                    }
+                }
+                bc::encodeBlock(format, texels, out.data() + ((size_t)by * blocksX + bx) * size);
+            }
+        }
+    };
+    if(pool == nullptr || blocksY < 8) {
+        encodeRows(0, blocksY);
+    } else {
+        const int chunks = (int)pool->getThreadCount() * 4;
+        const int rowsPerChunk = std::max((blocksY + chunks - 1) / chunks, 1);
+        std::vector<std::future<void>> tasks;
+        for(int row = 0; row < blocksY; row += rowsPerChunk) {
+            const int last = std::min(row + rowsPerChunk, blocksY);
+            tasks.push_back(pool->enqueue([&encodeRows, row, last]() { encodeRows(row, last); }));
+        }
+        for(std::future<void>& task : tasks) { task.get(); }
+    }
+    return true;
+}
+
+}
+
+#endif
@@ -0,0 +1,201 @@
+//  CompressedTexture.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef CompressedTexture_h
+#define CompressedTexture_h
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+
+#include "Types.h"
+#include "FileSystem.h"
+#include "BlockCompression.h"
+
+namespace arealGL {
+
+// Block compressed texture from a KTX (1.1) or DDS file. The levels point into the mapping.
+class CompressedTexture {
+public:
+    struct Level {
+        int width;
+        int height;
+        const byte* data;
+        size_t size;
+    };
+    
+private:
+    FileData file;
+    BlockFormat format = BlockFormat::NONE;
+    std::vector<Level> levels;
+    uint64_t sourceHash = 0;                    // content hash of the cooked source image (KTX only, 0 if unknown)
+    
+public:
+    static bool isCompressedPath(const std::string& path) {
+        const std::string ext = path.substr(path.find_last_of('.') + 1);
+        return (ext == "ktx" || ext == "KTX" || ext == "dds" || ext == "DDS");
+    }
+    
+    bool open(const std::string& path) {
+        this->format = BlockFormat::NONE;
+        this->levels.clear();
+        this->sourceHash = 0;
+        this->file = FileSystem::instance().read(path);
+        if(this->file.getSize() == 0) { this->file.close(); return false; }
+        const bool valid = (this->parseKTX() || this->parseDDS());
+        if(!valid) { this->file.close(); this->levels.clear(); this->format = BlockFormat::NONE; }
+        return valid;
+    }
+    
+    inline bool isValid() const { return (this->format != BlockFormat::NONE); }
+    inline BlockFormat getFormat() const { return this->format; }
+    inline uint getLevelCount() const { return (uint)this->levels.size(); }
+    inline const Level& getLevel(uint level) const { return this->levels[level]; }
+    inline uint64_t getSourceHash() const { return this->sourceHash; }
+    
+    
+    // Write a KTX file from compressed levels (level 0 = width x height)
+    // The source hash is stored as "arealGL.sourceHash" key / value data, if given
+    static bool writeKTX(const std::string& path, BlockFormat format, int width, int height,
+                         const std::vector<std::vector<byte>>& levels, uint64_t sourceHash = 0) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if(!out) { return false; }
+        const byte identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+        const uint32_t baseFormat = (format == BlockFormat::BC5 ? 0x8227 : (format == BlockFormat::BC1 ? 0x1907 : 0x1908));    // GL_RG / GL_RGB / GL_RGBA
+        // key / value pair: size, "key\0value", padded to 4 bytes
+        std::string keyValue;
+        if(sourceHash != 0) {
+            std::string pair = std::string(SOURCE_HASH_KEY) + '\0' + std::string(reinterpret_cast<const char*>(&sourceHash), 8);
+            const uint32_t pairSize = (uint32_t)pair.size();
+            keyValue.append(reinterpret_cast<const char*>(&pairSize), 4);
+            keyValue.append(pair);
+            keyValue.append((4 - keyValue.size() % 4) % 4, '\0');
+        }
+        const uint32_t header[13] = { 0x04030201, 0, 1, 0, blockGLFormat(format), baseFormat, (uint32_t)width, (uint32_t)height,
+                                      0, 0, 1, (uint32_t)levels.size(), (uint32_t)keyValue.size() };
+        out.write(reinterpret_cast<const char*>(identifier), sizeof(identifier));
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        out.write(keyValue.data(), keyValue.size());
+        for(const std::vector<byte>& level : levels) {
+            const uint32_t size = (uint32_t)level.size();
+            out.write(reinterpret_cast<const char*>(&size), 4);
+            out.write(reinterpret_cast<const char*>(level.data()), level.size());
+        }
+        return (bool)out;
+    }
+    
+private:
+    static constexpr const char* SOURCE_HASH_KEY = "arealGL.sourceHash";
+    
+    static BlockFormat formatFromGL(uint32_t glFormat) {
+        for(BlockFormat format : { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC5, BlockFormat::BC7 }) {
+            if(blockGLFormat(format) == glFormat) { return format; }
+        }
+        return BlockFormat::NONE;
+    }
+    
+    inline uint32_t read32(size_t offset) const {
+        uint32_t value = 0;
+        std::memcpy(&value, this->file.getData() + offset, 4);
+        return value;
+    }
+    
+    // Fill the level table (each level is tightly packed, optionally preceded by a 4 byte size)
+    bool addLevels(size_t offset, int width, int height, uint count, bool sizePrefix) {
+        const size_t fileSize = this->file.getSize();
+        for(uint i = 0; i < std::max(count, 1u); i++) {
+            const size_t size = blockLevelBytes(this->format, width, height);
+            if(sizePrefix) { offset += 4; }
+            if(offset + size > fileSize) { return false; }
+            this->levels.push_back({ width, height, this->file.getData() + offset, size });
+            offset += size;
+            width = std::max(width / 2, 1);
+            height = std::max(height / 2, 1);
+        }
+        return true;
+    }
+    
+    bool parseKTX() {
+        const byte identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+        if(this->file.getSize() < 64 || std::memcmp(this->file.getData(), identifier, 12) != 0) { return false; }
+        if(this->read32(12) != 0x04030201) { return false; }                   // only native endianness
+        this->format = formatFromGL(this->read32(28));
+        if(this->format == BlockFormat::NONE || this->read32(52) > 1) { return false; }   // no cube maps
+        const int width = (int)this->read32(36), height = (int)this->read32(40);
+        const size_t keyValueSize = this->read32(60);
+        const size_t dataOffset = 64 + keyValueSize;
+        if(dataOffset > this->file.getSize()) { return false; }
+        // Look for the source hash in the key / value data
+        const size_t keyLength = std::strlen(SOURCE_HASH_KEY) + 1;
+        for(size_t offset = 64; offset + 4 <= dataOffset; ) {
+            const uint32_t pairSize = this->read32(offset);
+            const byte* pair = this->file.getData() + offset + 4;
+            if(offset + 4 + pairSize > dataOffset) { break; }
+            if(pairSize == keyLength + 8 && std::memcmp(pair, SOURCE_HASH_KEY, keyLength) == 0) {
+                std::memcpy(&this->sourceHash, pair + keyLength, 8);
+            }
+            offset += 4 + ((pairSize + 3) & ~3u);
+        }
+        return this->addLevels(dataOffset, width, height, this->read32(56), true);
+    }
+    
+    bool parseDDS() {
+        if(this->file.getSize() < 128 || std::memcmp(this->file.getData(), "DDS ", 4) != 0) { return false; }
+        const int height = (int)this->read32(12), width = (int)this->read32(16);
+        const uint mipCount = this->read32(28);
+        const uint32_t fourCC = this->read32(84);
+        auto code = [](const char* c) { return (uint32_t)c[0] | ((uint32_t)c[1] << 8) | ((uint32_t)c[2] << 16) | ((uint32_t)c[3] << 24); };
+        size_t dataOffset = 128;
+        if(fourCC == code("DXT1")) { this->format = BlockFormat::BC1; }
+        else if(fourCC == code("DXT5")) { this->format = BlockFormat::BC3; }
+        else if(fourCC == code("ATI2") || fourCC == code("BC5U")) { this->format = BlockFormat::BC5; }
+        else if(fourCC == code("DX10") && this->file.getSize() >= 148) {
+            switch(this->read32(128)) {                                         // DXGI_FORMAT
+                case 71: case 72: this->format = BlockFormat::BC1; break;
+                case 77: case 78: this->format = BlockFormat::BC3; break;
+                case 83: this->format = BlockFormat::BC5; break;
+                case 98: case 99: this->format = BlockFormat::BC7; break;
+                default: return false;
+            }
+            dataOffset = 148;
+        } else {
+            return false;
+        }
+        return this->addLevels(dataOffset, width, height, mipCount, false);
+    }
+    
+};
+
+}
+
+#endif
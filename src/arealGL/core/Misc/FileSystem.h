@@ -0,0 +1,254 @@
+//  FileSystem.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef FileSystem_h
+#define FileSystem_h
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <iostream>
+#include <cstdint>
+
+#include "Types.h"
+#include "Config.h"
+#include "PackFile.h"
+#include "MappedFile.h"
+
+namespace arealGL {
+
+// Read only file contents handed out by the FileSystem. Either a mapping of a loose file,
+// a view into the mapping of a pack (stored entries) or a buffer (compressed entries).
+// A view keeps its pack mapped, even if the pack is unmounted while the data is in use.
+class FileData {
+private:
+    MappedFile mapping;
+    std::vector<byte> buffer;
+    std::shared_ptr<const void> owner;
+    const byte* data = nullptr;
+    size_t size = 0;
+    bool found = false;
+    
+public:
+    FileData() { }
+    FileData(const FileData& rhs) = delete;
+    FileData(FileData&& rhs) noexcept { *this = std::move(rhs); }
+    FileData& operator=(const FileData& rhs) = delete;
+    FileData& operator=(FileData&& rhs) noexcept {
+        if(this != &rhs) {
+            this->mapping = std::move(rhs.mapping);
+            this->buffer = std::move(rhs.buffer);
+            this->owner = std::move(rhs.owner);
+            this->data = rhs.data;
+            this->size = rhs.size;
+            this->found = rhs.found;
+            rhs.data = nullptr;
+            rhs.size = 0;
+            rhs.found = false;
+        }
+        return *this;
+    }
+    
+    static FileData fromMapping(MappedFile&& file) {
+        FileData result;
+        result.mapping = std::move(file);
+        result.data = result.mapping.getData();
+        result.size = result.mapping.getSize();
+        result.found = true;
+        return result;
+    }
+    static FileData fromView(const byte* data, size_t size, std::shared_ptr<const void> owner = nullptr) {
+        FileData result;
+        result.owner = std::move(owner);
+        result.data = data;
+        result.size = size;
+        result.found = true;
+        return result;
+    }
+    static FileData fromBuffer(std::vector<byte>&& buffer) {
+        FileData result;
+        result.buffer = std::move(buffer);
+        result.data = result.buffer.data();
+        result.size = result.buffer.size();
+        result.found = true;
+        return result;
+    }
+    
+    void close() { *this = FileData(); }
+    
+    // Empty files are open but have no data
+    inline bool isOpen() const { return this->found; }
+    inline const byte* getData() const { return this->data; }
+    inline size_t getSize() const { return this->size; }
+    
+};
+
+
+// Virtual file system over the loose files on disk and any number of mounted packs.
+// A pack is mounted at a path prefix (e.g. MODEL_BASEPATH), so the rest of the code keeps
+// using full paths and does not know where a file comes from. With VFS_LOOSE_FILES loose
+// files override pack contents, which keeps editing assets possible during development.
+// Mount packs at startup, lookups and reads are thread safe. Unmounting only removes a pack
+// from the lookups, it stays mapped until the last FileData viewing it is closed.
+class FileSystem {
+private:
+    struct Mount {
+        std::string prefix;
+        PackFile pack;
+    };
+    
+    std::vector<std::shared_ptr<const Mount>> mounts;
+    mutable std::mutex mutex;
+    bool looseFiles = VFS_LOOSE_FILES;
+    
+    FileSystem() { }
+    
+public:
+    static FileSystem& instance() {
+        static FileSystem fileSystem;
+        return fileSystem;
+    }
+    
+    FileSystem(const FileSystem& rhs) = delete;
+    FileSystem& operator=(const FileSystem& rhs) = delete;
+    
+    // Mount a pack at a path prefix (the last mounted pack wins on conflicts)
+    bool mount(const std::string& packPath, const std::string& mountPoint) {
+        std::shared_ptr<Mount> m = std::make_shared<Mount>();
+        if(!m->pack.open(packPath)) { return false; }
+        m->prefix = normalize(mountPoint);
+        if(!m->prefix.empty() && m->prefix.back() != '/') { m->prefix.push_back('/'); }
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->mounts.insert(this->mounts.begin(), std::move(m));
+        return true;
+    }
+    
+    void unmountAll() {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->mounts.clear();
+    }
+    
+    inline void setLooseFiles(bool enabled) { this->looseFiles = enabled; }
+    
+    bool exists(const std::string& path) const {
+        if(this->looseFiles && getFileInfo(path).exists) { return true; }
+        std::shared_ptr<const Mount> m;
+        return (this->findPacked(path, m) != nullptr);
+    }
+    
+    // Size of a file (0 if it does not exist)
+    uint64_t fileSize(const std::string& path) const {
+        if(this->looseFiles) {
+            const FileInfo info = getFileInfo(path);
+            if(info.exists) { return info.size; }
+        }
+        std::shared_ptr<const Mount> m;
+        const PackFile::Entry* e = this->findPacked(path, m);
+        return (e ? e->size : 0);
+    }
+    
+    // True if the file comes from disk (and has a timestamp), false if it is packed or missing
+    bool isLooseFile(const std::string& path) const {
+        const bool onDisk = getFileInfo(path).exists;
+        std::shared_ptr<const Mount> m;
+        return (onDisk && (this->looseFiles || this->findPacked(path, m) == nullptr));
+    }
+    
+    FileData read(const std::string& path) const {
+        if(this->looseFiles) {
+            FileData loose = readLoose(path);
+            if(loose.isOpen()) { return loose; }
+        }
+        std::shared_ptr<const Mount> m;
+        const PackFile::Entry* e = this->findPacked(path, m);
+        if(e != nullptr) {
+            const byte* stored = m->pack.getStoredData(*e);
+            if(stored != nullptr) { return FileData::fromView(stored, (size_t)e->size, m); }
+            std::vector<byte> buffer((size_t)e->size);
+            if(m->pack.extract(*e, buffer.data())) { return FileData::fromBuffer(std::move(buffer)); }
+            std::cout <<"ERROR::FILESYSTEM::Corrupt pack entry " <<path <<std::endl;
+            return FileData();
+        }
+        return (this->looseFiles ? FileData() : readLoose(path));
+    }
+    
+    // Collapse "\", "//", "./" and "dir/.." so equal paths compare equal
+    static std::string normalize(const std::string& path) {
+        std::vector<std::string> parts;
+        std::string part;
+        const bool absolute = (!path.empty() && (path[0] == '/' || path[0] == '\\'));
+        for(size_t i = 0; i <= path.size(); i++) {
+            const char c = (i < path.size() ? path[i] : '/');
+            if(c != '/' && c != '\\') { part.push_back(c); continue; }
+            if(part == "..") {
+                if(!parts.empty() && parts.back() != "..") { parts.pop_back(); }
+                else if(!absolute) { parts.push_back(part); }
+            } else if(!part.empty() && part != ".") {
+                parts.push_back(part);
+            }
+            part.clear();
+        }
+        std::string result = (absolute ? "/" : "");
+        for(size_t i = 0; i < parts.size(); i++) {
+            if(i > 0) { result.push_back('/'); }
+            result += parts[i];
+        }
+        return result;
+    }
+    
+private:
+    static FileData readLoose(const std::string& path) {
+        const FileInfo info = getFileInfo(path);
+        if(!info.exists) { return FileData(); }
+        if(info.size == 0) { return FileData::fromView(nullptr, 0); }
+        MappedFile file(path);
+        return (file.isOpen() ? FileData::fromMapping(std::move(file)) : FileData());
+    }
+    
+    // The mount is returned as well, it keeps the entry valid after the lock is released
+    const PackFile::Entry* findPacked(const std::string& path, std::shared_ptr<const Mount>& mount) const {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if(this->mounts.empty()) { return nullptr; }
+        const std::string normalized = normalize(path);
+        for(const std::shared_ptr<const Mount>& m : this->mounts) {
+            if(normalized.compare(0, m->prefix.size(), m->prefix) != 0) { continue; }
+            const PackFile::Entry* e = m->pack.find(normalized.substr(m->prefix.size()));
+            if(e != nullptr) { mount = m; return e; }
+        }
+        return nullptr;
+    }
+    
+};
+
+}
+
+#endif
@@ -0,0 +1,479 @@
+//  GltfParser.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef GltfParser_h
+#define GltfParser_h
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+
+#include "Mesh.h"
+#include "Json.h"
+#include "FileSystem.h"
+#include "MeshOptimizer.h"
+#include "Types.h"
+#include "Config.h"
+
+#include <glm.hpp>
+#include <gtc/quaternion.hpp>
+#include <gtc/type_ptr.hpp>
+
+namespace arealGL {
+
+// Native glTF 2.0 reader (.glb and .gltf with external or embedded buffers).
+// Buffers are used in place (the .glb binary chunk and .bin files stay memory mapped), the
+// accessors are read straight into the interleaved Vertex layout in one pass. Every triangle
+// primitive of every mesh node becomes one MeshData, with the node transforms applied.
+// PBR metallic-roughness materials are approximated by the Phong style Material.
+// Images inside the file (a bufferView or a data: URI) get the texture name "<file>#<image>",
+// the Loader reads their encoded bytes in place with readEmbeddedImage().
+// Sparse accessors, required extensions and non triangle primitives are rejected,
+// so the caller can fall back to ASSIMP.
+class GltfParser {
+private:
+    static constexpr uint32_t GLB_MAGIC = 0x46546C67;      // "glTF"
+    static constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+    static constexpr uint32_t GLB_CHUNK_BIN = 0x004E4942;
+    
+    enum ComponentType {
+        BYTE = 5120, UNSIGNED_BYTE = 5121, SHORT = 5122, UNSIGNED_SHORT = 5123, UNSIGNED_INT = 5125, FLOAT = 5126
+    };
+    
+    struct BufferData {
+        const byte* data = nullptr;
+        size_t size = 0;
+    };
+    
+    // An accessor, resolved to its memory
+    struct Accessor {
+        const byte* data = nullptr;
+        size_t count = 0;
+        size_t stride = 0;
+        uint components = 0;
+        int componentType = FLOAT;
+        bool normalized = false;
+        
+        inline bool isValid() const { return (this->data != nullptr || this->count == 0); }
+        
+        // Component c of element i as float (normalized integers are mapped to [0, 1] / [-1, 1])
+        float get(size_t i, uint c) const {
+            const byte* p = this->data + i * this->stride;
+            switch(this->componentType) {
+                case FLOAT:             { float v; std::memcpy(&v, p + c * 4, 4); return v; }
+                case UNSIGNED_BYTE:     { const uint8_t v = p[c]; return (this->normalized ? v / 255.0f : (float)v); }
+                case BYTE:              { const int8_t v = (int8_t)p[c]; return (this->normalized ? std::max(v / 127.0f, -1.0f) : (float)v); }
+                case UNSIGNED_SHORT:    { uint16_t v; std::memcpy(&v, p + c * 2, 2); return (this->normalized ? v / 65535.0f : (float)v); }
+                case SHORT:             { int16_t v; std::memcpy(&v, p + c * 2, 2); return (this->normalized ? std::max(v / 32767.0f, -1.0f) : (float)v); }
+                case UNSIGNED_INT:      { uint32_t v; std::memcpy(&v, p + c * 4, 4); return (float)v; }
+            }
+            return 0.0f;
+        }
+        
+        uint getIndex(size_t i) const {
+            const byte* p = this->data + i * this->stride;
+            switch(this->componentType) {
+                case UNSIGNED_BYTE:     return p[0];
+                case UNSIGNED_SHORT:    { uint16_t v; std::memcpy(&v, p, 2); return v; }
+                case UNSIGNED_INT:      { uint32_t v; std::memcpy(&v, p, 4); return v; }
+            }
+            return 0;
+        }
+    };
+    
+    struct Document {
+        JsonValue json;
+        std::string directory;
+        std::string file;                           // name of the glTF file (without the directory)
+        FileData source;                            // the .gltf / .glb itself
+        std::vector<FileData> files;                // mapped .bin files
+        std::vector<std::vector<byte>> decoded;     // data: URIs
+        std::vector<BufferData> buffers;
+    };
+    
+public:
+    static bool isGltfPath(const std::string& path) {
+        std::string ext = path.substr(path.find_last_of('.') + 1);
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        return (ext == "gltf" || ext == "glb");
+    }
+    
+    // Append one MeshData per primitive, false (and nothing appended) if the file
+    // can not be read or uses features that are not supported
+    static bool parse(const std::string& path, std::vector<MeshData>& meshes) {
+        const auto start = std::chrono::high_resolution_clock::now();
+        Document doc;
+        doc.directory = path.substr(0, path.find_last_of('/') + 1);
+        doc.file = path.substr(doc.directory.size());
+        doc.source = FileSystem::instance().read(path);
+        const FileData& file = doc.source;
+        if(!file.isOpen()) { return false; }
+        std::string error;
+        if(!readDocument(file.getData(), file.getSize(), doc, error)) {
+            std::cout <<path <<": " <<error <<" (not supported by the glTF reader)" <<std::endl;
+            return false;
+        }
+        
+        // Walk the node tree of the default scene (all root nodes if there is none)
+        std::vector<MeshData> tmpMeshes;
+        const JsonValue& nodes = doc.json["nodes"];
+        const JsonValue& scene = doc.json["scenes"][(size_t)doc.json["scene"].asInt(0)];
+        std::vector<bool> isChild(nodes.size(), false);
+        for(size_t i = 0; i < nodes.size(); i++) {
+            const JsonValue& children = nodes[i]["children"];
+            for(size_t c = 0; c < children.size(); c++) {
+                if((size_t)children[c].asInt() < isChild.size()) { isChild[(size_t)children[c].asInt()] = true; }
+            }
+        }
+        std::vector<size_t> roots;
+        if(scene.isObject()) {
+            for(size_t i = 0; i < scene["nodes"].size(); i++) { roots.push_back((size_t)scene["nodes"][i].asInt()); }
+        } else {
+            for(size_t i = 0; i < nodes.size(); i++) { if(!isChild[i]) { roots.push_back(i); } }
+        }
+        for(size_t root : roots) {
+            if(!processNode(doc, root, glm::mat4(1.0f), tmpMeshes, error, 0)) {
+                std::cout <<path <<": " <<error <<" (not supported by the glTF reader)" <<std::endl;
+                return false;
+            }
+        }
+        
+        const float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+        size_t bytes = 0;
+        for(const BufferData& buffer : doc.buffers) { bytes += buffer.size; }
+        const float megabytes = (float)(bytes + file.getSize()) / (1024.0f * 1024.0f);
+        std::cout <<path <<"  glTF " <<megabytes <<" MB in " <<(seconds * 1000.0f) <<" ms  (" <<(megabytes / std::max(seconds, 1e-6f)) <<" MB/s)" <<std::endl;
+        meshes.insert(meshes.end(), std::make_move_iterator(tmpMeshes.begin()), std::make_move_iterator(tmpMeshes.end()));
+        return true;
+    }
+    
+    // Texture path of an image stored inside a glTF file ("<file>#<image>")
+    static bool isEmbeddedImagePath(const std::string& path) {
+        const size_t separator = path.find_last_of('#');
+        return (separator != std::string::npos && path.find('/', separator) == std::string::npos && isGltfPath(path.substr(0, separator)));
+    }
+    
+    // Encoded (PNG / JPEG) bytes of an embedded image. The data is a view into the glTF
+    // file (or its buffers) and keeps them mapped until it is closed.
+    static FileData readEmbeddedImage(const std::string& path) {
+        const size_t separator = path.find_last_of('#');
+        if(separator == std::string::npos) { return FileData(); }
+        std::shared_ptr<Document> doc = std::make_shared<Document>();
+        const std::string filePath = path.substr(0, separator);
+        doc->directory = filePath.substr(0, filePath.find_last_of('/') + 1);
+        doc->file = filePath.substr(doc->directory.size());
+        doc->source = FileSystem::instance().read(filePath);
+        std::string error;
+        BufferData image;
+        if(!doc->source.isOpen() || !readDocument(doc->source.getData(), doc->source.getSize(), *doc, error)
+           || !getImageData(*doc, doc->json["images"][(size_t)std::atoi(path.c_str() + separator + 1)], image, error)) {
+            std::cerr <<" ERROR: reading embedded image " <<path <<(error.empty() ? "" : ": " + error) <<std::endl;
+            return FileData();
+        }
+        return FileData::fromView(image.data, image.size, doc);
+    }
+    
+private:
+    static uint32_t readU32(const byte* p) {
+        uint32_t v;
+        std::memcpy(&v, p, 4);
+        return v;
+    }
+    
+    // JSON (and the binary chunk of a .glb) and all buffers
+    static bool readDocument(const byte* data, size_t size, Document& doc, std::string& error) {
+        BufferData binary;
+        const char* json = reinterpret_cast<const char*>(data);
+        size_t jsonSize = size;
+        if(size >= 12 && readU32(data) == GLB_MAGIC) {
+            if(readU32(data + 4) != 2) { error = "glb version " + std::to_string(readU32(data + 4)); return false; }
+            json = nullptr;
+            for(size_t offset = 12; offset + 8 <= size; ) {
+                const size_t length = readU32(data + offset);
+                const uint32_t type = readU32(data + offset + 4);
+                if(offset + 8 + length > size) { error = "truncated glb chunk"; return false; }
+                if(type == GLB_CHUNK_JSON && json == nullptr) { json = reinterpret_cast<const char*>(data + offset + 8); jsonSize = length; }
+                else if(type == GLB_CHUNK_BIN && binary.data == nullptr) { binary.data = data + offset + 8; binary.size = length; }
+                offset += 8 + ((length + 3) & ~(size_t)3);
+            }
+            if(json == nullptr) { error = "glb without JSON chunk"; return false; }
+        }
+        if(!JsonValue::parse(json, json + jsonSize, doc.json, error)) { return false; }
+        if(doc.json["asset"]["version"].asString().compare(0, 1, "2") != 0) { error = "glTF version " + doc.json["asset"]["version"].asString(); return false; }
+        if(doc.json["extensionsRequired"].size() > 0) { error = "required extension " + doc.json["extensionsRequired"][0].asString(); return false; }
+        
+        const JsonValue& buffers = doc.json["buffers"];
+        doc.files.reserve(doc.files.size() + buffers.size());
+        for(size_t i = 0; i < buffers.size(); i++) {
+            const JsonValue& buffer = buffers[i];
+            const size_t length = (size_t)buffer["byteLength"].asNumber();
+            BufferData tmpBuffer;
+            if(!buffer.has("uri")) {
+                tmpBuffer = binary;
+            } else if(buffer["uri"].asString().compare(0, 5, "data:") == 0) {
+                const std::string& uri = buffer["uri"].asString();
+                const size_t comma = uri.find(',');
+                if(comma == std::string::npos || uri.rfind(";base64", comma) == std::string::npos) { error = "unsupported data URI"; return false; }
+                doc.decoded.push_back(decodeBase64(uri.data() + comma + 1, uri.size() - comma - 1));
+                tmpBuffer.data = doc.decoded.back().data();
+                tmpBuffer.size = doc.decoded.back().size();
+            } else {
+                const std::string bufferPath = doc.directory + decodeUri(buffer["uri"].asString());
+                doc.files.push_back(FileSystem::instance().read(bufferPath));
+                if(!doc.files.back().isOpen()) { error = "missing buffer " + bufferPath; return false; }
+                tmpBuffer.data = doc.files.back().getData();
+                tmpBuffer.size = doc.files.back().getSize();
+            }
+            if(tmpBuffer.size < length) { error = "buffer " + std::to_string(i) + " is too small"; return false; }
+            doc.buffers.push_back(tmpBuffer);
+        }
+        return true;
+    }
+    
+    static bool processNode(const Document& doc, size_t index, const glm::mat4& parent, std::vector<MeshData>& meshes, std::string& error, int depth) {
+        const JsonValue& node = doc.json["nodes"][index];
+        if(!node.isObject() || depth > 64) { error = "invalid node " + std::to_string(index); return false; }
+        const glm::mat4 transform = parent * nodeTransform(node);
+        if(node.has("mesh")) {
+            const JsonValue& primitives = doc.json["meshes"][(size_t)node["mesh"].asInt()]["primitives"];
+            for(size_t i = 0; i < primitives.size(); i++) {
+                MeshData data;
+                if(!processPrimitive(doc, primitives[i], transform, data, error)) { return false; }
+                meshes.push_back(std::move(data));
+            }
+        }
+        const JsonValue& children = node["children"];
+        for(size_t i = 0; i < children.size(); i++) {
+            if(!processNode(doc, (size_t)children[i].asInt(), transform, meshes, error, depth + 1)) { return false; }
+        }
+        return true;
+    }
+    
+    static glm::mat4 nodeTransform(const JsonValue& node) {
+        if(node["matrix"].size() == 16) {
+            float m[16];
+            for(size_t i = 0; i < 16; i++) { m[i] = (float)node["matrix"][i].asNumber(); }
+            return glm::make_mat4(m);
+        }
+        const JsonValue& t = node["translation"];
+        const JsonValue& r = node["rotation"];
+        const JsonValue& s = node["scale"];
+        const glm::vec3 translation((float)t[0].asNumber(), (float)t[1].asNumber(), (float)t[2].asNumber());
+        const glm::quat rotation((float)r[3].asNumber(1.0), (float)r[0].asNumber(), (float)r[1].asNumber(), (float)r[2].asNumber());
+        const glm::vec3 scale((float)s[0].asNumber(1.0), (float)s[1].asNumber(1.0), (float)s[2].asNumber(1.0));
+        return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+    }
+    
+    static Accessor getAccessor(const Document& doc, int index) {
+        Accessor accessor;
+        const JsonValue& json = doc.json["accessors"][(size_t)index];
+        if(!json.isObject() || json.has("sparse")) { return accessor; }
+        static const char* types[] = { "SCALAR", "VEC2", "VEC3", "VEC4" };
+        for(uint i = 0; i < 4; i++) {
+            if(json["type"].asString() == types[i]) { accessor.components = i + 1; }
+        }
+        accessor.count = (size_t)json["count"].asNumber();
+        accessor.componentType = json["componentType"].asInt();
+        accessor.normalized = json["normalized"].asBool();
+        const size_t componentSize = (accessor.componentType == FLOAT || accessor.componentType == UNSIGNED_INT ? 4
+                                      : (accessor.componentType == SHORT || accessor.componentType == UNSIGNED_SHORT ? 2 : 1));
+        const JsonValue& view = doc.json["bufferViews"][(size_t)json["bufferView"].asInt(-1)];
+        if(accessor.components == 0 || !view.isObject()) { accessor.count = 0; return accessor; }
+        const size_t buffer = (size_t)view["buffer"].asInt();
+        const size_t elementSize = componentSize * accessor.components;
+        accessor.stride = (size_t)view["byteStride"].asNumber((double)elementSize);
+        const size_t offset = (size_t)view["byteOffset"].asNumber() + (size_t)json["byteOffset"].asNumber();
+        const size_t length = (size_t)view["byteLength"].asNumber();
+        // Everything must lie within the view and the view within its buffer
+        if(buffer >= doc.buffers.size() || (size_t)view["byteOffset"].asNumber() + length > doc.buffers[buffer].size
+           || (accessor.count > 0 && (size_t)json["byteOffset"].asNumber() + accessor.stride * (accessor.count - 1) + elementSize > length)) {
+            accessor.count = 0;
+            return accessor;
+        }
+        accessor.data = doc.buffers[buffer].data + offset;
+        return accessor;
+    }
+    
+    static bool processPrimitive(const Document& doc, const JsonValue& primitive, const glm::mat4& transform, MeshData& data, std::string& error) {
+        if(primitive["mode"].asInt(4) != 4) { error = "primitive mode " + std::to_string(primitive["mode"].asInt()); return false; }
+        const JsonValue& attributes = primitive["attributes"];
+        const Accessor positions = getAccessor(doc, attributes["POSITION"].asInt(-1));
+        const Accessor normals = getAccessor(doc, attributes["NORMAL"].asInt(-1));
+        const Accessor tangents = getAccessor(doc, attributes["TANGENT"].asInt(-1));
+        const Accessor texcoords = getAccessor(doc, attributes["TEXCOORD_0"].asInt(-1));
+        if(positions.data == nullptr || positions.components != 3) { error = "missing or invalid positions"; return false; }
+        const size_t count = positions.count;
+        const bool hasNormals = (normals.data != nullptr && normals.count == count && normals.components == 3);
+        const bool hasTangents = (tangents.data != nullptr && tangents.count == count && tangents.components >= 3);
+        const bool hasTexcoords = (texcoords.data != nullptr && texcoords.count == count && texcoords.components == 2);
+        
+        // Vertices, transformed into model space
+        const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+        data.vertices.reserve(count);
+        for(size_t i = 0; i < count; i++) {
+            const glm::vec3 position(transform * glm::vec4(positions.get(i, 0), positions.get(i, 1), positions.get(i, 2), 1.0f));
+            const glm::vec3 normal = (hasNormals ? glm::normalize(normalMatrix * glm::vec3(normals.get(i, 0), normals.get(i, 1), normals.get(i, 2))) : glm::vec3(0.0f));
+            const glm::vec2 uv = (hasTexcoords ? glm::vec2(texcoords.get(i, 0), texcoords.get(i, 1)) : glm::vec2(0.0f));
+            data.vertices.push_back(Vertex(position, normal, uv));
+            if(hasTangents) { data.vertices.back().tangent = glm::normalize(glm::mat3(transform) * glm::vec3(tangents.get(i, 0), tangents.get(i, 1), tangents.get(i, 2))); }
+        }
+        // Indices (a mirroring transform flips the winding)
+        if(primitive.has("indices")) {
+            const Accessor indices = getAccessor(doc, primitive["indices"].asInt());
+            if(indices.data == nullptr || indices.components != 1) { error = "invalid indices"; return false; }
+            data.indices.resize(indices.count - indices.count % 3);
+            for(size_t i = 0; i < data.indices.size(); i++) {
+                data.indices[i] = indices.getIndex(i);
+                if(data.indices[i] >= count) { error = "index out of range"; return false; }
+            }
+        } else {
+            data.indices.resize(count - count % 3);
+            for(size_t i = 0; i < data.indices.size(); i++) { data.indices[i] = (uint)i; }
+        }
+        if(glm::determinant(glm::mat3(transform)) < 0.0f) {
+            for(size_t i = 0; i + 2 < data.indices.size(); i += 3) { std::swap(data.indices[i + 1], data.indices[i + 2]); }
+        }
+        if(!hasNormals) { meshopt::computeNormals(data); }
+        if(!hasTangents) { meshopt::computeTangents(data); }
+        data.computeBounds();
+        if(primitive.has("material")) { processMaterial(doc, doc.json["materials"][(size_t)primitive["material"].asInt()], data); }
+        return true;
+    }
+    
+    // Metallic-roughness to Phong: the diffuse part of the base color, the Fresnel reflectance at normal
+    // incidence (4% for dielectrics) with the Blinn-Phong normalization as specular intensity and the
+    // Blinn-Phong exponent that matches the GGX roughness (alpha = roughness^2)
+    static void processMaterial(const Document& doc, const JsonValue& material, MeshData& data) {
+        const JsonValue& pbr = material["pbrMetallicRoughness"];
+        const JsonValue& color = pbr["baseColorFactor"];
+        const float base = (float)(color[0].asNumber(1.0) + color[1].asNumber(1.0) + color[2].asNumber(1.0)) / 3.0f;
+        const float metallic = glm::clamp((float)pbr["metallicFactor"].asNumber(1.0), 0.0f, 1.0f);
+        const float roughness = glm::clamp((float)pbr["roughnessFactor"].asNumber(1.0), 0.05f, 1.0f);
+        const float alpha = roughness * roughness;
+        const float exponent = glm::clamp(2.0f / (alpha * alpha) - 2.0f, 1.0f, 256.0f);
+        data.material.diffuseReflectivity = base * (1.0f - metallic);
+        data.material.ambientReflectivity = data.material.diffuseReflectivity;
+        data.material.spectralReflectivity = glm::min(glm::mix(0.04f, base, metallic) * (exponent + 8.0f) / (8.0f * 3.14159265f), 1.0f);
+        data.material.shineDamper = exponent;
+        data.textureDiffuse = getImagePath(doc, pbr["baseColorTexture"]);
+        data.textureNormal = getImagePath(doc, material["normalTexture"]);
+    }
+    
+    // File name of a texture (relative to the model), "<file>#<image>" for embedded images
+    static std::string getImagePath(const Document& doc, const JsonValue& textureInfo) {
+        if(!textureInfo.isObject()) { return ""; }
+        const JsonValue& texture = doc.json["textures"][(size_t)textureInfo["index"].asInt(-1)];
+        const int index = texture["source"].asInt(-1);
+        const JsonValue& image = doc.json["images"][(size_t)index];
+        const std::string& uri = image["uri"].asString();
+        if(image.has("bufferView") || uri.compare(0, 5, "data:") == 0) { return doc.file + "#" + std::to_string(index); }
+        if(uri.empty()) {
+            std::cerr <<" ERROR: glTF texture " <<textureInfo["index"].asInt() <<" has no image" <<std::endl;
+            return "";
+        }
+        return decodeUri(uri);
+    }
+    
+    // Encoded bytes of an embedded image (a bufferView or a base64 data: URI)
+    static bool getImageData(Document& doc, const JsonValue& image, BufferData& data, std::string& error) {
+        if(!image.isObject()) { error = "no such image"; return false; }
+        if(image.has("bufferView")) {
+            const JsonValue& view = doc.json["bufferViews"][(size_t)image["bufferView"].asInt(-1)];
+            const size_t buffer = (size_t)view["buffer"].asInt(-1);
+            const size_t offset = (size_t)view["byteOffset"].asNumber();
+            const size_t length = (size_t)view["byteLength"].asNumber();
+            if(!view.isObject() || buffer >= doc.buffers.size() || offset > doc.buffers[buffer].size || length > doc.buffers[buffer].size - offset) {
+                error = "invalid bufferView";
+                return false;
+            }
+            data.data = doc.buffers[buffer].data + offset;
+            data.size = length;
+            return true;
+        }
+        const std::string& uri = image["uri"].asString();
+        const size_t comma = uri.find(',');
+        if(uri.compare(0, 5, "data:") != 0 || comma == std::string::npos || uri.rfind(";base64", comma) == std::string::npos) {
+            error = "unsupported image URI";
+            return false;
+        }
+        doc.decoded.push_back(decodeBase64(uri.data() + comma + 1, uri.size() - comma - 1));
+        data.data = doc.decoded.back().data();
+        data.size = doc.decoded.back().size();
+        return true;
+    }
+    
+    static std::string decodeUri(const std::string& uri) {
+        std::string result;
+        for(size_t i = 0; i < uri.size(); i++) {
+            if(uri[i] == '%' && i + 2 < uri.size()) {
+                result.push_back((char)std::strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16));
+                i += 2;
+            } else {
+                result.push_back(uri[i]);
+            }
+        }
+        return result;
+    }
+    
+    static std::vector<byte> decodeBase64(const char* text, size_t length) {
+        std::vector<byte> result;
+        result.reserve(length * 3 / 4);
+        uint32_t bits = 0;
+        int count = 0;
+        for(size_t i = 0; i < length; i++) {
+            const char c = text[i];
+            int value = -1;
+            if(c >= 'A' && c <= 'Z') { value = c - 'A'; }
+            else if(c >= 'a' && c <= 'z') { value = c - 'a' + 26; }
+            else if(c >= '0' && c <= '9') { value = c - '0' + 52; }
+            else if(c == '+' || c == '-') { value = 62; }
+            else if(c == '/' || c == '_') { value = 63; }
+            if(value < 0) { continue; }
+            bits = (bits << 6) | (uint32_t)value;
+            if((count += 6) >= 8) {
+                count -= 8;
+                result.push_back((byte)((bits >> count) & 0xFF));
+            }
+        }
+        return result;
+    }
+    
+};
+
+}
+
+#endif
@@ -1,4 +1,4 @@
-// BasicNoTexShader.h
+//  Hash.h
 /*************************************************************************************
  *  arealGL (OpenGL graphics library)                                                *
  *-----------------------------------------------------------------------------------*
@@ -29,37 +29,30 @@
  *                                                                                   *
  *************************************************************************************/
 
-#ifndef BasicNoTexShader_h
-#define BasicNoTexShader_h
+#ifndef Hash_h
+#define Hash_h
 
-#include "Shader.h"
+#include <string>
+#include <cstdint>
+#include <cstddef>
 
 namespace arealGL {
 
-class BasicNoTexShader : public Shader {
-public:
-    BasicNoTexShader() : Shader(SHADER_BASEPATH + "basicNoTexShader.vert", SHADER_BASEPATH + "basicNoTexShader.frag", true) {
-        // Set the Attributes
-        setAttribute(0, "position");
-        setAttribute(1, "normal");
-        setAttribute(2, "tangent");
-        setAttribute(3, "texCoords");
-        // Set the Uniforms
-        setUniform("u_transform");
-        setUniform("u_projection");
-        setUniform("u_view");
-        setUniform("u_objectColor");
+// 64 bit FNV-1a (content hashes for cache invalidation and de-duplication)
+inline uint64_t hashFNV1a(const void* data, size_t size, uint64_t seed = 14695981039346656037ULL) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+    for(size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
     }
-    
-    void setModelUniforms(const glm::mat4& transform, const glm::mat4& view, const glm::mat4& projection, const Color& color) const override {
-        uniformVec3("u_objectColor", color.getRGB());
-        uniformMat4("u_transform", transform);
-        uniformMat4("u_projection", projection);
-        uniformMat4("u_view", view);
-    }
-    
-};
-    
+    return hash;
+}
+
+inline uint64_t hashFNV1a(const std::string& str, uint64_t seed = 14695981039346656037ULL) {
+    return hashFNV1a(str.data(), str.size(), seed);
+}
+
 }
 
 #endif
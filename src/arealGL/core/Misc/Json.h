@@ -0,0 +1,216 @@
+//  Json.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef Json_h
+#define Json_h
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdlib>
+#include <cstring>
+
+namespace arealGL {
+
+// Minimal JSON document (enough for asset headers like glTF). Missing members and
+// out of range elements return a null value, so lookups can be chained without checks.
+class JsonValue {
+public:
+    enum class Type { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT };
+    
+private:
+    Type type = Type::NUL;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> elements;
+    std::vector<std::pair<std::string, JsonValue>> members;
+    
+    static const JsonValue& null() {
+        static const JsonValue value;
+        return value;
+    }
+    
+public:
+    // Parse a document, false (with a message) on a syntax error
+    static bool parse(const char* begin, const char* end, JsonValue& value, std::string& error) {
+        const char* p = begin;
+        if(!parseValue(p, end, value, error, 0)) { return false; }
+        skipSpace(p, end);
+        if(p != end) { error = "trailing characters"; return false; }
+        return true;
+    }
+    
+    inline Type getType() const { return this->type; }
+    inline bool isNull() const { return (this->type == Type::NUL); }
+    inline bool isNumber() const { return (this->type == Type::NUMBER); }
+    inline bool isString() const { return (this->type == Type::STRING); }
+    inline bool isArray() const { return (this->type == Type::ARRAY); }
+    inline bool isObject() const { return (this->type == Type::OBJECT); }
+    
+    inline bool asBool(bool fallback = false) const { return (this->type == Type::BOOL ? this->boolean : fallback); }
+    inline double asNumber(double fallback = 0.0) const { return (this->type == Type::NUMBER ? this->number : fallback); }
+    inline int asInt(int fallback = 0) const { return (this->type == Type::NUMBER ? (int)this->number : fallback); }
+    inline const std::string& asString() const { return this->string; }
+    
+    // Elements of an array, members of an object
+    inline size_t size() const { return (this->type == Type::ARRAY ? this->elements.size() : this->members.size()); }
+    
+    const JsonValue& operator[](size_t index) const {
+        return (this->type == Type::ARRAY && index < this->elements.size() ? this->elements[index] : null());
+    }
+    
+    inline const JsonValue& operator[](int index) const { return (index < 0 ? null() : (*this)[(size_t)index]); }
+    
+    const JsonValue& operator[](const char* key) const {
+        for(const auto& member : this->members) {
+            if(member.first == key) { return member.second; }
+        }
+        return null();
+    }
+    
+    inline bool has(const char* key) const { return !(*this)[key].isNull(); }
+    inline const std::vector<std::pair<std::string, JsonValue>>& getMembers() const { return this->members; }
+    
+private:
+    static void skipSpace(const char*& p, const char* end) {
+        while(p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) { p++; }
+    }
+    
+    static bool parseValue(const char*& p, const char* end, JsonValue& value, std::string& error, int depth) {
+        skipSpace(p, end);
+        if(p >= end) { error = "unexpected end"; return false; }
+        if(depth > 64) { error = "nesting too deep"; return false; }
+        switch(*p) {
+            case '{': {
+                value.type = Type::OBJECT;
+                p++;
+                skipSpace(p, end);
+                if(p < end && *p == '}') { p++; return true; }
+                while(true) {
+                    std::pair<std::string, JsonValue> member;
+                    skipSpace(p, end);
+                    if(!parseString(p, end, member.first, error)) { return false; }
+                    skipSpace(p, end);
+                    if(p >= end || *p != ':') { error = "expected ':'"; return false; }
+                    p++;
+                    if(!parseValue(p, end, member.second, error, depth + 1)) { return false; }
+                    value.members.push_back(std::move(member));
+                    skipSpace(p, end);
+                    if(p < end && *p == ',') { p++; continue; }
+                    if(p < end && *p == '}') { p++; return true; }
+                    error = "expected ',' or '}'";
+                    return false;
+                }
+            }
+            case '[': {
+                value.type = Type::ARRAY;
+                p++;
+                skipSpace(p, end);
+                if(p < end && *p == ']') { p++; return true; }
+                while(true) {
+                    value.elements.push_back(JsonValue());
+                    if(!parseValue(p, end, value.elements.back(), error, depth + 1)) { return false; }
+                    skipSpace(p, end);
+                    if(p < end && *p == ',') { p++; continue; }
+                    if(p < end && *p == ']') { p++; return true; }
+                    error = "expected ',' or ']'";
+                    return false;
+                }
+            }
+            case '"':
+                value.type = Type::STRING;
+                return parseString(p, end, value.string, error);
+            case 't':
+            case 'f':
+            case 'n': {
+                const char* word = (*p == 't' ? "true" : (*p == 'f' ? "false" : "null"));
+                const size_t length = std::strlen(word);
+                if((size_t)(end - p) < length || std::strncmp(p, word, length) != 0) { error = "invalid literal"; return false; }
+                p += length;
+                value.type = (*word == 'n' ? Type::NUL : Type::BOOL);
+                value.boolean = (*word == 't');
+                return true;
+            }
+            default: {
+                // strtod needs a terminated string, numbers are short
+                char buffer[64];
+                size_t length = 0;
+                while(p + length < end && length < sizeof(buffer) - 1 && std::strchr("+-0123456789.eE", p[length]) != nullptr) { length++; }
+                if(length == 0) { error = "unexpected character"; return false; }
+                std::memcpy(buffer, p, length);
+                buffer[length] = '\0';
+                value.type = Type::NUMBER;
+                value.number = std::strtod(buffer, nullptr);
+                p += length;
+                return true;
+            }
+        }
+    }
+    
+    static bool parseString(const char*& p, const char* end, std::string& string, std::string& error) {
+        if(p >= end || *p != '"') { error = "expected string"; return false; }
+        for(p++; p < end && *p != '"'; p++) {
+            if(*p != '\\') { string.push_back(*p); continue; }
+            if(++p >= end) { break; }
+            switch(*p) {
+                case 'b': string.push_back('\b'); break;
+                case 'f': string.push_back('\f'); break;
+                case 'n': string.push_back('\n'); break;
+                case 'r': string.push_back('\r'); break;
+                case 't': string.push_back('\t'); break;
+                case 'u': {
+                    if(end - p < 5) { error = "invalid escape"; return false; }
+                    const unsigned code = (unsigned)std::strtoul(std::string(p + 1, p + 5).c_str(), nullptr, 16);
+                    p += 4;
+                    // UTF-8 (surrogate pairs are kept as two code points)
+                    if(code < 0x80) { string.push_back((char)code); }
+                    else if(code < 0x800) { string.push_back((char)(0xC0 | (code >> 6))); string.push_back((char)(0x80 | (code & 0x3F))); }
+                    else {
+                        string.push_back((char)(0xE0 | (code >> 12)));
+                        string.push_back((char)(0x80 | ((code >> 6) & 0x3F)));
+                        string.push_back((char)(0x80 | (code & 0x3F)));
+                    }
+                    break;
+                }
+                default: string.push_back(*p); break;
+            }
+        }
+        if(p >= end) { error = "unterminated string"; return false; }
+        p++;
+        return true;
+    }
+    
+};
+
+}
+
+#endif
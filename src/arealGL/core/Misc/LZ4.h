@@ -0,0 +1,163 @@
+//  LZ4.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef LZ4_h
+#define LZ4_h
+
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+#include "Types.h"
+
+namespace arealGL {
+
+// Minimal LZ4 block format codec (compatible with the reference lz4 block format):
+// greedy single probe hash matching for compression, bounds checked decompression.
+namespace lz4 {
+    
+    static const size_t MIN_MATCH = 4;
+    static const size_t LAST_LITERALS = 5;      // the last 5 bytes are always literals
+    static const size_t MF_LIMIT = 12;          // no match may start in the last 12 bytes
+    static const uint HASH_LOG = 16;
+    
+    inline size_t compressBound(size_t size) { return (size + size / 255 + 16); }
+    
+    inline uint32_t read32(const byte* p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+    
+    inline bool writeLength(size_t length, byte* dst, size_t& op, size_t capacity) {
+        while(length >= 255) {
+            if(op >= capacity) { return false; }
+            dst[op++] = 255;
+            length -= 255;
+        }
+        if(op >= capacity) { return false; }
+        dst[op++] = (byte)length;
+        return true;
+    }
+    
+    inline bool writeSequence(const byte* literals, size_t literalLength, size_t offset, size_t matchLength,
+                              byte* dst, size_t& op, size_t capacity) {
+        if(op >= capacity) { return false; }
+        const size_t token = op++;
+        dst[token] = (byte)(std::min<size_t>(literalLength, 15) << 4);
+        if(literalLength >= 15 && !writeLength(literalLength - 15, dst, op, capacity)) { return false; }
+        if(op + literalLength > capacity) { return false; }
+        std::memcpy(dst + op, literals, literalLength);
+        op += literalLength;
+        if(matchLength == 0) { return true; }      // last sequence
+        if(op + 2 > capacity) { return false; }
+        dst[op++] = (byte)(offset & 0xFF);
+        dst[op++] = (byte)(offset >> 8);
+        const size_t code = matchLength - MIN_MATCH;
+        dst[token] |= (byte)std::min<size_t>(code, 15);
+        return (code < 15 || writeLength(code - 15, dst, op, capacity));
+    }
+    
+    // Compress into dst, returns the compressed size (0 if it does not fit)
+    inline size_t compress(const byte* src, size_t size, byte* dst, size_t capacity) {
+        size_t op = 0, anchor = 0, ip = 0;
+        if(size > MF_LIMIT) {
+            std::vector<uint32_t> table((size_t)1 << HASH_LOG, 0);
+            const size_t matchLimit = size - LAST_LITERALS;
+            const size_t mfLimit = size - MF_LIMIT;
+            while(ip < mfLimit) {
+                const uint32_t sequence = read32(src + ip);
+                const uint32_t hash = (sequence * 2654435761u) >> (32 - HASH_LOG);
+                const size_t ref = table[hash];
+                table[hash] = (uint32_t)ip;
+                if(ref < ip && (ip - ref) <= 65535 && read32(src + ref) == sequence) {
+                    size_t matchLength = MIN_MATCH;
+                    while(ip + matchLength < matchLimit && src[ref + matchLength] == src[ip + matchLength]) { matchLength++; }
+                    if(!writeSequence(src + anchor, ip - anchor, ip - ref, matchLength, dst, op, capacity)) { return 0; }
+                    ip += matchLength;
+                    anchor = ip;
+                } else {
+                    ip++;
+                }
+            }
+        }
+        if(!writeSequence(src + anchor, size - anchor, 0, 0, dst, op, capacity)) { return 0; }
+        return op;
+    }
+    
+    // Decompress exactly size bytes into dst, false on corrupt input
+    inline bool decompress(const byte* src, size_t srcSize, byte* dst, size_t size) {
+        size_t ip = 0, op = 0;
+        while(ip < srcSize) {
+            const byte token = src[ip++];
+            size_t literalLength = token >> 4;
+            if(literalLength == 15) {
+                byte b = 0;
+                do {
+                    if(ip >= srcSize) { return false; }
+                    b = src[ip++];
+                    literalLength += b;
+                } while(b == 255);
+            }
+            if(ip + literalLength > srcSize || op + literalLength > size) { return false; }
+            std::memcpy(dst + op, src + ip, literalLength);
+            ip += literalLength;
+            op += literalLength;
+            if(ip >= srcSize) { break; }            // the last sequence has no match
+            if(ip + 2 > srcSize) { return false; }
+            const size_t offset = (size_t)src[ip] | ((size_t)src[ip + 1] << 8);
+            ip += 2;
+            if(offset == 0 || offset > op) { return false; }
+            size_t matchLength = token & 15;
+            if(matchLength == 15) {
+                byte b = 0;
+                do {
+                    if(ip >= srcSize) { return false; }
+                    b = src[ip++];
+                    matchLength += b;
+                } while(b == 255);
+            }
+            matchLength += MIN_MATCH;
+            if(op + matchLength > size) { return false; }
+            // Matches may overlap their own output (offset < length repeats the pattern)
+            if(offset >= matchLength) {
+                std::memcpy(dst + op, dst + op - offset, matchLength);
+            } else {
+                for(size_t i = 0; i < matchLength; i++) { dst[op + i] = dst[op - offset + i]; }
+            }
+            op += matchLength;
+        }
+        return (op == size);
+    }
+    
+}
+
+}
+
+#endif
@@ -39,8 +39,26 @@
 #include <map>
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <algorithm>
 
-#include "Mesh.h"
+#include "Model.h"
+#include "MeshCache.h"
+#include "AssetRegistry.h"
+#include "MeshOptimizer.h"
+#include "ObjParser.h"
+#include "GltfParser.h"
+#include "ThreadPool.h"
+#include "TextureStreamer.h"
+#include "TextureCache.h"
+#include "TextureAtlas.h"
+#include "CompressedTexture.h"
+#include "FileSystem.h"
+#include "AssimpFileSystem.h"
+#include "Hash.h"
 #include "Types.h"
 #include "Config.h"
 
@@ -52,86 +70,380 @@
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#undef STB_IMAGE_IMPLEMENTATION         // later includes only get the declarations
 
 namespace arealGL {
 
+// CPU side image data (RGBA8), as decoded by stb_image
+struct ImageData {
+    int width = 0;
+    int height = 0;
+    std::unique_ptr<byte, void(*)(void*)> pixels { nullptr, stbi_image_free };
+    MipChain mips;                              // replaces the pixels, if built for streaming
+    CompressedTexture compressed;               // pre-compressed (KTX / DDS) textures, instead of the pixels
+    uint64_t hash = 0;                          // content hash of the source file (0 = not readable)
+    std::string path;                           // source file, streamed textures decode their fine levels from it again
+    bool normalMap = false;
+    TextureReference cached;                    // the already uploaded texture of the hash (then nothing is decoded)
+};
+
+
+// State of a model load. Parsing and texture decoding may run on a worker thread,
+// all GL work happens on the render thread.
+struct ModelLoadJob {
+    std::string path;
+    std::string directory;
+    std::string key;                            // AssetRegistry key
+    std::shared_ptr<Model> model;               // handed out right away (holds the placeholder until resident)
+    MeshCache cache;                            // warm start: the geometry is uploaded from the mapping
+    std::vector<MeshData> meshes;               // imported meshes (material and textures only, if cached)
+    std::map<std::string, ImageData> images;    // decoded textures by path
+    std::vector<Mesh> uploaded;
+    std::shared_ptr<GeometryBuffer> buffer;     // geometry of all meshes (MODEL_SHARED_BUFFERS)
+    std::vector<GeometryBuffer::Range> ranges;
+    std::atomic<size_t> pendingImages { 0 };
+    std::atomic<bool> parsed { false };
+    bool failed = false;
+    bool buildMips = false;                     // build the mip chains on the worker (MIP_MAPPING / texture streaming)
+    GeometryRetention retention = GeometryRetention::BOUNDS;
+    
+    explicit ModelLoadJob(const std::string& path)
+    : path(path), directory(path.substr(0, path.find_last_of('/'))) { }
+};
+
+
 class Loader {
 private:
-    std::map<std::string, uint> texturesLoaded;
+    std::shared_ptr<Model> placeholderModel;
+    std::vector<std::shared_ptr<ModelLoadJob>> pendingLoads;
+    std::unique_ptr<ThreadPool> workers;
+    TextureStreamer* textureStreamer = nullptr;
+    TextureAtlas atlas;                         // small diffuse textures of all loaded models
     
 public:
+    Loader() { }
+    Loader(const Loader& rhs) = delete;
+    Loader& operator=(const Loader& rhs) = delete;
+    
+    // Unfinished loads keep their placeholder (the cached models are freed by AssetRegistry::shutdown)
+    ~Loader() {
+        this->workers.reset();
+        for(const std::shared_ptr<ModelLoadJob>& job : this->pendingLoads) { AssetRegistry::instance().setLoaded(job->key); }
+        this->pendingLoads.clear();
+    }
+    
+    // Create textures with only their small mips resident and stream the rest by visibility
+    // (the streamer then also deletes them, once the last Mesh using them is gone)
+    void setTextureStreamer(TextureStreamer* streamer) {
+        this->textureStreamer = streamer;
+        if(streamer != nullptr) {
+            TextureCache::instance().setDeleter([streamer](uint textureID) {
+                if(!streamer->releaseTexture(textureID)) { glDeleteTextures(1, &textureID); }
+            });
+        } else {
+            TextureCache::instance().setDeleter([](uint textureID) { glDeleteTextures(1, &textureID); });
+        }
+    }
+    
     // Load simple, untextured mesh from an .obj File
-    std::shared_ptr<Model> LoadSimpleModelFromFile(const std::string& path) {
-        std::vector<Mesh> meshes;
-        std::vector<Vertex> tmpVertices;
-        std::vector<uint> tmpIndices;
-        // Parse the .obj file data
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs  | aiProcess_CalcTangentSpace);
-        if(scene != nullptr) {
+    std::shared_ptr<Model> LoadSimpleModelFromFile(const std::string& path, GeometryRetention retention = GeometryRetention::BOUNDS) {
+        const std::string key = AssetRegistry::key(path, retention) + "#simple";
+        std::shared_ptr<Model> model = AssetRegistry::instance().find(key);
+        if(model != nullptr) { return model; }
+        MeshData data;
+        std::vector<MeshData> parsed;
+        if(NATIVE_OBJ_PARSER && ObjParser::isObjPath(path) && ObjParser::parse(path, parsed)) {
             // Get only the first mesh
-            const aiMesh* mesh = scene->mMeshes[0];
-            for(uint i = 0; i < mesh->mNumVertices; i++) {
-                Vertex tmpvec;
-                tmpvec.position.x = mesh->mVertices[i].x;
-                tmpvec.position.y = mesh->mVertices[i].y;
-                tmpvec.position.z = mesh->mVertices[i].z;
-                tmpvec.normal.x = mesh->mNormals[i].x;
-                tmpvec.normal.y = mesh->mNormals[i].y;
-                tmpvec.normal.z = mesh->mNormals[i].z;
-                // default values for tangents and texture coords
-                tmpvec.tangent = glm::vec3();
-                tmpvec.texcoords = glm::vec2();
-                tmpVertices.push_back(tmpvec);
-            }
-            // Now retrieve the corresponding vertex indices from the meshs faces
-            for (uint i = 0; i < mesh->mNumFaces; i++) {
-                aiFace face = mesh->mFaces[i];
-                for (uint j = 0; j < face.mNumIndices; j++) {
-                    tmpIndices.push_back(face.mIndices[j]);
+            if(!parsed.empty()) { data = std::move(parsed[0]); }
+        } else {
+            // Parse the .obj file data
+            Assimp::Importer importer;
+            importer.SetIOHandler(new AssimpFileSystem());
+            const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs  | aiProcess_CalcTangentSpace);
+            if(scene != nullptr) {
+                // Get only the first mesh
+                const aiMesh* mesh = scene->mMeshes[0];
+                data.vertices.reserve(mesh->mNumVertices);
+                data.indices.reserve(mesh->mNumFaces * 3);
+                for(uint i = 0; i < mesh->mNumVertices; i++) {
+                    Vertex tmpvec;
+                    tmpvec.position.x = mesh->mVertices[i].x;
+                    tmpvec.position.y = mesh->mVertices[i].y;
+                    tmpvec.position.z = mesh->mVertices[i].z;
+                    tmpvec.normal.x = mesh->mNormals[i].x;
+                    tmpvec.normal.y = mesh->mNormals[i].y;
+                    tmpvec.normal.z = mesh->mNormals[i].z;
+                    // default values for tangents and texture coords
+                    tmpvec.tangent = glm::vec3();
+                    tmpvec.texcoords = glm::vec2();
+                    data.vertices.push_back(tmpvec);
+                }
+                // Now retrieve the corresponding vertex indices from the meshs faces
+                for (uint i = 0; i < mesh->mNumFaces; i++) {
+                    aiFace face = mesh->mFaces[i];
+                    for (uint j = 0; j < face.mNumIndices; j++) {
+                        data.indices.push_back(face.mIndices[j]);
+                    }
                 }
             }
         }
-        meshes.push_back(Mesh(tmpVertices, tmpIndices, Texture(0, 0, 0, ""), (path.substr(0, path.rfind('/')))));
-        return std::make_shared<Model>(meshes);
+        data.computeBounds();
+        data.narrowIndices();
+        std::vector<Mesh> meshes;
+        meshes.push_back(Mesh(std::move(data), Texture(0, 0, 0, ""), (path.substr(0, path.rfind('/'))), retention));
+        return AssetRegistry::instance().insert(key, std::unique_ptr<Model>(new Model(std::move(meshes))));
     }
     
     
     // Load complex Model: multiple Files, multiple Textures and Materials
-    std::shared_ptr<Model> LoadComplexModelFromFile(const std::string& path) {
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-        if(!scene || scene->mFlags == AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-            std::cout <<"ERROR::ASSIMP:: " <<importer.GetErrorString() <<std::endl;
+    // The retention decides what geometry stays in CPU memory after the upload (render only by default)
+    // Models that are already loaded (or loading) are shared through the AssetRegistry
+    std::shared_ptr<Model> LoadComplexModelFromFile(const std::string& path, GeometryRetention retention = GeometryRetention::BOUNDS) {
+        const std::string key = AssetRegistry::key(path, retention);
+        std::shared_ptr<Model> model = AssetRegistry::instance().find(key);
+        if(model != nullptr) {
+            return (this->finishLoad(model) ? model : nullptr);
+        }
+        ModelLoadJob job(path);
+        job.buildMips = (MIP_MAPPING || this->textureStreamer != nullptr);
+        job.retention = retention;
+        if(!importModel(job)) {
             return nullptr;
-        } else {
-            // Retrieve the directory path of the filepath
-            const std::string directory = path.substr(0, path.find_last_of('/'));
-            std::vector<Mesh> tmpMeshes;
+        }
+        // Decode all textures in parallel
+        ThreadPool& pool = this->getWorkers();
+        std::vector<std::future<void>> decodes;
+        for(const auto& texture : collectTexturePaths(job)) {
+            ImageData* image = &job.images[texture.first];
+            const std::string tmpPath = texture.first;
+            const bool buildMips = job.buildMips, normalMap = texture.second;
+            decodes.push_back(pool.enqueue([image, tmpPath, buildMips, normalMap]() { *image = decodeImage(tmpPath, buildMips, normalMap); }));
+        }
+        for(std::future<void>& decode : decodes) { decode.get(); }
+        // Create the loaded Model
+        job.uploaded.reserve(job.meshes.size());
+        while(job.uploaded.size() < job.meshes.size()) {
+            this->uploadMesh(job, job.uploaded.size());
+        }
+        return AssetRegistry::instance().insert(key, std::unique_ptr<Model>(new Model(std::move(job.uploaded))));
+    }
+    
+    
+    // Load complex Model in the background. The returned Model holds the placeholder
+    // (a unit cube by default) and is filled by processUploads() once it is resident.
+    std::shared_ptr<Model> LoadComplexModelAsync(const std::string& path, std::shared_ptr<Model> placeholder = nullptr,
+                                                 GeometryRetention retention = GeometryRetention::BOUNDS) {
+        const std::string key = AssetRegistry::key(path, retention);
+        std::shared_ptr<Model> model = AssetRegistry::instance().find(key);
+        if(model != nullptr) { return model; }
+        ThreadPool* pool = &this->getWorkers();
+        std::shared_ptr<ModelLoadJob> job = std::make_shared<ModelLoadJob>(path);
+        job->key = key;
+        job->model = AssetRegistry::instance().insert(key, std::unique_ptr<Model>(new Model(placeholder ? placeholder : this->getPlaceholderModel())));
+        job->buildMips = (MIP_MAPPING || this->textureStreamer != nullptr);
+        job->retention = retention;
+        this->pendingLoads.push_back(job);
+        // Synchronous loads of the same model (through any Loader) complete this job
+        AssetRegistry::instance().setLoading(key, [this, tmpModel = job->model.get()]() { return this->finishPendingLoad(tmpModel); });
+        // The tasks only get the raw job: pendingLoads owns it and ~Loader joins the workers first,
+        // so the job (and its GL objects) is always released on the render thread
+        pool->enqueue([job = job.get(), pool]() {
+            if(!importModel(*job)) {
+                job->parsed.store(true, std::memory_order_release);
+                return;
+            }
+            // Fan out the texture decodes, the last one to finish marks the job as parsed
+            const std::map<std::string, bool> paths = collectTexturePaths(*job);
+            if(paths.empty()) {
+                job->parsed.store(true, std::memory_order_release);
+                return;
+            }
+            job->pendingImages.store(paths.size());
+            for(const auto& texture : paths) {
+                ImageData* image = &job->images[texture.first];
+                const std::string tmpPath = texture.first;
+                const bool normalMap = texture.second;
+                pool->enqueue([job, image, tmpPath, normalMap]() {
+                    *image = decodeImage(tmpPath, job->buildMips, normalMap);
+                    if(job->pendingImages.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                        job->parsed.store(true, std::memory_order_release);
+                    }
+                });
+            }
+        });
+        return job->model;
+    }
+    
+    // Upload finished background loads (render thread, once per frame). Uploads at least one
+    // mesh with its textures and then continues until the time budget is used up.
+    void processUploads(float budgetMs = ASYNC_UPLOAD_BUDGET_MS) {
+        const auto start = std::chrono::high_resolution_clock::now();
+        bool uploadedAny = false;
+        auto withinBudget = [&start, &uploadedAny, budgetMs]() {
+            return (!uploadedAny || std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count() < budgetMs);
+        };
+        for(auto it = this->pendingLoads.begin(); it != this->pendingLoads.end() && withinBudget(); ) {
+            ModelLoadJob& job = **it;
+            if(!job.parsed.load(std::memory_order_acquire)) { ++it; continue; }
+            // Failed loads keep the placeholder (the error was already reported)
+            if(job.failed) {
+                AssetRegistry::instance().forget(job.key);
+                it = this->pendingLoads.erase(it);
+                continue;
+            }
+            if(job.uploaded.empty()) { job.uploaded.reserve(job.meshes.size()); }
+            while(job.uploaded.size() < job.meshes.size() && withinBudget()) {
+                this->uploadMesh(job, job.uploaded.size());
+                uploadedAny = true;
+            }
+            if(job.uploaded.size() == job.meshes.size()) {
+                job.model->setMeshes(std::move(job.uploaded));
+                AssetRegistry::instance().setLoaded(job.key);
+                it = this->pendingLoads.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    
+    // Complete a background load right away (render thread, also one of another Loader), false if it failed
+    bool finishLoad(const std::shared_ptr<Model>& model) {
+        return AssetRegistry::instance().finishLoad(model.get());
+    }
+    
+    inline bool isLoading() const { return !this->pendingLoads.empty(); }
+    
+    bool isResident(const std::shared_ptr<Model>& model) const {
+        return !AssetRegistry::instance().isLoading(model.get());
+    }
+    
+    // Import the CPU side mesh data of a model with ASSIMP (no GL calls, used by the asset cooker)
+    // OBJ and glTF files are read natively, unless they use features only ASSIMP supports
+    static bool ImportMeshData(const std::string& path, std::vector<MeshData>& meshes, uint extraFlags = 0) {
+        const size_t first = meshes.size();
+        const bool parsed = (NATIVE_OBJ_PARSER && ObjParser::isObjPath(path) && ObjParser::parse(path, meshes))
+                            || (NATIVE_GLTF_PARSER && GltfParser::isGltfPath(path) && GltfParser::parse(path, meshes));
+        if(!parsed) {
+            Assimp::Importer importer;
+            importer.SetIOHandler(new AssimpFileSystem());
+            const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace | extraFlags);
+            if(!scene || scene->mFlags == AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+                std::cout <<"ERROR::ASSIMP:: " <<importer.GetErrorString() <<std::endl;
+                return false;
+            }
             // Process ASSIMP nodes recursively
-            this->processNode(scene->mRootNode, scene, directory, tmpMeshes);
-            // Create the loaded Model
-            return std::make_shared<Model>(tmpMeshes);
+            processNode(scene->mRootNode, scene, meshes);
+        }
+        // Weld the vertices, reorder for the post transform cache, overdraw and vertex fetch
+        // and choose the GPU vertex layout of every mesh
+        meshopt::VertexCacheStats before, after;
+        size_t verticesBefore = 0, verticesAfter = 0, packed = 0;
+        for(size_t i = first; i < meshes.size(); i++) {
+            MeshData& mesh = meshes[i];
+            verticesBefore += mesh.vertices.size();
+            before += meshopt::analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+            if(MESH_WELD) { meshopt::weldVertices(mesh); }
+            if(MESH_OPTIMIZE) { meshopt::optimizeMesh(mesh); }
+            mesh.format = chooseVertexFormat(mesh.vertices, mesh.boundsMin, mesh.boundsMax);
+            after += meshopt::analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+            verticesAfter += mesh.vertices.size();
         }
+        // Meshes of a shared buffer all get its layout and index type, so the cache holds exactly what is uploaded
+        const bool shared = (MODEL_SHARED_BUFFERS && (meshes.size() - first) > 1);
+        const bool allPacked = std::all_of(meshes.begin() + first, meshes.end(), [](const MeshData& mesh) { return (mesh.format == VertexFormat::PACKED); });
+        const bool allShort = std::all_of(meshes.begin() + first, meshes.end(), [](const MeshData& mesh) { return (mesh.vertices.size() <= 65536); });
+        for(size_t i = first; i < meshes.size(); i++) {
+            if(shared && !allPacked) { meshes[i].format = VertexFormat::FLOAT; }
+            if(!shared || allShort) { meshes[i].narrowIndices(); }
+            packed += (meshes[i].format == VertexFormat::PACKED ? 1 : 0);
+        }
+        std::cout <<path <<"  vertices " <<verticesBefore <<" -> " <<verticesAfter <<"  ACMR " <<before.acmr() <<" -> " <<after.acmr()
+                  <<"  ATVR " <<before.atvr() <<" -> " <<after.atvr() <<"  packed " <<packed <<"/" <<(meshes.size() - first) <<std::endl;
+        return true;
     }
     
 private:
-    void processNode(aiNode* node, const aiScene* scene, const std::string& dir, std::vector<Mesh>& meshes) {
+    ThreadPool& getWorkers() {
+        if(this->workers == nullptr) { this->workers.reset(new ThreadPool(LOADER_THREADS)); }
+        return *this->workers;
+    }
+    
+    // Complete one of this Loader's background loads (called through the AssetRegistry)
+    bool finishPendingLoad(const Model* model) {
+        for(auto it = this->pendingLoads.begin(); it != this->pendingLoads.end(); ++it) {
+            ModelLoadJob& job = **it;
+            if(job.model.get() != model) { continue; }
+            while(!job.parsed.load(std::memory_order_acquire)) { std::this_thread::yield(); }
+            if(!job.failed) {
+                if(job.uploaded.empty()) { job.uploaded.reserve(job.meshes.size()); }
+                while(job.uploaded.size() < job.meshes.size()) {
+                    this->uploadMesh(job, job.uploaded.size());
+                }
+                job.model->setMeshes(std::move(job.uploaded));
+                AssetRegistry::instance().setLoaded(job.key);
+            } else {
+                AssetRegistry::instance().forget(job.key);
+            }
+            const bool loaded = !job.failed;
+            this->pendingLoads.erase(it);
+            return loaded;
+        }
+        return true;
+    }
+    
+    // Parse the model (from the mesh cache or with ASSIMP)
+    // No GL calls, so this can run on a worker thread
+    static bool importModel(ModelLoadJob& job) {
+        if(MESH_CACHE && job.cache.open(job.path)) {
+            for(uint i = 0; i < job.cache.getMeshCount(); i++) {
+                job.meshes.push_back(job.cache.getMeshInfo(i));
+            }
+        } else {
+            if(!ImportMeshData(job.path, job.meshes)) {
+                job.failed = true;
+                return false;
+            }
+            // Store the imported data for the next start (packed sources are read only)
+            if(MESH_CACHE && FileSystem::instance().isLooseFile(job.path) && !MeshCache::write(job.path, job.meshes)) {
+                std::cerr <<" ERROR: writing mesh cache " <<MeshCache::cachePath(job.path) <<std::endl;
+            }
+        }
+        return true;
+    }
+    
+    // Add an (empty) image slot for every texture the materials reference and return their paths.
+    // The slots are filled by the decode tasks, so the map itself is not modified concurrently.
+    // Texture paths to decode (path -> used as a normal map)
+    static std::map<std::string, bool> collectTexturePaths(ModelLoadJob& job) {
+        std::map<std::string, bool> paths;
+        for(const MeshData& data : job.meshes) {
+            for(const std::string* name : { &data.textureDiffuse, &data.textureSpecular, &data.textureNormal }) {
+                const std::string tmpPath = resolveTexturePath(job.directory, *name);
+                if(!name->empty() && job.images.find(tmpPath) == job.images.end()) {
+                    paths[tmpPath] |= (name == &data.textureNormal);
+                }
+            }
+        }
+        for(const auto& texture : paths) { job.images[texture.first]; }
+        return paths;
+    }
+    
+    static void processNode(aiNode* node, const aiScene* scene, std::vector<MeshData>& meshes) {
         // Process each mesh located at the current node
         for (uint i = 0; i < node->mNumMeshes; i++) {
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(this->processMesh(mesh, scene, dir));
+            meshes.push_back(processMesh(mesh, scene));
         }
         // After processing the meshes recursively process the childnodes
         for (uint i = 0; i < node->mNumChildren; i++) {
-            this->processNode(node->mChildren[i], scene, dir, meshes);
+            processNode(node->mChildren[i], scene, meshes);
         }
     }
     
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene, const std::string& dir) {
-        std::vector<Vertex> tmpVertices;
-        std::vector<uint> tmpIndices;
-        Texture tmpTexture = Texture(0, 0, 0, "");
+    static MeshData processMesh(aiMesh *mesh, const aiScene *scene) {
+        MeshData data;
+        data.vertices.reserve(mesh->mNumVertices);
+        data.indices.reserve(mesh->mNumFaces * 3);
         // Get all of the mesh's vertices
         for (uint i = 0; i < mesh->mNumVertices; i++) {
             Vertex tmpvec;
@@ -150,79 +462,333 @@ private:
             } else {
                 tmpvec.texcoords = glm::vec2(0.0f, 0.0f);
             }
-            tmpVertices.push_back(tmpvec);
+            data.vertices.push_back(tmpvec);
         }
         // Get all the the mesh's indices (by faces / triangles).
         for (uint i = 0; i < mesh->mNumFaces; i++) {
             aiFace face = mesh->mFaces[i];
             for (uint j = 0; j < face.mNumIndices; j++) {
-                tmpIndices.push_back(face.mIndices[j]);
+                data.indices.push_back(face.mIndices[j]);
             }
         }
+        data.computeBounds();
         // Process materials and textures
         if(mesh->mMaterialIndex >= 0) {
             aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-            // Get the texture data
-            uint textureDiffuse = loadOrGetTexture(material, dir, aiTextureType_DIFFUSE);
-            uint textureSpecular = loadOrGetTexture(material, dir, aiTextureType_SPECULAR);
-            uint textureNormal = loadOrGetTexture(material, dir, aiTextureType_HEIGHT);
+            // Get the texture file names
+            data.textureDiffuse = getTextureName(material, aiTextureType_DIFFUSE);
+            data.textureSpecular = getTextureName(material, aiTextureType_SPECULAR);
+            data.textureNormal = getTextureName(material, aiTextureType_HEIGHT);
             // Get the material reflection values (but store them as a single float)
-            Material tmpMat;
             aiColor3D color (0.f,0.f,0.f);
             material->Get(AI_MATKEY_COLOR_DIFFUSE, color);
-            tmpMat.diffuseReflectivity = (color.r + color.g + color.b) / 3.0f;
+            data.material.diffuseReflectivity = (color.r + color.g + color.b) / 3.0f;
             material->Get(AI_MATKEY_COLOR_SPECULAR, color);
-            tmpMat.spectralReflectivity = (color.r + color.g + color.b) / 3.0f;
+            data.material.spectralReflectivity = (color.r + color.g + color.b) / 3.0f;
             material->Get(AI_MATKEY_COLOR_AMBIENT, color);
-            tmpMat.ambientReflectivity = (color.r + color.g + color.b) / 3.0f;
-            // Create the full Texture object
-            tmpTexture = Texture(textureDiffuse, textureNormal, textureSpecular, tmpMat, dir);
+            data.material.ambientReflectivity = (color.r + color.g + color.b) / 3.0f;
         }
-        // Return a mesh object created from the extracted mesh data
-        return Mesh(tmpVertices, tmpIndices, tmpTexture, dir);
+        return data;
     }
     
-    
-    uint loadOrGetTexture(aiMaterial* material, const std::string& dir, aiTextureType type) {
+    static std::string getTextureName(aiMaterial* material, aiTextureType type) {
         aiString str;
-        uint tmpTex = 0;
         material->GetTexture(type, 0, &str);
-        if(str.length) {
-            const std::string tmpPath = dir + "/" + str.C_Str();
-            // Check if The texture was already loaded and get it, else load it
-            if(texturesLoaded.find(tmpPath) != texturesLoaded.end()) {
-                tmpTex = texturesLoaded[tmpPath];
+        return (str.length ? std::string(str.C_Str()) : std::string());
+    }
+    
+    
+    // Geometry of mesh i, from the mapped cache (in its GPU layout) or the imported data
+    static GeometryData getGeometry(const ModelLoadJob& job, size_t i) {
+        return (job.cache.isOpen() ? job.cache.getGeometry((uint)i) : job.meshes[i].getGeometry());
+    }
+    
+    // Upload the geometry of all meshes into one buffer (render thread). The packed vertex
+    // layout is only used if every mesh chose it, 16 bit indices if every mesh has them.
+    void uploadGeometry(ModelLoadJob& job) {
+        VertexFormat format = VertexFormat::PACKED;
+        bool shortIndices = true;
+        size_t vertexCount = 0, indexCount = 0;
+        job.ranges.resize(job.meshes.size());
+        for(size_t i = 0; i < job.meshes.size(); i++) {
+            GeometryBuffer::Range& range = job.ranges[i];
+            range.baseVertex = (uint)vertexCount;
+            range.firstIndex = (uint)indexCount;
+            const GeometryData geometry = getGeometry(job, i);
+            range.vertexCount = (uint)geometry.vertexCount;
+            range.indexCount = (uint)geometry.indexCount;
+            vertexCount += range.vertexCount;
+            indexCount += range.indexCount;
+            if(job.meshes[i].format != VertexFormat::PACKED) { format = VertexFormat::FLOAT; }
+            if(geometry.indexSize != sizeof(uint16_t)) { shortIndices = false; }
+        }
+        job.buffer = std::make_shared<GeometryBuffer>(format, vertexCount, indexCount, shortIndices);
+        for(size_t i = 0; i < job.meshes.size(); i++) {
+            const GeometryBuffer::Range& range = job.ranges[i];
+            job.buffer->upload(range.baseVertex, range.firstIndex, getGeometry(job, i));
+        }
+    }
+    
+    // Create the GL objects of the next mesh of a parsed model (render thread)
+    void uploadMesh(ModelLoadJob& job, size_t i) {
+        if(MODEL_SHARED_BUFFERS && job.meshes.size() > 1 && job.buffer == nullptr) {
+            this->uploadGeometry(job);
+        }
+        MeshData& data = job.meshes[i];
+        glm::vec4 diffuseTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+        uint textureDiffuse = this->loadOrGetAtlasTexture(data.textureDiffuse, job, i, diffuseTransform);
+        if(textureDiffuse == 0) { textureDiffuse = this->loadOrGetTexture(data.textureDiffuse, job); }
+        const uint textureSpecular = this->loadOrGetTexture(data.textureSpecular, job);
+        const uint textureNormal = this->loadOrGetTexture(data.textureNormal, job, true);
+        Texture tmpTexture = Texture(textureDiffuse, textureNormal, textureSpecular, data.material, job.directory);
+        tmpTexture.setDiffuseTransform(diffuseTransform);
+        if(job.buffer != nullptr) {
+            if(job.cache.isOpen()) {
+                job.uploaded.push_back(Mesh(job.buffer, job.ranges[i], getGeometry(job, i), data.boundsMin, data.boundsMax,
+                                            std::move(tmpTexture), job.directory, job.retention));
             } else {
-                tmpTex = LoadTextureFromFile(tmpPath);
-                texturesLoaded.insert(std::make_pair(tmpPath, tmpTex));
+                job.uploaded.push_back(Mesh(job.buffer, job.ranges[i], std::move(data), std::move(tmpTexture), job.directory, job.retention));
             }
-            return tmpTex;
+        } else if(job.cache.isOpen()) {
+            job.uploaded.push_back(Mesh(job.cache.getGeometry((uint)i), data.boundsMin, data.boundsMax, std::move(tmpTexture), job.directory, job.retention));
         } else {
-            return 0;
+            // The imported data is handed over, not copied (it is not needed after the upload)
+            job.uploaded.push_back(Mesh(std::move(data), std::move(tmpTexture), job.directory, job.retention));
+        }
+    }
+    
+    uint loadOrGetTexture(const std::string& name, ModelLoadJob& job, bool normalMap = false) {
+        if(name.empty()) { return 0; }
+        const std::string tmpPath = resolveTexturePath(job.directory, name);
+        auto image = job.images.find(tmpPath);
+        if(image == job.images.end()) {
+            image = job.images.insert(std::make_pair(tmpPath, decodeImage(tmpPath, job.buildMips, normalMap))).first;
+        }
+        // Content that was already on the GPU at decode time is held by the image until here
+        if(image->second.cached.get() != 0) { return image->second.cached.get(); }
+        // Check if the same content was uploaded since (by any Loader) and get it, else upload it
+        const uint cached = TextureCache::instance().find(image->second.hash);
+        if(cached != 0) { return cached; }
+        const uint tmpTex = this->uploadTexture(image->second);
+        if(image->second.hash != 0 && tmpTex != 0) { TextureCache::instance().insert(image->second.hash, tmpTex); }
+        return tmpTex;
+    }
+    
+    // Diffuse texture of mesh i from an atlas page, if it is small and the mesh UVs do not
+    // wrap (0 if not, then it gets a texture of its own)
+    uint loadOrGetAtlasTexture(const std::string& name, ModelLoadJob& job, size_t i, glm::vec4& transform) {
+        if(!TEXTURE_ATLAS || name.empty() || !hasUnitTexCoords(job, i)) { return 0; }
+        const std::string tmpPath = resolveTexturePath(job.directory, name);
+        auto image = job.images.find(tmpPath);
+        if(image == job.images.end()) {
+            image = job.images.insert(std::make_pair(tmpPath, decodeImage(tmpPath, job.buildMips, false))).first;
+        }
+        const ImageData& data = image->second;
+        if(data.hash == 0) { return 0; }
+        const TextureAtlas::Entry* entry = this->atlas.find(data.hash);
+        if(entry == nullptr) {
+            // Block compressed textures (and ones already uploaded on their own) are not packed
+            TextureAtlas::Entry tmpEntry;
+            if(data.mips.getLevelCount() > 0) {
+                if(!this->atlas.add(data.hash, data.mips, tmpEntry)) { return 0; }
+            } else if(data.pixels != nullptr && TextureAtlas::fits(data.width, data.height)) {
+                if(!this->atlas.add(data.hash, MipChain::build(data.pixels.get(), data.width, data.height), tmpEntry)) { return 0; }
+            } else {
+                return 0;
+            }
+            entry = this->atlas.find(data.hash);
+        }
+        transform = entry->transform;
+        return entry->textureID;
+    }
+    
+    // Atlas textures are clamped to their own rectangle, so UVs must stay in [0, 1]
+    static bool hasUnitTexCoords(const ModelLoadJob& job, size_t i) {
+        const float epsilon = 0.001f;
+        if(job.cache.isOpen()) {
+            const MeshCache::Entry& e = job.cache.getEntry((uint)i);
+            return (e.vertexCount > 0 && e.texcoordsMin[0] >= -epsilon && e.texcoordsMin[1] >= -epsilon
+                    && e.texcoordsMax[0] <= 1.0f + epsilon && e.texcoordsMax[1] <= 1.0f + epsilon);
+        }
+        for(const Vertex& v : job.meshes[i].vertices) {
+            const glm::vec2& uv = v.texcoords;
+            if(uv.x < -epsilon || uv.y < -epsilon || uv.x > 1.0f + epsilon || uv.y > 1.0f + epsilon) { return false; }
         }
+        return !job.meshes[i].vertices.empty();
+    }
+    
+    
+    // Upload all levels of a block compressed texture as they are
+    uint uploadCompressedTexture(const CompressedTexture& tex) const {
+        uint textureID = 0;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        for(uint level = 0; level < tex.getLevelCount(); level++) {
+            const CompressedTexture::Level& data = tex.getLevel(level);
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, blockGLFormat(tex.getFormat()), data.width, data.height, 0, (GLsizei)data.size, data.data);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, tex.getLevelCount() - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        // Compressed textures bring their own mip levels (there is no glGenerateMipmap for them)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (tex.getLevelCount() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        if(ANISOTROPIC_FILTERING) {
+            GLfloat largest_supported_anisotropy;
+            glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &largest_supported_anisotropy);
+            glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, largest_supported_anisotropy);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return textureID;
+    }
+    
+    static bool hasExtension(const char* name) {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for(GLint i = 0; i < count; i++) {
+            const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            if(extension != nullptr && std::strcmp(extension, name) == 0) { return true; }
+        }
+        return false;
+    }
+    
+    
+    // Unit cube, shown while a model is loading in the background
+    std::shared_ptr<Model> getPlaceholderModel() {
+        if(this->placeholderModel == nullptr) {
+            MeshData cube;
+            for(uint f = 0; f < 6; f++) {
+                const glm::vec3 n = glm::vec3((f == 0) - (f == 1), (f == 2) - (f == 3), (f == 4) - (f == 5));
+                const glm::vec3 u = glm::cross((f < 2 ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f)), n);
+                const glm::vec3 v = glm::cross(n, u);
+                const glm::vec2 uv[4] = { glm::vec2(0.0f, 0.0f), glm::vec2(1.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec2(0.0f, 1.0f) };
+                for(uint c = 0; c < 4; c++) {
+                    Vertex tmpvec(0.5f * (n + (uv[c].x * 2.0f - 1.0f) * u + (uv[c].y * 2.0f - 1.0f) * v), n, uv[c]);
+                    tmpvec.tangent = u;
+                    cube.vertices.push_back(tmpvec);
+                }
+                for(uint idx : { 0, 1, 2, 0, 2, 3 }) { cube.indices.push_back(f * 4 + idx); }
+            }
+            cube.computeBounds();
+            this->placeholderModel = std::make_shared<Model>();
+            this->placeholderModel->addMesh(Mesh(std::move(cube), Texture(0, 0, 0, ""), ""));
+        }
+        return this->placeholderModel;
     }
     
 
-    uint LoadTextureFromFile(const std::string& filename) const {
+    // Hash and decode an image file, with its mip chain if buildMips (no GL calls, can run on a worker thread)
+    // Images whose content is already on the GPU are only hashed and keep a reference on that texture
+    static ImageData decodeImage(const std::string& filename, bool buildMips, bool normalMap) {
+        ImageData image;
+        image.path = filename;
+        image.normalMap = normalMap;
+        const FileData file = readImageFile(filename);
+        if(file.getSize() > 0) {
+            image.hash = hashFNV1a(file.getData(), file.getSize());
+            image.cached = TextureReference(TextureCache::instance().findAndAcquire(image.hash));
+            if(image.cached.get() != 0) { return image; }
+            if(CompressedTexture::isCompressedPath(filename)) {
+                if(!image.compressed.open(filename)) { std::cerr <<" ERROR: unsupported compressed texture " <<filename <<std::endl; }
+                return image;
+            }
+            int numComponents = 0;
+            image.pixels.reset(stbi_load_from_memory(file.getData(), (int)file.getSize(), &image.width, &image.height, &numComponents, 4));
+        }
+        if (image.pixels == nullptr) { std::cerr <<" ERROR: loading texture " <<std::endl; }
+        else if(buildMips) {
+            MipOptions options;
+            options.normalMap = normalMap;
+            image.mips = MipChain::build(image.pixels.get(), image.width, image.height, options);
+            image.pixels.reset();
+        }
+        return image;
+    }
+    
+    // Decode an image file into its whole mip chain (the texture streamer reloads fine levels with it)
+    static MipChain decodeMipChain(const std::string& filename, bool normalMap) {
+        const FileData file = readImageFile(filename);
+        int width = 0, height = 0, numComponents = 0;
+        std::unique_ptr<byte, void(*)(void*)> pixels { nullptr, stbi_image_free };
+        if(file.getSize() > 0) { pixels.reset(stbi_load_from_memory(file.getData(), (int)file.getSize(), &width, &height, &numComponents, 4)); }
+        if(pixels == nullptr) {
+            std::cerr <<" ERROR: loading texture " <<filename <<std::endl;
+            return MipChain();
+        }
+        MipOptions options;
+        options.normalMap = normalMap;
+        return MipChain::build(pixels.get(), width, height, options);
+    }
+    
+    // Encoded image of a texture path, images embedded in a glTF file are viewed in place
+    static FileData readImageFile(const std::string& filename) {
+        return (GltfParser::isEmbeddedImagePath(filename) ? GltfParser::readEmbeddedImage(filename) : FileSystem::instance().read(filename));
+    }
+    
+    uint LoadTextureFromFile(const std::string& filename) {
+        ImageData image = decodeImage(filename, MIP_MAPPING, false);
+        return this->uploadTexture(image);
+    }
+    
+    // Texture path of a material texture, a pre-compressed .ktx / .dds next to it is preferred
+    static std::string resolveTexturePath(const std::string& dir, const std::string& name) {
+        const std::string tmpPath = dir + "/" + name;
+        if(COMPRESSED_TEXTURES && !CompressedTexture::isCompressedPath(tmpPath) && !GltfParser::isEmbeddedImagePath(tmpPath)) {
+            const std::string stem = tmpPath.substr(0, tmpPath.find_last_of('.'));
+            for(const char* ext : { ".ktx", ".dds" }) {
+                if(FileSystem::instance().exists(stem + ext)) { return (stem + ext); }
+            }
+        }
+        return tmpPath;
+    }
+    
+    uint uploadTexture(ImageData& image) {
+        if(image.compressed.isValid()) {
+            if(image.compressed.getFormat() == BlockFormat::BC7 && !hasExtension("GL_ARB_texture_compression_bptc")) {
+                std::cerr <<" ERROR: BC7 textures are not supported by the OpenGL driver " <<std::endl;
+                return 0;
+            }
+            // The levels stay in the file mapping, the streamer uploads the fine ones on request
+            if(this->textureStreamer != nullptr) {
+                return this->textureStreamer->createTexture(std::make_shared<CompressedTexture>(std::move(image.compressed)));
+            }
+            return this->uploadCompressedTexture(image.compressed);
+        }
+        if(image.pixels == nullptr && image.mips.getLevelCount() == 0) { return 0; }
+        // Mip chains come from the CPU (usually built at decode), the GPU never generates them
+        if((MIP_MAPPING || this->textureStreamer != nullptr) && image.mips.getLevelCount() == 0) {
+            image.mips = MipChain::build(image.pixels.get(), image.width, image.height);
+            image.pixels.reset();
+        }
+        // Streamed textures only get their small mips now (and keep only those in memory)
+        if(this->textureStreamer != nullptr) {
+            std::function<MipChain()> reload;
+            if(!image.path.empty()) {
+                const std::string tmpPath = image.path;
+                const bool normalMap = image.normalMap;
+                reload = [tmpPath, normalMap]() { return decodeMipChain(tmpPath, normalMap); };
+            }
+            return this->textureStreamer->createTexture(std::move(image.mips), std::move(reload));
+        }
         //Generate texture ID and load texture data
         uint textureID = 0;
         glGenTextures(1, &textureID);
-        // get the texture data with the stb image lib
-        int width = 0, height = 0, numComponents = 0;
-        byte* imageData = stbi_load(filename.c_str(), &width, &height, &numComponents, 4);
-        if (imageData == nullptr) { std::cerr <<" ERROR: loading texture " <<std::endl; }
         // Assign texture to ID
         glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, imageData);
+        if(image.mips.getLevelCount() > 0) {
+            for(uint level = 0; level < image.mips.getLevelCount(); level++) {
+                glTexImage2D(GL_TEXTURE_2D, level, GL_RGB, image.mips.sizes[level].x, image.mips.sizes[level].y, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.mips.levels[level].data());
+            }
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.mips.getLevelCount() - 1);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.get());
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        }
         // Parameters
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        // Activate MipMaping for the Texture
-        if(MIP_MAPPING) {
-            glGenerateMipmap(GL_TEXTURE_2D);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (image.mips.getLevelCount() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         // Activate Anisotropic Filtering for the Texture
         if(ANISOTROPIC_FILTERING) {
             GLfloat largest_supported_anisotropy;
@@ -231,7 +797,6 @@ private:
         }
         // Cleanup
         glBindTexture(GL_TEXTURE_2D, 0);
-        stbi_image_free(imageData);
         return textureID;
     }
     
@@ -0,0 +1,138 @@
+//  MappedFile.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef MappedFile_h
+#define MappedFile_h
+
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Types.h"
+
+namespace arealGL {
+
+struct FileInfo {
+    bool exists = false;
+    uint64_t size = 0;
+    int64_t modified = 0;           // last modification (seconds since epoch)
+};
+
+inline FileInfo getFileInfo(const std::string& path) {
+    FileInfo info;
+    struct stat st;
+    if(stat(path.c_str(), &st) == 0) {
+        info.exists = true;
+        info.size = static_cast<uint64_t>(st.st_size);
+        info.modified = static_cast<int64_t>(st.st_mtime);
+    }
+    return info;
+}
+
+// Create a directory and all missing parents (true if it exists afterwards)
+inline bool createDirectories(const std::string& path) {
+    for(size_t i = 1; i <= path.size(); i++) {
+        if(i == path.size() || path[i] == '/') {
+            const std::string dir = path.substr(0, i);
+            if(mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) { return false; }
+        }
+    }
+    struct stat st;
+    return (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode));
+}
+
+// Per user cache directory (with a trailing '/'), the working directory if HOME is not set
+inline std::string userCacheDirectory() {
+    const char* home = std::getenv("HOME");
+    if(home == nullptr || home[0] == '\0') { return std::string("./"); }
+#ifdef __APPLE__
+    return std::string(home) + "/Library/Caches/";
+#else
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    return (xdg != nullptr && xdg[0] == '/' ? std::string(xdg) + "/" : std::string(home) + "/.cache/");
+#endif
+}
+
+
+// Read only memory mapping of a whole file (unmapped on destruction)
+class MappedFile {
+private:
+    const byte* data = nullptr;
+    size_t size = 0;
+    
+public:
+    MappedFile() { }
+    explicit MappedFile(const std::string& path) { open(path); }
+    MappedFile(const MappedFile& rhs) = delete;
+    MappedFile(MappedFile&& rhs) noexcept : data(rhs.data), size(rhs.size) { rhs.data = nullptr; rhs.size = 0; }
+    MappedFile& operator=(const MappedFile& rhs) = delete;
+    MappedFile& operator=(MappedFile&& rhs) noexcept {
+        if(this != &rhs) { close(); data = rhs.data; size = rhs.size; rhs.data = nullptr; rhs.size = 0; }
+        return *this;
+    }
+    ~MappedFile() { close(); }
+    
+    bool open(const std::string& path) {
+        close();
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0) { return false; }
+        struct stat st;
+        if(fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if(mapping != MAP_FAILED) {
+                data = static_cast<const byte*>(mapping);
+                size = static_cast<size_t>(st.st_size);
+            }
+        }
+        ::close(fd);
+        return (data != nullptr);
+    }
+    
+    void close() {
+        if(data != nullptr) { munmap(const_cast<byte*>(data), size); }
+        data = nullptr;
+        size = 0;
+    }
+    
+    inline bool isOpen() const { return (this->data != nullptr); }
+    inline const byte* getData() const { return this->data; }
+    inline size_t getSize() const { return this->size; }
+    
+};
+
+}
+
+#endif
@@ -0,0 +1,324 @@
+//  MeshCache.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef MeshCache_h
+#define MeshCache_h
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdio>
+#include <cstddef>
+#include <cstring>
+#include <cstdint>
+
+#include "Mesh.h"
+#include "Hash.h"
+#include "Types.h"
+#include "Config.h"
+#include "MappedFile.h"
+#include "FileSystem.h"
+
+namespace arealGL {
+
+// Binary mesh cache, written next to the source model ("<source>.amc")
+// Layout: [Header][Entry x meshCount][string table][vertex / index blobs (16 byte aligned)]
+// The blobs hold the vertices (packed or full precision, see the entry) and indices exactly
+// as they are uploaded to the GPU, so a warm start maps the file and hands the pointers
+// straight to glBufferSubData. The import settings they were built with are part of the header.
+class MeshCache {
+public:
+    static constexpr uint32_t MAGIC = 0x434D4741;        // "AGMC"
+    static constexpr uint32_t VERSION = 3;
+    static constexpr uint32_t NO_STRING = 0xFFFFFFFF;
+    static constexpr uint64_t FLAG_COOKED = 1;           // written by the asset cooker (welded and optimized)
+    
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vertexSize;
+        uint32_t meshCount;
+        uint64_t sourceSize;
+        int64_t sourceModified;
+        uint64_t sourceHash;
+        uint64_t stringsOffset;
+        uint64_t stringsSize;
+        uint64_t flags;
+        uint64_t settings;                  // hash of the import settings (importSettings)
+    };
+    
+    struct Entry {
+        uint64_t vertexOffset;
+        uint64_t indexOffset;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        float boundsMin[3];
+        float boundsMax[3];
+        float material[4];                  // ambient, diffuse, spectral, shineDamper
+        uint32_t textureDiffuse;            // offsets into the string table (or NO_STRING)
+        uint32_t textureSpecular;
+        uint32_t textureNormal;
+        uint32_t vertexFormat;              // GPU layout (VertexFormat) of the vertex blob
+        uint32_t indexSize;                 // 2 or 4 bytes per index
+        float positionOffset[3];            // quantization of packed positions (position * scale + offset)
+        float positionScale[3];
+        float texcoordsMin[2];              // texture coordinate range (the packed ones are not read back)
+        float texcoordsMax[2];
+    };
+    
+private:
+    FileData file;
+    const Header* header = nullptr;
+    const Entry* entries = nullptr;
+    
+public:
+    static std::string cachePath(const std::string& sourcePath) { return sourcePath + MESH_CACHE_EXTENSION; }
+    
+    // Everything that changes the blobs of a source (caches of other settings are stale)
+    static uint64_t importSettings() {
+        const float settings[] = { (float)MESH_WELD, MESH_WELD_EPSILON, (float)MESH_OPTIMIZE, (float)VERTEX_PACKING,
+                                   VERTEX_PACK_MAX_ERROR, VERTEX_PACK_MAX_UV, (float)MODEL_SHARED_BUFFERS };
+        return hashFNV1a(settings, sizeof(settings));
+    }
+    
+    // Read only the header of a cache (no validation against the source)
+    static bool readHeader(const std::string& sourcePath, Header& header) {
+        const FileData file = FileSystem::instance().read(cachePath(sourcePath));
+        if(file.getSize() < sizeof(Header)) { return false; }
+        std::memcpy(&header, file.getData(), sizeof(Header));
+        return (header.magic == MAGIC && header.version == VERSION && header.vertexSize == sizeof(Vertex) && header.settings == importSettings());
+    }
+    
+    // Map the cache of a source file. Fails if it is missing, corrupt or stale
+    // (the source size changed, or its timestamp changed and the content hash differs)
+    // Caches read from a pack are checked against the packed source size only, or
+    // trusted if they were cooked and the source was not packed at all
+    bool open(const std::string& sourcePath) {
+        this->close();
+        const FileSystem& fs = FileSystem::instance();
+        const bool looseSource = fs.isLooseFile(sourcePath);
+        const bool packedSource = (!looseSource && fs.exists(sourcePath));
+        this->file = fs.read(cachePath(sourcePath));
+        if(!this->file.isOpen()) { return false; }
+        const byte* data = this->file.getData();
+        const size_t size = this->file.getSize();
+        if(size < sizeof(Header)) { return this->reject(); }
+        const Header* head = reinterpret_cast<const Header*>(data);
+        if(head->magic != MAGIC || head->version != VERSION || head->vertexSize != sizeof(Vertex)) { return this->reject(); }
+        if(head->settings != importSettings()) { return this->reject(); }
+        if((sizeof(Header) + (uint64_t)head->meshCount * sizeof(Entry)) > size) { return this->reject(); }
+        if((head->stringsOffset + head->stringsSize) > size || (head->stringsSize && data[size_t(head->stringsOffset + head->stringsSize - 1)] != '\0')) { return this->reject(); }
+        // Check if the source was modified since the cache was written
+        if(looseSource) {
+            const FileInfo source = getFileInfo(sourcePath);
+            if(head->sourceSize != source.size) { return this->reject(); }
+            if(head->sourceModified != source.modified) {
+                const MappedFile sourceFile(sourcePath);
+                if(!sourceFile.isOpen() || hashFNV1a(sourceFile.getData(), sourceFile.getSize()) != head->sourceHash) { return this->reject(); }
+                // Same content (e.g. touched or checked out again): store the new timestamp, so the next start does not hash again
+                if(fs.isLooseFile(cachePath(sourcePath))) { updateSourceModified(sourcePath, source.modified); }
+            }
+        } else if(packedSource) {
+            if(head->sourceSize != fs.fileSize(sourcePath)) { return this->reject(); }
+        } else if(!(head->flags & FLAG_COOKED)) {
+            return this->reject();
+        }
+        // Validate the blob ranges
+        const Entry* table = reinterpret_cast<const Entry*>(data + sizeof(Header));
+        for(uint32_t i = 0; i < head->meshCount; i++) {
+            const Entry& e = table[i];
+            if(e.vertexFormat != (uint32_t)VertexFormat::FLOAT && e.vertexFormat != (uint32_t)VertexFormat::PACKED) { return this->reject(); }
+            if((e.vertexOffset + (uint64_t)e.vertexCount * vertexSize((VertexFormat)e.vertexFormat)) > size) { return this->reject(); }
+            if(e.indexSize != sizeof(uint16_t) && e.indexSize != sizeof(uint)) { return this->reject(); }
+            if((e.indexOffset + (uint64_t)e.indexCount * e.indexSize) > size) { return this->reject(); }
+        }
+        this->header = head;
+        this->entries = table;
+        return true;
+    }
+    
+    void close() {
+        this->file.close();
+        this->header = nullptr;
+        this->entries = nullptr;
+    }
+    
+    inline bool isOpen() const { return (this->header != nullptr); }
+    inline uint getMeshCount() const { return (this->header ? this->header->meshCount : 0); }
+    inline const Entry& getEntry(uint i) const { return this->entries[i]; }
+    
+    // Geometry of a mesh in its GPU layout, pointing into the mapping
+    GeometryData getGeometry(uint i) const {
+        const Entry& e = this->entries[i];
+        GeometryData data;
+        data.vertices = this->file.getData() + e.vertexOffset;
+        data.vertexCount = e.vertexCount;
+        data.format = (VertexFormat)e.vertexFormat;
+        data.positionOffset = glm::vec3(e.positionOffset[0], e.positionOffset[1], e.positionOffset[2]);
+        data.positionScale = glm::vec3(e.positionScale[0], e.positionScale[1], e.positionScale[2]);
+        data.indices = this->file.getData() + e.indexOffset;
+        data.indexCount = e.indexCount;
+        data.indexSize = e.indexSize;
+        return data;
+    }
+    inline std::string getString(uint32_t offset) const {
+        if(offset == NO_STRING || offset >= this->header->stringsSize) { return ""; }
+        return std::string(reinterpret_cast<const char*>(this->file.getData() + this->header->stringsOffset + offset));
+    }
+    
+    // Bounds, material and texture names of a mesh (the geometry stays in the mapping)
+    MeshData getMeshInfo(uint i) const {
+        const Entry& e = this->entries[i];
+        MeshData data;
+        data.boundsMin = glm::vec3(e.boundsMin[0], e.boundsMin[1], e.boundsMin[2]);
+        data.boundsMax = glm::vec3(e.boundsMax[0], e.boundsMax[1], e.boundsMax[2]);
+        data.material = { e.material[0], e.material[1], e.material[2], e.material[3] };
+        data.textureDiffuse = this->getString(e.textureDiffuse);
+        data.textureSpecular = this->getString(e.textureSpecular);
+        data.textureNormal = this->getString(e.textureNormal);
+        data.format = (e.vertexFormat == (uint32_t)VertexFormat::PACKED ? VertexFormat::PACKED : VertexFormat::FLOAT);
+        return data;
+    }
+    
+    
+    // Write the cache for a source file (to a temporary file, renamed when complete)
+    static bool write(const std::string& sourcePath, const std::vector<MeshData>& meshes, uint64_t flags = 0) {
+        const MappedFile sourceFile(sourcePath);
+        const FileInfo source = getFileInfo(sourcePath);
+        if(!sourceFile.isOpen() || !source.exists) { return false; }
+        // Build the string table and the mesh table
+        std::string strings;
+        auto addString = [&strings](const std::string& str) -> uint32_t {
+            if(str.empty()) { return NO_STRING; }
+            const uint32_t offset = (uint32_t)strings.size();
+            strings.append(str.c_str(), str.size() + 1);
+            return offset;
+        };
+        std::vector<Entry> table(meshes.size());
+        for(size_t i = 0; i < meshes.size(); i++) {
+            const MeshData& m = meshes[i];
+            Entry& e = table[i];
+            std::memset(&e, 0, sizeof(Entry));
+            e.vertexCount = (uint32_t)m.vertices.size();
+            e.indexCount = (uint32_t)m.getIndexCount();
+            e.indexSize = (uint32_t)m.indexSize;
+            for(int c = 0; c < 3; c++) { e.boundsMin[c] = m.boundsMin[c]; e.boundsMax[c] = m.boundsMax[c]; }
+            e.material[0] = m.material.ambientReflectivity;
+            e.material[1] = m.material.diffuseReflectivity;
+            e.material[2] = m.material.spectralReflectivity;
+            e.material[3] = m.material.shineDamper;
+            e.textureDiffuse = addString(m.textureDiffuse);
+            e.textureSpecular = addString(m.textureSpecular);
+            e.textureNormal = addString(m.textureNormal);
+            e.vertexFormat = (uint32_t)m.format;
+            const GeometryData geometry = m.getGeometry();
+            glm::vec2 texcoordsMin(0.0f), texcoordsMax(0.0f);
+            for(size_t v = 0; v < m.vertices.size(); v++) {
+                texcoordsMin = (v == 0 ? m.vertices[v].texcoords : glm::min(texcoordsMin, m.vertices[v].texcoords));
+                texcoordsMax = (v == 0 ? m.vertices[v].texcoords : glm::max(texcoordsMax, m.vertices[v].texcoords));
+            }
+            for(int c = 0; c < 3; c++) { e.positionOffset[c] = geometry.positionOffset[c]; e.positionScale[c] = geometry.positionScale[c]; }
+            for(int c = 0; c < 2; c++) { e.texcoordsMin[c] = texcoordsMin[c]; e.texcoordsMax[c] = texcoordsMax[c]; }
+        }
+        // Assign the blob offsets
+        Header head;
+        std::memset(&head, 0, sizeof(Header));
+        head.magic = MAGIC;
+        head.version = VERSION;
+        head.vertexSize = sizeof(Vertex);
+        head.meshCount = (uint32_t)meshes.size();
+        head.sourceSize = source.size;
+        head.sourceModified = source.modified;
+        head.sourceHash = hashFNV1a(sourceFile.getData(), sourceFile.getSize());
+        head.stringsOffset = sizeof(Header) + table.size() * sizeof(Entry);
+        head.stringsSize = strings.size();
+        head.flags = flags;
+        head.settings = importSettings();
+        uint64_t offset = align(head.stringsOffset + head.stringsSize);
+        for(size_t i = 0; i < meshes.size(); i++) {
+            table[i].vertexOffset = offset;
+            offset = align(offset + meshes[i].vertices.size() * vertexSize(meshes[i].format));
+            table[i].indexOffset = offset;
+            offset = align(offset + meshes[i].getIndexCount() * meshes[i].indexSize);
+        }
+        // Write everything out
+        const std::string path = cachePath(sourcePath);
+        const std::string tmpPath = path + ".tmp";
+        {
+            std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+            if(!out) { return false; }
+            out.write(reinterpret_cast<const char*>(&head), sizeof(Header));
+            out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(Entry));
+            out.write(strings.data(), strings.size());
+            for(size_t i = 0; i < meshes.size(); i++) {
+                pad(out, table[i].vertexOffset);
+                if(meshes[i].format == VertexFormat::PACKED) {
+                    const GeometryData geometry = meshes[i].getGeometry();
+                    const std::vector<PackedVertex> packed = packVertices(meshes[i].vertices.data(), meshes[i].vertices.size(), geometry.positionOffset, geometry.positionScale);
+                    out.write(reinterpret_cast<const char*>(packed.data()), packed.size() * sizeof(PackedVertex));
+                } else {
+                    out.write(reinterpret_cast<const char*>(meshes[i].vertices.data()), meshes[i].vertices.size() * sizeof(Vertex));
+                }
+                pad(out, table[i].indexOffset);
+                out.write(reinterpret_cast<const char*>(meshes[i].getGeometry().indices), meshes[i].getIndexCount() * meshes[i].indexSize);
+            }
+            if(!out) { std::remove(tmpPath.c_str()); return false; }
+        }
+        return (std::rename(tmpPath.c_str(), path.c_str()) == 0);
+    }
+    
+private:
+    // Rewrite the source timestamp of a cache in place (best effort, the cache may be read only)
+    static void updateSourceModified(const std::string& sourcePath, int64_t modified) {
+        std::fstream out(cachePath(sourcePath), std::ios::binary | std::ios::in | std::ios::out);
+        if(!out) { return; }
+        out.seekp(offsetof(Header, sourceModified));
+        out.write(reinterpret_cast<const char*>(&modified), sizeof(modified));
+    }
+    
+    bool reject() {
+        this->close();
+        return false;
+    }
+    
+    static inline uint64_t align(uint64_t offset) { return ((offset + 15) & ~uint64_t(15)); }
+    
+    static void pad(std::ofstream& out, uint64_t offset) {
+        static const char zeros[16] = { 0 };
+        const uint64_t pos = (uint64_t)out.tellp();
+        if(offset > pos) { out.write(zeros, (std::streamsize)(offset - pos)); }
+    }
+    
+};
+
+}
+
+#endif
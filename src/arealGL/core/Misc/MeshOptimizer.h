@@ -0,0 +1,444 @@
+//  MeshOptimizer.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef MeshOptimizer_h
+#define MeshOptimizer_h
+
+#include <cmath>
+#include <array>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <unordered_map>
+#include <numeric>
+#include <algorithm>
+
+#include "Mesh.h"
+#include "Hash.h"
+#include "Types.h"
+#include "Config.h"
+
+#include <glm.hpp>
+
+namespace arealGL {
+
+// Import time optimization of indexed triangle lists for the GPU:
+//  - welding: vertices with (nearly) equal attributes are merged
+//  - vertex cache: Forsyth's linear speed optimizer (LRU cache score per vertex)
+//  - overdraw: the cache optimized order is cut into clusters that are sorted
+//              front to back from the outside in (Sander et al. / Tipsify)
+//  - vertex fetch: vertices are renumbered in the order they are first used
+// and the normals / tangents importers have to compute themselves
+namespace meshopt {
+    
+    // Post transform cache efficiency of an index buffer (FIFO cache simulation)
+    // ACMR = misses per triangle (0.5 - 3.0), ATVR = misses per referenced vertex (1.0 is optimal)
+    struct VertexCacheStats {
+        size_t misses = 0;
+        size_t triangles = 0;
+        size_t vertices = 0;
+        
+        inline float acmr() const { return (this->triangles ? (float)this->misses / this->triangles : 0.0f); }
+        inline float atvr() const { return (this->vertices ? (float)this->misses / this->vertices : 0.0f); }
+        
+        VertexCacheStats& operator+=(const VertexCacheStats& rhs) {
+            this->misses += rhs.misses;
+            this->triangles += rhs.triangles;
+            this->vertices += rhs.vertices;
+            return *this;
+        }
+    };
+    
+    struct OptimizeStats {
+        VertexCacheStats before;
+        VertexCacheStats after;
+    };
+    
+    inline VertexCacheStats analyzeVertexCache(const uint* indices, size_t indexCount, size_t vertexCount, uint cacheSize = VERTEX_CACHE_SIZE) {
+        VertexCacheStats stats;
+        stats.triangles = indexCount / 3;
+        // A vertex is in the FIFO if it was inserted less than cacheSize misses ago
+        std::vector<size_t> insertTime(vertexCount, 0);
+        size_t time = cacheSize + 1;
+        for(size_t i = 0; i < indexCount; i++) {
+            const uint v = indices[i];
+            if(insertTime[v] == 0) { stats.vertices++; }
+            if(time - insertTime[v] > cacheSize) {
+                insertTime[v] = time++;
+                stats.misses++;
+            }
+        }
+        return stats;
+    }
+    
+    
+    // ------ Welding ------
+    
+    // Position, normal and texture coordinates snapped to an epsilon grid (or their bits for epsilon 0)
+    typedef std::array<int64_t, 8> WeldKey;
+    
+    struct WeldKeyHash {
+        inline size_t operator()(const WeldKey& key) const { return (size_t)hashFNV1a(key.data(), sizeof(WeldKey)); }
+    };
+    
+    inline WeldKey weldKey(const Vertex& v, float epsilon) {
+        const float values[8] = { v.position.x, v.position.y, v.position.z, v.normal.x, v.normal.y, v.normal.z, v.texcoords.x, v.texcoords.y };
+        WeldKey key;
+        for(int i = 0; i < 8; i++) {
+            if(epsilon > 0.0f) {
+                key[i] = (int64_t)std::llround((double)values[i] / epsilon);
+            } else {
+                const float value = values[i] + 0.0f;       // -0 == +0
+                int32_t bits;
+                std::memcpy(&bits, &value, 4);
+                key[i] = bits;
+            }
+        }
+        return key;
+    }
+    
+    // Merge vertices whose attributes differ by less than epsilon and rebuild the indices,
+    // returns the number of removed vertices. Tangents are not compared (ASSIMP computes them
+    // per face for unshared input), the tangents of merged vertices are averaged instead.
+    inline size_t weldVertices(MeshData& mesh, float epsilon = MESH_WELD_EPSILON) {
+        const size_t vertexCount = mesh.vertices.size();
+        std::unordered_map<WeldKey, uint, WeldKeyHash> unique;
+        unique.reserve(vertexCount);
+        std::vector<uint> remap(vertexCount);
+        std::vector<Vertex> welded;
+        welded.reserve(vertexCount);
+        for(size_t i = 0; i < vertexCount; i++) {
+            const Vertex& v = mesh.vertices[i];
+            const auto inserted = unique.insert(std::make_pair(weldKey(v, epsilon), (uint)welded.size()));
+            if(inserted.second) { welded.push_back(v); }
+            else { welded[inserted.first->second].tangent += v.tangent; }
+            remap[i] = inserted.first->second;
+        }
+        if(welded.size() == vertexCount) { return 0; }
+        for(Vertex& v : welded) {
+            const float length = glm::length(v.tangent);
+            if(length > 0.0f) { v.tangent /= length; }
+        }
+        for(uint& index : mesh.indices) { index = remap[index]; }
+        mesh.vertices.swap(welded);
+        return (vertexCount - mesh.vertices.size());
+    }
+    
+    
+    // ------ Vertex cache (Forsyth) ------
+    
+    static const uint FORSYTH_CACHE_SIZE = 32;
+    
+    inline float forsythScore(int cachePosition, uint liveTriangles) {
+        if(liveTriangles == 0) { return -1.0f; }
+        float score = 0.0f;
+        if(cachePosition >= 0) {
+            // The vertices of the last triangle get a fixed score, so it is not reused immediately
+            if(cachePosition < 3) { score = 0.75f; }
+            else { score = std::pow(1.0f - (float)(cachePosition - 3) / (FORSYTH_CACHE_SIZE - 3), 1.5f); }
+        }
+        // Boost vertices with few triangles left, so they are finished off
+        return score + 2.0f / std::sqrt((float)liveTriangles);
+    }
+    
+    inline void optimizeVertexCache(uint* indices, size_t indexCount, size_t vertexCount) {
+        const size_t faceCount = indexCount / 3;
+        if(faceCount == 0) { return; }
+        // Triangle adjacency per vertex (the live triangles are kept at the front of each list)
+        std::vector<uint> liveTriangles(vertexCount, 0);
+        for(size_t i = 0; i < faceCount * 3; i++) { liveTriangles[indices[i]]++; }
+        std::vector<uint> offsets(vertexCount + 1, 0);
+        for(size_t v = 0; v < vertexCount; v++) { offsets[v + 1] = offsets[v] + liveTriangles[v]; }
+        std::vector<uint> adjacency(faceCount * 3);
+        std::vector<uint> fill(offsets.begin(), offsets.end() - 1);
+        for(size_t f = 0; f < faceCount; f++) {
+            for(int k = 0; k < 3; k++) { adjacency[fill[indices[f * 3 + k]]++] = (uint)f; }
+        }
+        
+        std::vector<int> cachePosition(vertexCount, -1);
+        std::vector<float> vertexScore(vertexCount);
+        for(size_t v = 0; v < vertexCount; v++) { vertexScore[v] = forsythScore(-1, liveTriangles[v]); }
+        std::vector<float> triangleScore(faceCount);
+        std::vector<bool> emitted(faceCount, false);
+        for(size_t f = 0; f < faceCount; f++) {
+            triangleScore[f] = vertexScore[indices[f * 3]] + vertexScore[indices[f * 3 + 1]] + vertexScore[indices[f * 3 + 2]];
+        }
+        
+        std::vector<uint> output;
+        output.reserve(faceCount * 3);
+        std::vector<uint> cache, nextCache;
+        cache.reserve(FORSYTH_CACHE_SIZE + 3);
+        nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+        size_t cursor = 0;
+        long best = (long)(std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin());
+        
+        while(best >= 0) {
+            const uint* tri = &indices[best * 3];
+            emitted[best] = true;
+            output.insert(output.end(), tri, tri + 3);
+            // Remove the triangle from the adjacency of its vertices
+            for(int k = 0; k < 3; k++) {
+                const uint v = tri[k];
+                uint* list = &adjacency[offsets[v]];
+                for(uint t = 0; t < liveTriangles[v]; t++) {
+                    if(list[t] == (uint)best) { std::swap(list[t], list[liveTriangles[v] - 1]); break; }
+                }
+                liveTriangles[v]--;
+            }
+            // Move its vertices to the front of the LRU cache
+            nextCache.assign(tri, tri + 3);
+            for(uint v : cache) {
+                if(v != tri[0] && v != tri[1] && v != tri[2]) { nextCache.push_back(v); }
+            }
+            std::swap(cache, nextCache);
+            // Rescore the cached vertices and their live triangles, pick the best candidate
+            best = -1;
+            float bestScore = -1.0f;
+            for(size_t i = 0; i < cache.size(); i++) {
+                const uint v = cache[i];
+                cachePosition[v] = (i < FORSYTH_CACHE_SIZE ? (int)i : -1);
+                const float score = forsythScore(cachePosition[v], liveTriangles[v]);
+                const float delta = score - vertexScore[v];
+                vertexScore[v] = score;
+                for(uint t = 0; t < liveTriangles[v]; t++) {
+                    const uint f = adjacency[offsets[v] + t];
+                    triangleScore[f] += delta;
+                }
+            }
+            for(size_t i = 0; i < cache.size() && i < FORSYTH_CACHE_SIZE; i++) {
+                const uint v = cache[i];
+                for(uint t = 0; t < liveTriangles[v]; t++) {
+                    const uint f = adjacency[offsets[v] + t];
+                    if(triangleScore[f] > bestScore) { bestScore = triangleScore[f]; best = f; }
+                }
+            }
+            if(cache.size() > FORSYTH_CACHE_SIZE) { cache.resize(FORSYTH_CACHE_SIZE); }
+            // Nothing adjacent to the cache is left: continue with the next triangle in input order
+            if(best < 0) {
+                while(cursor < faceCount && emitted[cursor]) { cursor++; }
+                if(cursor < faceCount) { best = (long)cursor; }
+            }
+        }
+        std::copy(output.begin(), output.end(), indices);
+    }
+    
+    
+    // ------ Overdraw ------
+    
+    // Cuts the (cache optimized) triangle order into clusters and sorts them so that triangles
+    // facing away from the mesh center are drawn first. A cut is made where the cache was
+    // effectively reset (hard), or where a fresh start costs less than threshold x the ACMR
+    // of its hard cluster (soft), so the cache efficiency stays within the threshold.
+    inline void optimizeOverdraw(uint* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+                                 float threshold = OVERDRAW_THRESHOLD, uint cacheSize = VERTEX_CACHE_SIZE) {
+        const size_t faceCount = indexCount / 3;
+        if(faceCount < 2) { return; }
+        std::vector<size_t> insertTime(vertexCount, 0);
+        size_t time = cacheSize + 1;
+        auto missCount = [&](const uint* tri) {
+            uint misses = 0;
+            for(int k = 0; k < 3; k++) {
+                if(time - insertTime[tri[k]] > cacheSize) { insertTime[tri[k]] = time++; misses++; }
+            }
+            return misses;
+        };
+        auto resetCache = [&]() { time += cacheSize + 1; };
+        
+        // Hard boundaries: triangles with 3 misses (the cache did not help at all)
+        std::vector<size_t> hard;
+        for(size_t f = 0; f < faceCount; f++) {
+            if(missCount(&indices[f * 3]) == 3) { hard.push_back(f); }
+        }
+        if(hard.empty() || hard[0] != 0) { hard.insert(hard.begin(), 0); }
+        hard.push_back(faceCount);
+        // Soft boundaries inside every hard cluster
+        std::vector<size_t> clusters;
+        for(size_t h = 0; h + 1 < hard.size(); h++) {
+            const size_t begin = hard[h], end = hard[h + 1];
+            resetCache();
+            size_t clusterMisses = 0;
+            for(size_t f = begin; f < end; f++) { clusterMisses += missCount(&indices[f * 3]); }
+            const float limit = threshold * (float)clusterMisses / (float)(end - begin);
+            resetCache();
+            clusters.push_back(begin);
+            size_t misses = 0, start = begin;
+            for(size_t f = begin; f < end; f++) {
+                misses += missCount(&indices[f * 3]);
+                if(f + 1 < end && (float)misses / (float)(f + 1 - start) <= limit && (f + 1 - start) >= 16) {
+                    clusters.push_back(f + 1);
+                    resetCache();
+                    misses = 0;
+                    start = f + 1;
+                }
+            }
+        }
+        clusters.push_back(faceCount);
+        
+        // Sort key: distance of the cluster centroid from the mesh centroid along the cluster normal
+        const size_t clusterCount = clusters.size() - 1;
+        std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f));
+        std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.0f));
+        std::vector<float> areas(clusterCount, 0.0f);
+        glm::vec3 meshCentroid(0.0f);
+        float meshArea = 0.0f;
+        for(size_t c = 0; c < clusterCount; c++) {
+            for(size_t f = clusters[c]; f < clusters[c + 1]; f++) {
+                const glm::vec3& p0 = vertices[indices[f * 3]].position;
+                const glm::vec3& p1 = vertices[indices[f * 3 + 1]].position;
+                const glm::vec3& p2 = vertices[indices[f * 3 + 2]].position;
+                const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                const float area = glm::length(normal);
+                centroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+                normals[c] += normal;
+                areas[c] += area;
+            }
+            meshCentroid += centroids[c];
+            meshArea += areas[c];
+        }
+        if(meshArea > 0.0f) { meshCentroid /= meshArea; }
+        std::vector<float> keys(clusterCount, 0.0f);
+        for(size_t c = 0; c < clusterCount; c++) {
+            if(areas[c] <= 0.0f) { continue; }
+            const float normalLength = glm::length(normals[c]);
+            const glm::vec3 normal = (normalLength > 0.0f ? normals[c] / normalLength : glm::vec3(0.0f));
+            keys[c] = glm::dot(centroids[c] / areas[c] - meshCentroid, normal);
+        }
+        std::vector<size_t> order(clusterCount);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] > keys[b]; });
+        
+        std::vector<uint> output;
+        output.reserve(faceCount * 3);
+        for(size_t c : order) {
+            output.insert(output.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+        }
+        std::copy(output.begin(), output.end(), indices);
+    }
+    
+    
+    // ------ Vertex fetch ------
+    
+    // Renumber the vertices in the order of first use (unreferenced vertices are dropped)
+    inline void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint>& indices) {
+        const uint unused = ~0u;
+        std::vector<uint> remap(vertices.size(), unused);
+        std::vector<Vertex> reordered;
+        reordered.reserve(vertices.size());
+        for(uint& index : indices) {
+            if(remap[index] == unused) {
+                remap[index] = (uint)reordered.size();
+                reordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        vertices.swap(reordered);
+    }
+    
+    
+    // Run all stages on a mesh, returns the cache efficiency before and after
+    inline OptimizeStats optimizeMesh(MeshData& mesh) {
+        OptimizeStats stats;
+        uint* indices = mesh.indices.data();
+        const size_t indexCount = mesh.indices.size() - mesh.indices.size() % 3;
+        stats.before = analyzeVertexCache(indices, indexCount, mesh.vertices.size());
+        optimizeVertexCache(indices, indexCount, mesh.vertices.size());
+        optimizeOverdraw(indices, indexCount, mesh.vertices.data(), mesh.vertices.size());
+        optimizeVertexFetch(mesh.vertices, mesh.indices);
+        stats.after = analyzeVertexCache(mesh.indices.data(), indexCount, mesh.vertices.size());
+        mesh.computeBounds();
+        return stats;
+    }
+    
+    
+    // Area weighted smooth normals (vertices at the same position share them),
+    // only vertices without a normal are changed
+    inline void computeNormals(MeshData& mesh) {
+        std::vector<glm::vec3> normals(mesh.vertices.size(), glm::vec3(0.0f));
+        for(size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+            const glm::vec3& a = mesh.vertices[mesh.indices[i]].position;
+            const glm::vec3& b = mesh.vertices[mesh.indices[i + 1]].position;
+            const glm::vec3& c = mesh.vertices[mesh.indices[i + 2]].position;
+            const glm::vec3 n = glm::cross(b - a, c - a);
+            for(size_t j = 0; j < 3; j++) { normals[mesh.indices[i + j]] += n; }
+        }
+        std::vector<uint> order(mesh.vertices.size());
+        for(size_t i = 0; i < order.size(); i++) { order[i] = (uint)i; }
+        auto less = [&mesh](uint a, uint b) {
+            const glm::vec3& p = mesh.vertices[a].position;
+            const glm::vec3& q = mesh.vertices[b].position;
+            return (p.x != q.x ? p.x < q.x : (p.y != q.y ? p.y < q.y : p.z < q.z));
+        };
+        std::sort(order.begin(), order.end(), less);
+        for(size_t first = 0; first < order.size(); ) {
+            size_t last = first + 1;
+            while(last < order.size() && !less(order[first], order[last])) { last++; }
+            glm::vec3 n(0.0f);
+            for(size_t i = first; i < last; i++) { n += normals[order[i]]; }
+            const float length = glm::length(n);
+            n = (length > 0.0f ? n / length : glm::vec3(0.0f, 1.0f, 0.0f));
+            for(size_t i = first; i < last; i++) {
+                Vertex& v = mesh.vertices[order[i]];
+                if(v.normal == glm::vec3(0.0f)) { v.normal = n; }
+            }
+            first = last;
+        }
+    }
+    
+    // Per vertex tangents from the texture coordinates (like aiProcess_CalcTangentSpace)
+    inline void computeTangents(MeshData& mesh) {
+        std::vector<glm::vec3> tangents(mesh.vertices.size(), glm::vec3(0.0f));
+        for(size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+            const Vertex& a = mesh.vertices[mesh.indices[i]];
+            const Vertex& b = mesh.vertices[mesh.indices[i + 1]];
+            const Vertex& c = mesh.vertices[mesh.indices[i + 2]];
+            const glm::vec3 e1 = b.position - a.position, e2 = c.position - a.position;
+            const glm::vec2 d1 = b.texcoords - a.texcoords, d2 = c.texcoords - a.texcoords;
+            const float det = d1.x * d2.y - d2.x * d1.y;
+            if(std::fabs(det) < 1e-12f) { continue; }
+            const glm::vec3 t = (e1 * d2.y - e2 * d1.y) / det;
+            for(size_t j = 0; j < 3; j++) { tangents[mesh.indices[i + j]] += t; }
+        }
+        for(size_t i = 0; i < mesh.vertices.size(); i++) {
+            Vertex& v = mesh.vertices[i];
+            glm::vec3 t = tangents[i] - v.normal * glm::dot(v.normal, tangents[i]);
+            if(glm::dot(t, t) < 1e-20f) {
+                // No usable texture mapping: any direction perpendicular to the normal
+                t = glm::cross(v.normal, (std::fabs(v.normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f)));
+            }
+            v.tangent = glm::normalize(t);
+        }
+    }
+    
+}
+
+}
+
+#endif
@@ -0,0 +1,364 @@
+//  MipChain.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef MipChain_h
+#define MipChain_h
+
+#include <cmath>
+#include <array>
+#include <vector>
+#include <future>
+#include <algorithm>
+
+#include "Types.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+#include "Config.h"
+
+#include <vec2.hpp>
+
+namespace arealGL {
+
+// Downsampling kernels of the mip generator
+enum class MipFilter {
+    BOX,                // 2x2 average
+    KAISER,             // Kaiser windowed sinc (radius 3, alpha 4), sharp with little ringing
+    LANCZOS             // Lanczos 3, sharpest
+};
+
+struct MipOptions {
+    MipFilter filter = MIP_FILTER;
+    bool srgb = MIP_SRGB;               // color channels are sRGB encoded (filtered in linear space)
+    bool normalMap = false;             // xyz is a normal (never sRGB), renormalized on every level
+    bool wrap = false;                  // the kernel wraps around the edges instead of clamping (tiling textures)
+    ThreadPool* pool = nullptr;         // row bands of each level are spread over it (not from one of its own tasks)
+};
+
+
+namespace mipgen {
+    
+    // sRGB byte -> linear and linear (16 bit steps) -> sRGB byte
+    inline const float* srgbToLinear() {
+        static const std::array<float, 256> table = []() {
+            std::array<float, 256> tmp;
+            for(int i = 0; i < 256; i++) {
+                const float c = i / 255.0f;
+                tmp[i] = (c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f));
+            }
+            return tmp;
+        }();
+        return table.data();
+    }
+    inline const byte* linearToSrgb() {
+        static const std::vector<byte> table = []() {
+            std::vector<byte> tmp(65536);
+            for(int i = 0; i < 65536; i++) {
+                const float c = i / 65535.0f;
+                const float s = (c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f);
+                tmp[i] = (byte)std::lround(std::min(std::max(s, 0.0f), 1.0f) * 255.0f);
+            }
+            return tmp;
+        }();
+        return table.data();
+    }
+    
+    inline float sinc(float x) {
+        if(std::fabs(x) < 1e-6f) { return 1.0f; }
+        const float px = 3.14159265f * x;
+        return std::sin(px) / px;
+    }
+    
+    // Modified Bessel function of the first kind, order 0 (series)
+    inline float bessel0(float x) {
+        float sum = 1.0f, term = 1.0f;
+        for(int k = 1; k < 32 && term > sum * 1e-8f; k++) {
+            term *= (x * x) / (4.0f * k * k);
+            sum += term;
+        }
+        return sum;
+    }
+    
+    inline float radius(MipFilter filter) { return (filter == MipFilter::BOX ? 0.5f : 3.0f); }
+    
+    // Kernel weight at a distance in destination texels
+    inline float kernel(MipFilter filter, float x) {
+        x = std::fabs(x);
+        const float r = radius(filter);
+        if(filter == MipFilter::BOX) { return (x <= r ? 1.0f : 0.0f); }
+        if(x >= r) { return 0.0f; }
+        if(filter == MipFilter::LANCZOS) { return sinc(x) * sinc(x / r); }
+        const float t = x / r;
+        return sinc(x) * bessel0(4.0f * std::sqrt(1.0f - t * t)) / bessel0(4.0f);
+    }
+    
+    // Source texels and weights of every destination texel along one axis
+    struct Taps {
+        int count = 0;                  // per destination texel
+        std::vector<int> index;         // edge clamped / wrapped
+        std::vector<float> weight;      // normalized to a sum of 1
+        
+        Taps(MipFilter filter, int srcSize, int dstSize, bool wrap) {
+            const float scale = (float)srcSize / dstSize;
+            const float support = radius(filter) * scale;
+            this->count = (int)std::ceil(support * 2.0f) + 1;
+            this->index.resize((size_t)dstSize * this->count);
+            this->weight.resize((size_t)dstSize * this->count);
+            for(int j = 0; j < dstSize; j++) {
+                const float center = (j + 0.5f) * scale;
+                const int first = (int)std::floor(center - support);
+                float sum = 0.0f;
+                for(int k = 0; k < this->count; k++) {
+                    const int i = first + k;
+                    const float w = kernel(filter, (i + 0.5f - center) / scale);
+                    this->index[(size_t)j * this->count + k] = (wrap ? ((i % srcSize) + srcSize) % srcSize : std::min(std::max(i, 0), srcSize - 1));
+                    this->weight[(size_t)j * this->count + k] = w;
+                    sum += w;
+                }
+                for(int k = 0; k < this->count; k++) { this->weight[(size_t)j * this->count + k] /= sum; }
+            }
+        }
+    };
+    
+    // Horizontal pass: rows [firstRow, lastRow) of RGBA float texels (one texel is one SSE register)
+    inline void filterRowsScalar(const float* src, int srcWidth, float* dst, int dstWidth, const Taps& taps, int firstRow, int lastRow) {
+        for(int y = firstRow; y < lastRow; y++) {
+            const float* srcRow = src + (size_t)y * srcWidth * 4;
+            float* dstRow = dst + (size_t)y * dstWidth * 4;
+            for(int j = 0; j < dstWidth; j++) {
+                float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+                for(int k = 0; k < taps.count; k++) {
+                    const float w = taps.weight[(size_t)j * taps.count + k];
+                    const float* texel = srcRow + (size_t)taps.index[(size_t)j * taps.count + k] * 4;
+                    for(int c = 0; c < 4; c++) { acc[c] += w * texel[c]; }
+                }
+                std::copy(acc, acc + 4, dstRow + (size_t)j * 4);
+            }
+        }
+    }
+    
+    // Vertical pass: destination rows [firstRow, lastRow), rows of length floats
+    inline void filterColumnsScalar(const float* src, size_t length, float* dst, const Taps& taps, int firstRow, int lastRow, size_t start = 0) {
+        for(int j = firstRow; j < lastRow; j++) {
+            float* dstRow = dst + (size_t)j * length;
+            for(size_t x = start; x < length; x++) {
+                float acc = 0.0f;
+                for(int k = 0; k < taps.count; k++) {
+                    acc += taps.weight[(size_t)j * taps.count + k] * src[(size_t)taps.index[(size_t)j * taps.count + k] * length + x];
+                }
+                dstRow[x] = acc;
+            }
+        }
+    }
+    
+#if AREALGL_SIMD_X86
+    AREALGL_TARGET_SSE inline void filterRowsSSE(const float* src, int srcWidth, float* dst, int dstWidth, const Taps& taps, int firstRow, int lastRow) {
+        for(int y = firstRow; y < lastRow; y++) {
+            const float* srcRow = src + (size_t)y * srcWidth * 4;
+            float* dstRow = dst + (size_t)y * dstWidth * 4;
+            for(int j = 0; j < dstWidth; j++) {
+                const int* index = taps.index.data() + (size_t)j * taps.count;
+                const float* weight = taps.weight.data() + (size_t)j * taps.count;
+                __m128 acc = _mm_setzero_ps();
+                for(int k = 0; k < taps.count; k++) {
+                    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weight[k]), _mm_loadu_ps(srcRow + (size_t)index[k] * 4)));
+                }
+                _mm_storeu_ps(dstRow + (size_t)j * 4, acc);
+            }
+        }
+    }
+    
+    AREALGL_TARGET_SSE inline void filterColumnsSSE(const float* src, size_t length, float* dst, const Taps& taps, int firstRow, int lastRow) {
+        const size_t vectorLength = length & ~(size_t)3;
+        for(int j = firstRow; j < lastRow; j++) {
+            const int* index = taps.index.data() + (size_t)j * taps.count;
+            const float* weight = taps.weight.data() + (size_t)j * taps.count;
+            float* dstRow = dst + (size_t)j * length;
+            for(size_t x = 0; x < vectorLength; x += 4) {
+                __m128 acc = _mm_setzero_ps();
+                for(int k = 0; k < taps.count; k++) {
+                    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weight[k]), _mm_loadu_ps(src + (size_t)index[k] * length + x)));
+                }
+                _mm_storeu_ps(dstRow + x, acc);
+            }
+        }
+        if(vectorLength < length) { filterColumnsScalar(src, length, dst, taps, firstRow, lastRow, vectorLength); }
+    }
+    
+    AREALGL_TARGET_AVX inline void filterColumnsAVX(const float* src, size_t length, float* dst, const Taps& taps, int firstRow, int lastRow) {
+        const size_t vectorLength = length & ~(size_t)7;
+        for(int j = firstRow; j < lastRow; j++) {
+            const int* index = taps.index.data() + (size_t)j * taps.count;
+            const float* weight = taps.weight.data() + (size_t)j * taps.count;
+            float* dstRow = dst + (size_t)j * length;
+            for(size_t x = 0; x < vectorLength; x += 8) {
+                __m256 acc = _mm256_setzero_ps();
+                for(int k = 0; k < taps.count; k++) {
+                    acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(weight[k]), _mm256_loadu_ps(src + (size_t)index[k] * length + x)));
+                }
+                _mm256_storeu_ps(dstRow + x, acc);
+            }
+        }
+        if(vectorLength < length) { filterColumnsScalar(src, length, dst, taps, firstRow, lastRow, vectorLength); }
+    }
+#endif
+    
+    inline void filterRows(const float* src, int srcWidth, float* dst, int dstWidth, const Taps& taps, int firstRow, int lastRow) {
+#if AREALGL_SIMD_X86
+        if(arealGLx::simdLevel() != arealGLx::SimdLevel::SCALAR) { filterRowsSSE(src, srcWidth, dst, dstWidth, taps, firstRow, lastRow); return; }
+#endif
+        filterRowsScalar(src, srcWidth, dst, dstWidth, taps, firstRow, lastRow);
+    }
+    
+    inline void filterColumns(const float* src, size_t length, float* dst, const Taps& taps, int firstRow, int lastRow) {
+#if AREALGL_SIMD_X86
+        if(arealGLx::simdLevel() == arealGLx::SimdLevel::AVX) { filterColumnsAVX(src, length, dst, taps, firstRow, lastRow); return; }
+        if(arealGLx::simdLevel() == arealGLx::SimdLevel::SSE) { filterColumnsSSE(src, length, dst, taps, firstRow, lastRow); return; }
+#endif
+        filterColumnsScalar(src, length, dst, taps, firstRow, lastRow);
+    }
+    
+    // RGBA8 -> float (linear color, or normals in [-1, 1] as the shaders decode them)
+    inline void decodeRows(const byte* src, float* dst, int width, int firstRow, int lastRow, bool srgb, bool normalMap) {
+        const float* table = srgbToLinear();
+        for(size_t i = (size_t)firstRow * width * 4; i < (size_t)lastRow * width * 4; i += 4) {
+            for(int c = 0; c < 3; c++) {
+                dst[i + c] = (normalMap ? src[i + c] / 128.0f - 1.0f : (srgb ? table[src[i + c]] : src[i + c] / 255.0f));
+            }
+            dst[i + 3] = src[i + 3] / 255.0f;
+        }
+    }
+    
+    // Clamp away the kernel overshoot (renormalize normals) in place and encode to RGBA8
+    inline void encodeRows(float* src, byte* dst, int width, int firstRow, int lastRow, bool srgb, bool normalMap) {
+        const byte* table = linearToSrgb();
+        for(size_t i = (size_t)firstRow * width * 4; i < (size_t)lastRow * width * 4; i += 4) {
+            float* texel = src + i;
+            if(normalMap) {
+                for(int c = 0; c < 3; c++) { texel[c] = std::min(std::max(texel[c], -1.0f), 1.0f); }
+                const float length = std::sqrt(texel[0] * texel[0] + texel[1] * texel[1] + texel[2] * texel[2]);
+                if(length > 1e-6f) { for(int c = 0; c < 3; c++) { texel[c] /= length; } }
+                for(int c = 0; c < 3; c++) { dst[i + c] = (byte)std::min(std::lround((texel[c] + 1.0f) * 128.0f), 255L); }
+            } else {
+                for(int c = 0; c < 3; c++) {
+                    texel[c] = std::min(std::max(texel[c], 0.0f), 1.0f);
+                    dst[i + c] = (srgb ? table[std::lround(texel[c] * 65535.0f)] : (byte)std::lround(texel[c] * 255.0f));
+                }
+            }
+            texel[3] = std::min(std::max(texel[3], 0.0f), 1.0f);
+            dst[i + 3] = (byte)std::lround(texel[3] * 255.0f);
+        }
+    }
+    
+    // Run fn(firstRow, lastRow) over all rows, in bands on the pool if there is enough work
+    template <class F>
+    inline void forRows(ThreadPool* pool, int rows, size_t rowWork, F&& fn) {
+        if(pool == nullptr || rows < 8 || (size_t)rows * rowWork < (1 << 16)) {
+            fn(0, rows);
+            return;
+        }
+        const int chunks = (int)pool->getThreadCount() * 4;
+        const int rowsPerChunk = std::max((rows + chunks - 1) / chunks, 1);
+        std::vector<std::future<void>> tasks;
+        for(int row = 0; row < rows; row += rowsPerChunk) {
+            const int last = std::min(row + rowsPerChunk, rows);
+            tasks.push_back(pool->enqueue([&fn, row, last]() { fn(row, last); }));
+        }
+        for(std::future<void>& task : tasks) { task.get(); }
+    }
+    
+}
+
+
+// CPU side mip chain of an RGBA8 image (level 0 = full resolution)
+struct MipChain {
+    std::vector<glm::ivec2> sizes;
+    std::vector<std::vector<byte>> levels;
+    
+    inline uint getLevelCount() const { return (uint)this->levels.size(); }
+    // Size of a level, also of one whose pixels were dropped (RGBA8)
+    inline size_t getLevelBytes(uint level) const { return (size_t)this->sizes[level].x * this->sizes[level].y * 4; }
+    inline bool hasLevel(uint level) const { return !this->levels[level].empty(); }
+    inline void dropLevel(uint level) { std::vector<byte>().swap(this->levels[level]); }
+    
+    static MipChain build(const byte* rgba, int width, int height) { return build(rgba, width, height, MipOptions()); }
+    
+    // All levels down to 1x1. Each level is resampled (separable kernel, SSE / AVX) from the
+    // previous one, kept in linear float so the rounding errors do not add up.
+    static MipChain build(const byte* rgba, int width, int height, const MipOptions& options) {
+        MipChain chain;
+        chain.sizes.push_back(glm::ivec2(width, height));
+        chain.levels.push_back(std::vector<byte>(rgba, rgba + (size_t)width * height * 4));
+        if(width <= 0 || height <= 0) { return chain; }
+        const bool srgb = (options.srgb && !options.normalMap);
+        const bool normalMap = options.normalMap;
+        std::vector<float> current((size_t)width * height * 4), filtered, next;
+        mipgen::forRows(options.pool, height, (size_t)width, [&](int first, int last) {
+            mipgen::decodeRows(rgba, current.data(), width, first, last, srgb, normalMap);
+        });
+        while(width > 1 || height > 1) {
+            const int w = std::max(width >> 1, 1);
+            const int h = std::max(height >> 1, 1);
+            // Horizontal, then vertical (a size of 1 is left as it is)
+            const float* src = current.data();
+            if(w != width) {
+                const mipgen::Taps taps(options.filter, width, w, options.wrap);
+                filtered.resize((size_t)w * height * 4);
+                mipgen::forRows(options.pool, height, (size_t)w * taps.count, [&](int first, int last) {
+                    mipgen::filterRows(current.data(), width, filtered.data(), w, taps, first, last);
+                });
+                src = filtered.data();
+            }
+            next.resize((size_t)w * h * 4);
+            if(h != height) {
+                const mipgen::Taps taps(options.filter, height, h, options.wrap);
+                mipgen::forRows(options.pool, h, (size_t)w * taps.count, [&](int first, int last) {
+                    mipgen::filterColumns(src, (size_t)w * 4, next.data(), taps, first, last);
+                });
+            } else {
+                std::copy(src, src + next.size(), next.begin());
+            }
+            std::vector<byte> level((size_t)w * h * 4);
+            mipgen::forRows(options.pool, h, (size_t)w, [&](int first, int last) {
+                mipgen::encodeRows(next.data(), level.data(), w, first, last, srgb, normalMap);
+            });
+            chain.sizes.push_back(glm::ivec2(w, h));
+            chain.levels.push_back(std::move(level));
+            current.swap(next);
+            width = w;
+            height = h;
+        }
+        return chain;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,494 @@
+//  ObjParser.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef ObjParser_h
+#define ObjParser_h
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#include "Mesh.h"
+#include "FileSystem.h"
+#include "MeshOptimizer.h"
+#include "Types.h"
+#include "Config.h"
+
+#include <glm.hpp>
+
+namespace arealGL {
+
+// Native Wavefront OBJ / MTL reader for large (scanned) models, without the ASSIMP scene conversion.
+// The mapped file is split into chunks at line boundaries that are parsed in parallel:
+//  1. every chunk parses its positions, normals, texture coordinates and (fan triangulated) faces
+//  2. every chunk resolves its faces against the global attribute arrays and builds
+//     de-duplicated vertices per material run
+//  3. the runs are joined into one MeshData per material (normals and tangents are computed,
+//     texture coordinates are flipped like aiProcess_FlipUVs does)
+// Files with features this reader does not handle (lines, points, free-form geometry) are
+// rejected, so the caller can fall back to ASSIMP.
+class ObjParser {
+private:
+    static constexpr int NONE = -1;
+    
+    // Face corner: attribute indices (0 based). Negative OBJ indices are relative to the
+    // attribute count at their line, they are stored relative to the chunk start until resolved.
+    struct Corner {
+        int v = NONE, t = NONE, n = NONE;
+        uint8_t relative = 0;                   // bit 0: v, 1: t, 2: n
+        
+        bool operator==(const Corner& rhs) const { return (v == rhs.v && t == rhs.t && n == rhs.n); }
+    };
+    
+    struct CornerHash {
+        size_t operator()(const Corner& c) const {
+            return (size_t)((uint64_t)(uint32_t)c.v * 0x9E3779B97F4A7C15ull ^ (uint64_t)(uint32_t)c.t * 0xC2B2AE3D27D4EB4Full ^ (uint64_t)(uint32_t)c.n);
+        }
+    };
+    
+    // Vertices and triangles of one material run of a chunk
+    struct Segment {
+        std::string material;
+        std::vector<Vertex> vertices;
+        std::vector<uint> indices;
+        bool missingNormals = false;
+    };
+    
+    struct Chunk {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+        std::vector<glm::vec2> texcoords;
+        std::vector<Corner> corners;            // 3 per triangle
+        std::vector<std::pair<size_t, std::string>> materials;     // usemtl: first corner, name
+        std::vector<std::string> libraries;     // mtllib
+        std::string firstMaterial;              // material at the chunk start (set after pass 1)
+        size_t positionBase = 0, normalBase = 0, texcoordBase = 0;
+        std::vector<Segment> segments;
+        std::string error;                      // unsupported feature or malformed line
+    };
+    
+    struct MaterialInfo {
+        Material material = { 0.0f, 0.0f, 0.0f, 10.0f };
+        std::string textureDiffuse;
+        std::string textureSpecular;
+        std::string textureNormal;
+    };
+    
+public:
+    static bool isObjPath(const std::string& path) {
+        std::string ext = path.substr(path.find_last_of('.') + 1);
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        return (ext == "obj");
+    }
+    
+    // Append one MeshData per material, false (and nothing appended) if the file
+    // can not be read or uses features that are not supported
+    static bool parse(const std::string& path, std::vector<MeshData>& meshes, uint threads = OBJ_PARSER_THREADS) {
+        const auto start = std::chrono::high_resolution_clock::now();
+        const FileData file = FileSystem::instance().read(path);
+        if(!file.isOpen()) { return false; }
+        const char* data = reinterpret_cast<const char*>(file.getData());
+        const size_t size = file.getSize();
+        if(threads == 0) { threads = std::max(std::thread::hardware_concurrency(), 1u); }
+        
+        // Split at line boundaries (small files are parsed in one piece)
+        const size_t chunkCount = std::max<size_t>(std::min<size_t>(size / OBJ_PARSER_MIN_CHUNK, threads * 4), 1);
+        std::vector<Chunk> chunks(chunkCount);
+        const char* begin = data;
+        for(size_t i = 0; i < chunkCount; i++) {
+            const char* end = (i + 1 == chunkCount ? data + size : data + size * (i + 1) / chunkCount);
+            if(end < begin) { end = begin; }
+            while(end < data + size && end[-1] != '\n') { end++; }
+            chunks[i].begin = begin;
+            chunks[i].end = end;
+            begin = end;
+        }
+        threads = (uint)std::min<size_t>(threads, chunkCount);
+        
+        // 1. Parse
+        parallelFor(chunks.size(), threads, [&chunks](size_t i) { parseChunk(chunks[i]); });
+        std::vector<std::string> libraries;
+        std::string material;
+        for(Chunk& chunk : chunks) {
+            if(!chunk.error.empty()) {
+                std::cout <<path <<": " <<chunk.error <<" (not supported by the OBJ reader)" <<std::endl;
+                return false;
+            }
+            chunk.firstMaterial = material;
+            if(!chunk.materials.empty()) { material = chunk.materials.back().second; }
+            libraries.insert(libraries.end(), chunk.libraries.begin(), chunk.libraries.end());
+        }
+        for(size_t i = 1; i < chunks.size(); i++) {
+            chunks[i].positionBase = chunks[i - 1].positionBase + chunks[i - 1].positions.size();
+            chunks[i].normalBase = chunks[i - 1].normalBase + chunks[i - 1].normals.size();
+            chunks[i].texcoordBase = chunks[i - 1].texcoordBase + chunks[i - 1].texcoords.size();
+        }
+        
+        // 2. Build the vertices of every chunk
+        std::atomic<bool> valid { true };
+        parallelFor(chunks.size(), threads, [&chunks, &valid](size_t i) {
+            if(!buildSegments(chunks, chunks[i])) { valid = false; }
+        });
+        if(!valid) {
+            std::cout <<path <<": face index out of range" <<std::endl;
+            return false;
+        }
+        
+        // 3. Join the runs by material (in the order of their first use)
+        std::vector<MeshData> tmpMeshes;
+        std::vector<bool> missingNormals;
+        std::map<std::string, size_t> meshIndex;
+        for(Chunk& chunk : chunks) {
+            for(Segment& segment : chunk.segments) {
+                auto it = meshIndex.find(segment.material);
+                if(it == meshIndex.end()) {
+                    it = meshIndex.insert(std::make_pair(segment.material, tmpMeshes.size())).first;
+                    tmpMeshes.push_back(MeshData());
+                    missingNormals.push_back(false);
+                }
+                MeshData& mesh = tmpMeshes[it->second];
+                const uint base = (uint)mesh.vertices.size();
+                if(mesh.vertices.empty()) {
+                    mesh.vertices = std::move(segment.vertices);
+                } else {
+                    mesh.vertices.reserve(mesh.vertices.size() + segment.vertices.size());
+                    for(const Vertex& v : segment.vertices) { mesh.vertices.push_back(v); }
+                }
+                mesh.indices.reserve(mesh.indices.size() + segment.indices.size());
+                for(uint index : segment.indices) { mesh.indices.push_back(base + index); }
+                missingNormals[it->second] = missingNormals[it->second] || segment.missingNormals;
+                std::vector<Vertex>().swap(segment.vertices);
+                std::vector<uint>().swap(segment.indices);
+            }
+        }
+        
+        // Materials and per mesh attributes
+        const std::string directory = path.substr(0, path.find_last_of('/') + 1);
+        std::map<std::string, MaterialInfo> materials;
+        for(const std::string& library : libraries) { parseMaterials(directory + library, materials); }
+        std::vector<std::string> names(tmpMeshes.size());
+        for(const auto& entry : meshIndex) { names[entry.second] = entry.first; }
+        parallelFor(tmpMeshes.size(), threads, [&](size_t i) {
+            MeshData& mesh = tmpMeshes[i];
+            if(missingNormals[i]) { meshopt::computeNormals(mesh); }
+            meshopt::computeTangents(mesh);
+            mesh.computeBounds();
+            auto material = materials.find(names[i]);
+            if(material != materials.end()) {
+                mesh.material = material->second.material;
+                mesh.textureDiffuse = material->second.textureDiffuse;
+                mesh.textureSpecular = material->second.textureSpecular;
+                mesh.textureNormal = material->second.textureNormal;
+            }
+        });
+        
+        const float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+        const float megabytes = (float)size / (1024.0f * 1024.0f);
+        std::cout <<path <<"  OBJ " <<megabytes <<" MB in " <<(seconds * 1000.0f) <<" ms  (" <<(megabytes / std::max(seconds, 1e-6f))
+                  <<" MB/s, " <<threads <<" threads)" <<std::endl;
+        meshes.insert(meshes.end(), std::make_move_iterator(tmpMeshes.begin()), std::make_move_iterator(tmpMeshes.end()));
+        return true;
+    }
+    
+private:
+    template<typename F>
+    static void parallelFor(size_t count, uint threads, const F& function) {
+        if(threads <= 1 || count <= 1) {
+            for(size_t i = 0; i < count; i++) { function(i); }
+            return;
+        }
+        std::atomic<size_t> next { 0 };
+        auto worker = [&next, count, &function]() {
+            for(size_t i = next++; i < count; i = next++) { function(i); }
+        };
+        std::vector<std::thread> workers;
+        for(uint i = 1; i < std::min<size_t>(threads, count); i++) { workers.emplace_back(worker); }
+        worker();
+        for(std::thread& thread : workers) { thread.join(); }
+    }
+    
+    
+    // Number parsing (no locale, no allocation)
+    
+    static inline const char* skipSpace(const char* p, const char* end) {
+        while(p < end && (*p == ' ' || *p == '\t')) { p++; }
+        return p;
+    }
+    
+    static inline bool isDigit(char c) { return (c >= '0' && c <= '9'); }
+    
+    static float parseFloat(const char*& p, const char* end) {
+        static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                         1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+        p = skipSpace(p, end);
+        const bool negative = (p < end && *p == '-');
+        if(p < end && (*p == '-' || *p == '+')) { p++; }
+        uint64_t mantissa = 0;
+        int exponent = 0, digits = 0;
+        for(; p < end && isDigit(*p); p++) {
+            if(digits < 19) { mantissa = mantissa * 10 + (uint64_t)(*p - '0'); digits += (mantissa != 0); }
+            else { exponent++; }
+        }
+        if(p < end && *p == '.') {
+            for(p++; p < end && isDigit(*p); p++) {
+                if(digits < 19) { mantissa = mantissa * 10 + (uint64_t)(*p - '0'); digits += (mantissa != 0); exponent--; }
+            }
+        }
+        if(p < end && (*p == 'e' || *p == 'E')) {
+            p++;
+            const bool negativeExponent = (p < end && *p == '-');
+            if(p < end && (*p == '-' || *p == '+')) { p++; }
+            int e = 0;
+            for(; p < end && isDigit(*p); p++) { e = std::min(e * 10 + (*p - '0'), 10000); }
+            exponent += (negativeExponent ? -e : e);
+        }
+        double value = (double)mantissa;
+        if(exponent < 0) { value = (exponent >= -22 ? value / powers[-exponent] : value * std::pow(10.0, exponent)); }
+        else if(exponent > 0) { value = (exponent <= 22 ? value * powers[exponent] : value * std::pow(10.0, exponent)); }
+        return (float)(negative ? -value : value);
+    }
+    
+    static inline bool parseInt(const char*& p, const char* end, int& value) {
+        const bool negative = (p < end && *p == '-');
+        if(p < end && (*p == '-' || *p == '+')) { p++; }
+        if(p >= end || !isDigit(*p)) { return false; }
+        int64_t v = 0;
+        for(; p < end && isDigit(*p); p++) { v = std::min<int64_t>(v * 10 + (*p - '0'), INT32_MAX); }
+        value = (int)(negative ? -v : v);
+        return true;
+    }
+    
+    static inline const char* lineEnd(const char* p, const char* end) {
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', (size_t)(end - p)));
+        return (newline != nullptr ? newline : end);
+    }
+    
+    // Rest of the line without surrounding whitespace (names of materials, libraries and textures)
+    static std::string parseName(const char* p, const char* end) {
+        p = skipSpace(p, end);
+        while(end > p && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) { end--; }
+        return std::string(p, end);
+    }
+    
+    // OBJ index (1 based, or negative relative to the current count) to a 0 based index
+    static inline bool resolveIndex(int index, size_t count, int& result, uint8_t& relative, uint8_t bit) {
+        if(index > 0) { result = index - 1; return true; }
+        if(index < 0) { result = (int)count + index; relative |= bit; return true; }
+        return false;
+    }
+    
+    
+    // 1. Parse the lines of a chunk
+    static void parseChunk(Chunk& chunk) {
+        std::vector<Corner> polygon;
+        for(const char* p = chunk.begin; p < chunk.end; ) {
+            const char* end = lineEnd(p, chunk.end);
+            const char* next = (end < chunk.end ? end + 1 : end);
+            if(end > p && end[-1] == '\r') { end--; }
+            p = skipSpace(p, end);
+            if(p == end || *p == '#') { p = next; continue; }
+            if(end[-1] == '\\') { chunk.error = "line continuation"; return; }
+            const char c0 = *p;
+            const char c1 = (p + 1 < end ? p[1] : ' ');
+            const bool keyEnd1 = (c1 == ' ' || c1 == '\t');
+            if(c0 == 'v' && keyEnd1) {
+                glm::vec3 v;
+                p += 1;
+                v.x = parseFloat(p, end); v.y = parseFloat(p, end); v.z = parseFloat(p, end);
+                chunk.positions.push_back(v);
+            } else if(c0 == 'v' && c1 == 'n') {
+                glm::vec3 n;
+                p += 2;
+                n.x = parseFloat(p, end); n.y = parseFloat(p, end); n.z = parseFloat(p, end);
+                chunk.normals.push_back(n);
+            } else if(c0 == 'v' && c1 == 't') {
+                glm::vec2 t;
+                p += 2;
+                t.x = parseFloat(p, end);
+                p = skipSpace(p, end);
+                t.y = (p < end ? parseFloat(p, end) : 0.0f);
+                chunk.texcoords.push_back(glm::vec2(t.x, 1.0f - t.y));
+            } else if(c0 == 'f' && keyEnd1) {
+                polygon.clear();
+                for(p += 1; (p = skipSpace(p, end)) < end; ) {
+                    Corner corner;
+                    int index = 0;
+                    if(!parseInt(p, end, index) || !resolveIndex(index, chunk.positions.size(), corner.v, corner.relative, 1)) {
+                        chunk.error = "malformed face";
+                        return;
+                    }
+                    if(p < end && *p == '/') {
+                        p++;
+                        if(p < end && *p != '/' && parseInt(p, end, index)) { resolveIndex(index, chunk.texcoords.size(), corner.t, corner.relative, 2); }
+                        if(p < end && *p == '/') {
+                            p++;
+                            if(parseInt(p, end, index)) { resolveIndex(index, chunk.normals.size(), corner.n, corner.relative, 4); }
+                        }
+                    }
+                    polygon.push_back(corner);
+                }
+                // Fan triangulation
+                for(size_t i = 2; i < polygon.size(); i++) {
+                    chunk.corners.push_back(polygon[0]);
+                    chunk.corners.push_back(polygon[i - 1]);
+                    chunk.corners.push_back(polygon[i]);
+                }
+            } else {
+                const char* key = p;
+                while(p < end && *p != ' ' && *p != '\t') { p++; }
+                const std::string keyword(key, p);
+                if(keyword == "usemtl") {
+                    chunk.materials.push_back(std::make_pair(chunk.corners.size(), parseName(p, end)));
+                } else if(keyword == "mtllib") {
+                    chunk.libraries.push_back(parseName(p, end));
+                } else if(keyword == "l" || keyword == "p" || keyword == "vp" || keyword == "cstype" || keyword == "curv"
+                          || keyword == "curv2" || keyword == "surf" || keyword == "call") {
+                    chunk.error = "unsupported element '" + keyword + "'";
+                    return;
+                }
+                // o, g, s and the render attributes only affect grouping / smoothing and are ignored
+            }
+            p = next;
+        }
+    }
+    
+    
+    // 2. Resolve the faces of a chunk and build its vertices (de-duplicated within each run)
+    static bool buildSegments(const std::vector<Chunk>& chunks, Chunk& chunk) {
+        const size_t positionCount = chunks.back().positionBase + chunks.back().positions.size();
+        const size_t normalCount = chunks.back().normalBase + chunks.back().normals.size();
+        const size_t texcoordCount = chunks.back().texcoordBase + chunks.back().texcoords.size();
+        auto chunkOf = [&chunks](size_t index, size_t Chunk::*base) {
+            size_t lo = 0, hi = chunks.size();
+            while(hi - lo > 1) {
+                const size_t mid = (lo + hi) / 2;
+                if(chunks[mid].*base <= index) { lo = mid; } else { hi = mid; }
+            }
+            return lo;
+        };
+        auto position = [&](size_t index) { const Chunk& c = chunks[chunkOf(index, &Chunk::positionBase)]; return c.positions[index - c.positionBase]; };
+        auto normal = [&](size_t index) { const Chunk& c = chunks[chunkOf(index, &Chunk::normalBase)]; return c.normals[index - c.normalBase]; };
+        auto texcoord = [&](size_t index) { const Chunk& c = chunks[chunkOf(index, &Chunk::texcoordBase)]; return c.texcoords[index - c.texcoordBase]; };
+        
+        std::unordered_map<Corner, uint, CornerHash> lookup;
+        size_t nextMaterial = 0;
+        std::string material = chunk.firstMaterial;
+        Segment* segment = nullptr;
+        for(size_t i = 0; i < chunk.corners.size(); i++) {
+            if(segment == nullptr || (i % 3 == 0 && nextMaterial < chunk.materials.size() && chunk.materials[nextMaterial].first <= i)) {
+                while(nextMaterial < chunk.materials.size() && chunk.materials[nextMaterial].first <= i) { material = chunk.materials[nextMaterial++].second; }
+                if(segment == nullptr || segment->material != material) {
+                    chunk.segments.push_back(Segment());
+                    segment = &chunk.segments.back();
+                    segment->material = material;
+                    lookup.clear();
+                }
+            }
+            // Global indices
+            Corner corner = chunk.corners[i];
+            if(corner.relative & 1) { corner.v += (int)chunk.positionBase; }
+            if(corner.relative & 2) { corner.t += (int)chunk.texcoordBase; }
+            if(corner.relative & 4) { corner.n += (int)chunk.normalBase; }
+            if(corner.v < 0 || (size_t)corner.v >= positionCount) { return false; }
+            if(corner.t != NONE && (corner.t < 0 || (size_t)corner.t >= texcoordCount)) { return false; }
+            if(corner.n != NONE && (corner.n < 0 || (size_t)corner.n >= normalCount)) { return false; }
+            corner.relative = 0;
+            auto it = lookup.find(corner);
+            if(it == lookup.end()) {
+                it = lookup.insert(std::make_pair(corner, (uint)segment->vertices.size())).first;
+                segment->vertices.push_back(Vertex(position((size_t)corner.v), (corner.n != NONE ? normal((size_t)corner.n) : glm::vec3(0.0f)),
+                                                   (corner.t != NONE ? texcoord((size_t)corner.t) : glm::vec2(0.0f))));
+                segment->missingNormals = segment->missingNormals || (corner.n == NONE);
+            }
+            segment->indices.push_back(it->second);
+        }
+        std::vector<Corner>().swap(chunk.corners);
+        return true;
+    }
+    
+    
+    // The MTL values that map to Material (averaged colors, like the ASSIMP import)
+    static void parseMaterials(const std::string& path, std::map<std::string, MaterialInfo>& materials) {
+        const FileData file = FileSystem::instance().read(path);
+        if(!file.isOpen()) {
+            std::cerr <<" ERROR: loading material library " <<path <<std::endl;
+            return;
+        }
+        const char* data = reinterpret_cast<const char*>(file.getData());
+        const char* fileEnd = data + file.getSize();
+        MaterialInfo* current = nullptr;
+        auto average = [](const char* p, const char* end) {
+            const float r = parseFloat(p, end), g = parseFloat(p, end), b = parseFloat(p, end);
+            return (r + g + b) / 3.0f;
+        };
+        // Texture statements may have options in front of the file name ("-bm 1.0 normal.png")
+        auto textureName = [](const char* p, const char* end) {
+            const std::string name = parseName(p, end);
+            const size_t space = name.find_last_of(" \t");
+            return (space == std::string::npos ? name : name.substr(space + 1));
+        };
+        for(const char* p = data; p < fileEnd; ) {
+            const char* end = lineEnd(p, fileEnd);
+            const char* next = (end < fileEnd ? end + 1 : end);
+            if(end > p && end[-1] == '\r') { end--; }
+            p = skipSpace(p, end);
+            const char* key = p;
+            while(p < end && *p != ' ' && *p != '\t') { p++; }
+            const std::string keyword(key, p);
+            if(keyword == "newmtl") {
+                current = &materials[parseName(p, end)];
+            } else if(current != nullptr) {
+                if(keyword == "Kd") { current->material.diffuseReflectivity = average(p, end); }
+                else if(keyword == "Ks") { current->material.spectralReflectivity = average(p, end); }
+                else if(keyword == "Ka") { current->material.ambientReflectivity = average(p, end); }
+                else if(keyword == "map_Kd") { current->textureDiffuse = textureName(p, end); }
+                else if(keyword == "map_Ks") { current->textureSpecular = textureName(p, end); }
+                else if(keyword == "map_Bump" || keyword == "map_bump" || keyword == "bump") { current->textureNormal = textureName(p, end); }
+            }
+            p = next;
+        }
+    }
+    
+};
+
+}
+
+#endif
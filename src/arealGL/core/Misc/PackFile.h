@@ -0,0 +1,231 @@
+//  PackFile.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef PackFile_h
+#define PackFile_h
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include "LZ4.h"
+#include "Hash.h"
+#include "Types.h"
+#include "MappedFile.h"
+
+namespace arealGL {
+
+// Single file asset archive ("<name>.pak"), read through a memory mapping
+// Layout: [Header][file data (16 byte aligned)][Entry x entryCount][string table]
+// The entries are sorted by the FNV-1a hash of their (relative, '/' separated) path,
+// so a lookup is a binary search. Every entry is either stored or LZ4 compressed;
+// stored entries are handed out as pointers straight into the mapping.
+class PackFile {
+public:
+    static constexpr uint32_t MAGIC = 0x4B504741;        // "AGPK"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t COMPRESSION_NONE = 0;
+    static constexpr uint32_t COMPRESSION_LZ4 = 1;
+    
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t padding;
+        uint64_t indexOffset;
+        uint64_t stringsOffset;
+        uint64_t stringsSize;
+    };
+    
+    struct Entry {
+        uint64_t pathHash;
+        uint64_t offset;
+        uint64_t storedSize;                // size in the pack
+        uint64_t size;                      // uncompressed size
+        uint32_t pathOffset;                // offset into the string table
+        uint32_t compression;
+    };
+    
+    // A file to pack: its path inside the pack and where to read it from
+    struct Source {
+        std::string path;
+        std::string file;
+        bool store = false;                 // never compress (the data is used in place, from the mapping)
+    };
+    
+private:
+    MappedFile file;
+    const Header* header = nullptr;
+    const Entry* entries = nullptr;
+    const char* strings = nullptr;
+    
+public:
+    bool open(const std::string& packPath) {
+        this->close();
+        if(!this->file.open(packPath)) { return false; }
+        const byte* data = this->file.getData();
+        const size_t size = this->file.getSize();
+        if(size < sizeof(Header)) { return this->reject(packPath); }
+        const Header* head = reinterpret_cast<const Header*>(data);
+        if(head->magic != MAGIC || head->version != VERSION) { return this->reject(packPath); }
+        if((head->indexOffset + (uint64_t)head->entryCount * sizeof(Entry)) > size) { return this->reject(packPath); }
+        if((head->stringsOffset + head->stringsSize) > size || (head->stringsSize && data[size_t(head->stringsOffset + head->stringsSize - 1)] != '\0')) { return this->reject(packPath); }
+        const Entry* table = reinterpret_cast<const Entry*>(data + head->indexOffset);
+        for(uint32_t i = 0; i < head->entryCount; i++) {
+            const Entry& e = table[i];
+            if(e.offset > size || e.storedSize > (size - e.offset) || e.pathOffset >= head->stringsSize) { return this->reject(packPath); }
+            if(e.compression != COMPRESSION_NONE && e.compression != COMPRESSION_LZ4) { return this->reject(packPath); }
+            if(e.compression == COMPRESSION_NONE && e.size != e.storedSize) { return this->reject(packPath); }
+        }
+        this->header = head;
+        this->entries = table;
+        this->strings = reinterpret_cast<const char*>(data + head->stringsOffset);
+        return true;
+    }
+    
+    void close() {
+        this->file.close();
+        this->header = nullptr;
+        this->entries = nullptr;
+        this->strings = nullptr;
+    }
+    
+    inline bool isOpen() const { return (this->header != nullptr); }
+    inline uint32_t getEntryCount() const { return (this->header ? this->header->entryCount : 0); }
+    inline const Entry& getEntry(uint32_t i) const { return this->entries[i]; }
+    inline const char* getPath(const Entry& e) const { return (this->strings + e.pathOffset); }
+    
+    // Binary search by hash, then compare the path (hash collisions are adjacent)
+    const Entry* find(const std::string& path) const {
+        if(!this->isOpen()) { return nullptr; }
+        const uint64_t hash = hashFNV1a(path);
+        const Entry* end = this->entries + this->header->entryCount;
+        const Entry* it = std::lower_bound(this->entries, end, hash, [](const Entry& e, uint64_t h) { return e.pathHash < h; });
+        for(; it != end && it->pathHash == hash; ++it) {
+            if(path == this->getPath(*it)) { return it; }
+        }
+        return nullptr;
+    }
+    
+    // Pointer to the data of a stored (uncompressed) entry, nullptr if it is compressed
+    inline const byte* getStoredData(const Entry& e) const {
+        return (e.compression == COMPRESSION_NONE ? (this->file.getData() + e.offset) : nullptr);
+    }
+    
+    // Decompress (or copy) an entry into dst (at least e.size bytes)
+    bool extract(const Entry& e, byte* dst) const {
+        const byte* src = this->file.getData() + e.offset;
+        if(e.compression == COMPRESSION_NONE) {
+            std::memcpy(dst, src, (size_t)e.size);
+            return true;
+        }
+        return lz4::decompress(src, (size_t)e.storedSize, dst, (size_t)e.size);
+    }
+    
+    // Build a pack from a list of files (written to a temporary file first, then renamed)
+    static bool write(const std::string& packPath, const std::vector<Source>& files) {
+        const std::string tempPath = packPath + ".tmp";
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if(!out) { std::cout <<"ERROR::PACKFILE::Cannot write " <<tempPath <<std::endl; return false; }
+        
+        Header head = { MAGIC, VERSION, (uint32_t)files.size(), 0, 0, 0, 0 };
+        out.write(reinterpret_cast<const char*>(&head), sizeof(Header));
+        uint64_t offset = sizeof(Header);
+        std::vector<Entry> table;
+        std::string stringTable;
+        std::vector<byte> compressed;
+        const char zeros[16] = { 0 };
+        for(const Source& source : files) {
+            const MappedFile input(source.file);
+            const FileInfo info = getFileInfo(source.file);
+            if(!input.isOpen() && !(info.exists && info.size == 0)) {
+                std::cout <<"ERROR::PACKFILE::Cannot read " <<source.file <<std::endl;
+                out.close(); std::remove(tempPath.c_str());
+                return false;
+            }
+            Entry e = { hashFNV1a(source.path), offset, 0, input.getSize(), (uint32_t)stringTable.size(), COMPRESSION_NONE };
+            stringTable.append(source.path).push_back('\0');
+            const byte* data = input.getData();
+            size_t dataSize = input.getSize();
+            // Only keep the compressed version if it saves at least ~10%
+            if(dataSize > 0 && !source.store) {
+                compressed.resize(lz4::compressBound(dataSize));
+                const size_t packed = lz4::compress(data, dataSize, compressed.data(), compressed.size());
+                if(packed > 0 && packed < dataSize - dataSize / 10) {
+                    data = compressed.data();
+                    dataSize = packed;
+                    e.compression = COMPRESSION_LZ4;
+                }
+            }
+            e.storedSize = dataSize;
+            out.write(reinterpret_cast<const char*>(data), dataSize);
+            const size_t pad = size_t((16 - ((offset + dataSize) & 15)) & 15);
+            out.write(zeros, pad);
+            offset += dataSize + pad;
+            table.push_back(e);
+        }
+        std::sort(table.begin(), table.end(), [&stringTable](const Entry& a, const Entry& b) {
+            if(a.pathHash != b.pathHash) { return a.pathHash < b.pathHash; }
+            return std::strcmp(&stringTable[a.pathOffset], &stringTable[b.pathOffset]) < 0;
+        });
+        head.indexOffset = offset;
+        head.stringsOffset = offset + table.size() * sizeof(Entry);
+        head.stringsSize = stringTable.size();
+        out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(Entry));
+        out.write(stringTable.data(), stringTable.size());
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&head), sizeof(Header));
+        out.close();
+        if(!out || std::rename(tempPath.c_str(), packPath.c_str()) != 0) {
+            std::remove(tempPath.c_str());
+            std::cout <<"ERROR::PACKFILE::Cannot write " <<packPath <<std::endl;
+            return false;
+        }
+        return true;
+    }
+    
+private:
+    bool reject(const std::string& packPath) {
+        std::cout <<"ERROR::PACKFILE::Invalid pack " <<packPath <<std::endl;
+        this->close();
+        return false;
+    }
+    
+};
+
+}
+
+#endif
@@ -0,0 +1,242 @@
+//  TextureAtlas.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef TextureAtlas_h
+#define TextureAtlas_h
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <climits>
+
+#include "MipChain.h"
+#include "TextureCache.h"
+#include "Types.h"
+#include "Config.h"
+
+#include <vec4.hpp>
+
+namespace arealGL {
+
+// Skyline bottom-left rectangle packer
+class SkylinePacker {
+public:
+    struct Rect {
+        int x = 0, y = 0, width = 0, height = 0;
+    };
+    
+private:
+    struct Segment {
+        int x, y, width;
+    };
+    
+    int width = 0, height = 0;
+    std::vector<Segment> skyline;
+    
+public:
+    SkylinePacker(int width, int height) : width(width), height(height), skyline { { 0, 0, width } } { }
+    
+    // Place a rectangle where its top ends lowest (ties: the narrower gap), false if it does not fit
+    bool insert(int w, int h, Rect& rect) {
+        size_t best = SIZE_MAX;
+        int bestTop = INT_MAX, bestWidth = INT_MAX;
+        for(size_t i = 0; i < this->skyline.size(); i++) {
+            int y = 0;
+            if(!this->fits(i, w, h, y)) { continue; }
+            if(y + h < bestTop || (y + h == bestTop && this->skyline[i].width < bestWidth)) {
+                best = i;
+                bestTop = y + h;
+                bestWidth = this->skyline[i].width;
+                rect.x = this->skyline[i].x;
+                rect.y = y;
+            }
+        }
+        if(best == SIZE_MAX) { return false; }
+        rect.width = w;
+        rect.height = h;
+        this->addLevel(best, rect);
+        return true;
+    }
+    
+private:
+    // Height at which a rectangle starting at segment i rests on the skyline
+    bool fits(size_t i, int w, int h, int& y) const {
+        if(this->skyline[i].x + w > this->width) { return false; }
+        y = 0;
+        for(int remaining = w; remaining > 0; i++) {
+            if(i >= this->skyline.size()) { return false; }
+            y = std::max(y, this->skyline[i].y);
+            if(y + h > this->height) { return false; }
+            remaining -= this->skyline[i].width;
+        }
+        return true;
+    }
+    
+    void addLevel(size_t index, const Rect& rect) {
+        this->skyline.insert(this->skyline.begin() + index, Segment { rect.x, rect.y + rect.height, rect.width });
+        // Shrink or remove the segments now covered by the new one
+        for(size_t i = index + 1; i < this->skyline.size(); ) {
+            Segment& segment = this->skyline[i];
+            const int right = this->skyline[i - 1].x + this->skyline[i - 1].width;
+            if(segment.x >= right) { break; }
+            const int shrink = right - segment.x;
+            segment.x += shrink;
+            segment.width -= shrink;
+            if(segment.width > 0) { break; }
+            this->skyline.erase(this->skyline.begin() + i);
+        }
+        // Merge neighbours of equal height
+        for(size_t i = 0; i + 1 < this->skyline.size(); ) {
+            if(this->skyline[i].y == this->skyline[i + 1].y) {
+                this->skyline[i].width += this->skyline[i + 1].width;
+                this->skyline.erase(this->skyline.begin() + i + 1);
+            } else {
+                i++;
+            }
+        }
+    }
+};
+
+
+// Small textures packed into shared pages, so meshes using them share one texture bind.
+// A texture is sampled through its diffuse transform (uv * xy + zw). Every texture gets a
+// gutter of replicated edge texels and is aligned to 2^(ATLAS_MIP_LEVELS - 1) texels, so each
+// mip level of a page is built from the texture's own mips and still has at least one texel
+// of gutter; pages have no levels below that (neighbours would be filtered together).
+// Textures are never removed, the pages live until the atlas is destroyed.
+class TextureAtlas {
+public:
+    struct Entry {
+        uint textureID = 0;
+        glm::vec4 transform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+    };
+    
+private:
+    struct Page {
+        uint textureID;
+        SkylinePacker packer;
+    };
+    
+    static constexpr int GUTTER = (1 << (ATLAS_MIP_LEVELS - 1));
+    
+    std::vector<Page> pages;
+    std::unordered_map<uint64_t, Entry> entries;
+    
+public:
+    TextureAtlas() { }
+    TextureAtlas(const TextureAtlas& rhs) = delete;
+    TextureAtlas& operator=(const TextureAtlas& rhs) = delete;
+    
+    ~TextureAtlas() {
+        for(const Page& page : this->pages) { TextureCache::instance().release(page.textureID); }
+    }
+    
+    // Small enough, and with sizes that keep all atlas mip levels aligned
+    static bool fits(int width, int height) {
+        return (width > 0 && height > 0 && width <= ATLAS_MAX_TEXTURE_SIZE && height <= ATLAS_MAX_TEXTURE_SIZE
+                && width % GUTTER == 0 && height % GUTTER == 0);
+    }
+    
+    // Atlas entry of an image by its content hash, nullptr if it was not added
+    const Entry* find(uint64_t hash) const {
+        auto it = this->entries.find(hash);
+        return (it != this->entries.end() ? &it->second : nullptr);
+    }
+    
+    // Add an RGBA8 image (with its mip chain) and upload it into a page (render thread)
+    bool add(uint64_t hash, const MipChain& mips, Entry& entry) {
+        if(mips.getLevelCount() == 0 || !fits(mips.sizes[0].x, mips.sizes[0].y)) { return false; }
+        const int width = mips.sizes[0].x, height = mips.sizes[0].y;
+        SkylinePacker::Rect rect;
+        Page* page = nullptr;
+        for(Page& tmpPage : this->pages) {
+            if(tmpPage.packer.insert(width + 2 * GUTTER, height + 2 * GUTTER, rect)) { page = &tmpPage; break; }
+        }
+        if(page == nullptr) {
+            this->pages.push_back(Page { createPage(), SkylinePacker(ATLAS_SIZE, ATLAS_SIZE) });
+            page = &this->pages.back();
+            if(!page->packer.insert(width + 2 * GUTTER, height + 2 * GUTTER, rect)) { return false; }
+        }
+        // Every level with its gutter (the texture's edge texels, replicated)
+        glBindTexture(GL_TEXTURE_2D, page->textureID);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for(int level = 0; level < ATLAS_MIP_LEVELS && level < (int)mips.getLevelCount(); level++) {
+            const int w = mips.sizes[level].x, h = mips.sizes[level].y;
+            const int gutter = GUTTER >> level;
+            const int blockWidth = w + 2 * gutter, blockHeight = h + 2 * gutter;
+            std::vector<byte> block((size_t)blockWidth * blockHeight * 4);
+            const byte* src = mips.levels[level].data();
+            for(int y = 0; y < blockHeight; y++) {
+                const int sy = std::min(std::max(y - gutter, 0), h - 1);
+                for(int x = 0; x < blockWidth; x++) {
+                    const int sx = std::min(std::max(x - gutter, 0), w - 1);
+                    std::copy(src + ((size_t)sy * w + sx) * 4, src + ((size_t)sy * w + sx) * 4 + 4, block.begin() + ((size_t)y * blockWidth + x) * 4);
+                }
+            }
+            glTexSubImage2D(GL_TEXTURE_2D, level, rect.x >> level, rect.y >> level, blockWidth, blockHeight, GL_RGBA, GL_UNSIGNED_BYTE, block.data());
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        
+        entry.textureID = page->textureID;
+        entry.transform = glm::vec4((float)width / ATLAS_SIZE, (float)height / ATLAS_SIZE,
+                                    (float)(rect.x + GUTTER) / ATLAS_SIZE, (float)(rect.y + GUTTER) / ATLAS_SIZE);
+        this->entries[hash] = entry;
+        return true;
+    }
+    
+    inline size_t getPageCount() const { return this->pages.size(); }
+    inline size_t getTextureCount() const { return this->entries.size(); }
+    
+private:
+    static uint createPage() {
+        uint textureID = 0;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        for(int level = 0; level < ATLAS_MIP_LEVELS; level++) {
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGB, ATLAS_SIZE >> level, ATLAS_SIZE >> level, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, ATLAS_MIP_LEVELS - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        // The atlas holds a reference on its pages
+        TextureCache::instance().acquire(textureID);
+        return textureID;
+    }
+    
+};
+
+}
+
+#endif
@@ -0,0 +1,151 @@
+//  TextureCache.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef TextureCache_h
+#define TextureCache_h
+
+#include <mutex>
+#include <utility>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+#include "Types.h"
+#include "Config.h"
+
+namespace arealGL {
+
+// Process wide cache of GL textures by the content hash of their source file, so the
+// same image (under any path, from any Loader) costs one decode and one GPU allocation.
+// The textures are reference counted by their Texture owners and deleted with the last one.
+// Lookups may come from the loader workers, textures are only created and deleted on the render thread.
+class TextureCache {
+private:
+    struct Entry {
+        uint64_t hash = 0;              // 0 for textures that were not loaded from a file
+        uint references = 0;
+    };
+    
+    std::mutex mutex;
+    std::unordered_map<uint64_t, uint> textures;
+    std::unordered_map<uint, Entry> entries;
+    std::function<void(uint)> deleter = [](uint textureID) { glDeleteTextures(1, &textureID); };
+    
+    TextureCache() { }
+    
+public:
+    TextureCache(const TextureCache& rhs) = delete;
+    TextureCache& operator=(const TextureCache& rhs) = delete;
+    
+    static TextureCache& instance() {
+        static TextureCache cache;
+        return cache;
+    }
+    
+    // GL texture of the content hash (0 if not loaded)
+    uint find(uint64_t hash) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto it = this->textures.find(hash);
+        return (it != this->textures.end() ? it->second : 0);
+    }
+    
+    // Reference the GL texture of the content hash (0 if not loaded). Lookup and reference are
+    // one step, so the texture cannot be deleted in between (for loads that skip the decode).
+    uint findAndAcquire(uint64_t hash) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto it = this->textures.find(hash);
+        if(it == this->textures.end()) { return 0; }
+        this->entries[it->second].references++;
+        return it->second;
+    }
+    
+    void insert(uint64_t hash, uint textureID) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->textures[hash] = textureID;
+        this->entries[textureID].hash = hash;
+    }
+    
+    void erase(uint64_t hash) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->textures.erase(hash);
+    }
+    
+    void acquire(uint textureID) {
+        if(textureID == 0) { return; }
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->entries[textureID].references++;
+    }
+    
+    // Drop a reference, the texture is deleted (and forgotten) with the last one
+    void release(uint textureID) {
+        if(textureID == 0) { return; }
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            auto it = this->entries.find(textureID);
+            if(it == this->entries.end() || --it->second.references > 0) { return; }
+            if(it->second.hash != 0) { this->textures.erase(it->second.hash); }
+            this->entries.erase(it);
+        }
+        this->deleter(textureID);
+    }
+    
+    // How textures are deleted (e.g. through the TextureStreamer that owns their mip levels)
+    inline void setDeleter(std::function<void(uint)> deleter) { this->deleter = std::move(deleter); }
+    
+    size_t size() {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->textures.size();
+    }
+    
+};
+
+
+// One reference on a cached texture, dropped on destruction (render thread, it may delete the texture)
+class TextureReference {
+private:
+    uint textureID = 0;
+    
+public:
+    TextureReference() { }
+    explicit TextureReference(uint textureID) : textureID(textureID) { }
+    TextureReference(const TextureReference& rhs) = delete;
+    TextureReference& operator=(const TextureReference& rhs) = delete;
+    TextureReference(TextureReference&& rhs) noexcept : textureID(rhs.textureID) { rhs.textureID = 0; }
+    TextureReference& operator=(TextureReference&& rhs) noexcept { std::swap(this->textureID, rhs.textureID); return *this; }
+    ~TextureReference() { TextureCache::instance().release(this->textureID); }
+    
+    inline uint get() const { return this->textureID; }
+    
+};
+
+}
+
+#endif
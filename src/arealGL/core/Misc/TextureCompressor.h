@@ -0,0 +1,138 @@
+//  TextureCompressor.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef TextureCompressor_h
+#define TextureCompressor_h
+
+#include <string>
+#include <vector>
+#include <cctype>
+#include <algorithm>
+
+#include "Hash.h"
+#include "Types.h"
+#include "MipChain.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "BlockCompression.h"
+#include "CompressedTexture.h"
+#include "stb_image.h"
+
+namespace arealGL {
+
+// Offline compression of an image file into a KTX file with mip levels
+// (used by the texture encoder and the asset cooker, the stb_image implementation
+// has to be compiled into the tool)
+namespace texcompress {
+    
+    struct Result {
+        bool ok = false;
+        bool skipped = false;               // the KTX is already up to date
+        BlockFormat format = BlockFormat::NONE;
+        int width = 0;
+        int height = 0;
+        uint levels = 0;
+        size_t sourceBytes = 0;             // uncompressed RGBA8 size of level 0
+        size_t compressedBytes = 0;
+    };
+    
+    // Normal maps by their (common) file name suffixes
+    inline bool isNormalMap(const std::string& path) {
+        std::string name = path.substr(path.find_last_of('/') + 1);
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        for(const char* tag : { "normal", "_nrm", "_ddn", "_n.", "_norm" }) {
+            if(name.find(tag) != std::string::npos) { return true; }
+        }
+        return false;
+    }
+    
+    // BC5 for normal maps, BC3 for images with alpha, BC1 for everything else
+    inline BlockFormat chooseFormat(bool normalMap, const byte* rgba, int width, int height) {
+        if(normalMap) { return BlockFormat::BC5; }
+        for(size_t i = 0; i < (size_t)width * height; i++) {
+            if(rgba[i * 4 + 3] != 255) { return BlockFormat::BC3; }
+        }
+        return BlockFormat::BC1;
+    }
+    
+    inline std::string ktxPath(const std::string& source) {
+        return source.substr(0, source.find_last_of('.')) + ".ktx";
+    }
+    
+    // Compress source into its KTX (format NONE = choose by content). Unless forced, the work is
+    // skipped if the KTX was written from the same source content. The block rows are spread
+    // over the pool, if given (do not pass the pool from inside one of its own tasks).
+    inline Result compressFile(const std::string& source, BlockFormat format, bool normalMap, bool mips, bool force, ThreadPool* pool) {
+        Result result;
+        const MappedFile file(source);
+        if(!file.isOpen()) { return result; }
+        const uint64_t hash = hashFNV1a(file.getData(), file.getSize());
+        const std::string outPath = ktxPath(source);
+        if(!force) {
+            CompressedTexture existing;
+            if(existing.open(outPath) && existing.getSourceHash() == hash) {
+                result.ok = result.skipped = true;
+                result.format = existing.getFormat();
+                return result;
+            }
+        }
+        int numComponents = 0;
+        byte* rgba = stbi_load_from_memory(file.getData(), (int)file.getSize(), &result.width, &result.height, &numComponents, 4);
+        if(rgba == nullptr) { return result; }
+        result.format = (format != BlockFormat::NONE ? format : chooseFormat(normalMap, rgba, result.width, result.height));
+        result.sourceBytes = (size_t)result.width * result.height * 4;
+        // Build the mip chain (or only level 0) and compress every level
+        MipChain chain;
+        if(mips) {
+            MipOptions options;
+            options.normalMap = normalMap;
+            options.pool = pool;
+            chain = MipChain::build(rgba, result.width, result.height, options);
+        } else {
+            chain.sizes.push_back(glm::ivec2(result.width, result.height));
+            chain.levels.push_back(std::vector<byte>(rgba, rgba + result.sourceBytes));
+        }
+        stbi_image_free(rgba);
+        std::vector<std::vector<byte>> levels(chain.getLevelCount());
+        for(uint level = 0; level < chain.getLevelCount(); level++) {
+            if(!compressImage(result.format, chain.levels[level].data(), chain.sizes[level].x, chain.sizes[level].y, levels[level], pool)) { return result; }
+            result.compressedBytes += levels[level].size();
+        }
+        result.levels = chain.getLevelCount();
+        result.ok = CompressedTexture::writeKTX(outPath, result.format, result.width, result.height, levels, hash);
+        return result;
+    }
+    
+}
+
+}
+
+#endif
@@ -1,4 +1,4 @@
-// LightNoTexShader.h
+//  ThreadPool.h
 /*************************************************************************************
  *  arealGL (OpenGL graphics library)                                                *
  *-----------------------------------------------------------------------------------*
@@ -29,70 +29,85 @@
  *                                                                                   *
  *************************************************************************************/
 
-#ifndef LightNoTexShader_h
-#define LightNoTexShader_h
+#ifndef ThreadPool_h
+#define ThreadPool_h
 
-#include "Shader.h"
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <future>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+
+#include "Types.h"
 
 namespace arealGL {
 
-class LightNoTexShader : public Shader {
+// Fixed size worker pool. Tasks are run in FIFO order, queued tasks are
+// finished before the destructor joins the workers.
+class ThreadPool {
 private:
-    std::vector<Light> lights;
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
     
 public:
-    LightNoTexShader(const std::vector<Light>& lights) : Shader(SHADER_BASEPATH + "lightNoTexShader.vert", SHADER_BASEPATH + "lightNoTexShader.frag", true) {
-        this->lights = lights;
-        // Set the Attributes
-        setAttribute(0, "position");
-        setAttribute(1, "normal");
-        setAttribute(2, "tangent");
-        setAttribute(3, "texCoords");
-        // Set the Uniforms
-        setUniform("u_transform");
-        setUniform("u_projection");
-        setUniform("u_view");
-        setUniform("u_objectColor");
-        setUniform("u_spectralReflectivity");
-        setUniform("u_shineDamper");
-        for(int i = 0; i < MAX_LIGHTS; i++) {
-            setUniform("u_lightPosition[" + std::to_string(i) + "]");
-            setUniform("u_lightColor[" + std::to_string(i) + "]");
-            setUniform("u_intensity[" + std::to_string(i) + "]");
+    // 0 threads = one worker per hardware thread, minus the render thread
+    explicit ThreadPool(uint threadCount = 0) {
+        if(threadCount == 0) {
+            const uint hardwareThreads = std::thread::hardware_concurrency();
+            threadCount = (hardwareThreads > 1 ? hardwareThreads - 1 : 1);
+        }
+        for(uint i = 0; i < threadCount; i++) {
+            this->workers.emplace_back([this]() { this->work(); });
         }
     }
     
-    void setModelUniforms(const glm::mat4& transform, const glm::mat4& view, const glm::mat4& projection, const Color& color) const override {
-        uniformVec3("u_objectColor", color.getRGB());
-        uniformMat4("u_transform", transform);
-        uniformMat4("u_projection", projection);
-        uniformMat4("u_view", view);
-    }
+    ThreadPool(const ThreadPool& rhs) = delete;
+    ThreadPool& operator=(const ThreadPool& rhs) = delete;
     
-    void setMaterialUniforms(float spectralReflectivity, float shineDamper) const override {
-        uniformFloat("u_spectralReflectivity", spectralReflectivity);
-        uniformFloat("u_shineDamper", shineDamper);
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stopping = true;
+        }
+        this->condition.notify_all();
+        for(std::thread& worker : this->workers) { worker.join(); }
     }
     
-    void setLightUniforms() const override {
-        for(int i = 0; i < MAX_LIGHTS; i++) {
-            if(i < lights.size()) {
-                uniformVec3("u_lightPosition[" + std::to_string(i) + "]", lights[i].getDirection());
-                uniformVec3("u_lightColor[" + std::to_string(i) + "]", lights[i].getColor().getRGB());
-                uniformFloat("u_intensity[" + std::to_string(i) + "]", lights[i].getIntensity());
-            } else {
-                uniformVec3("u_lightPosition[" + std::to_string(i) + "]", glm::vec3(0.0f));
-                uniformVec3("u_lightColor[" + std::to_string(i) + "]", glm::vec3(0.0f));
-                uniformFloat("u_intensity[" + std::to_string(i) + "]", 1.0f);
-            }
+    template<typename F>
+    auto enqueue(F&& function) -> std::future<decltype(function())> {
+        typedef decltype(function()) Result;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(function));
+        std::future<Result> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->tasks.emplace([task]() { (*task)(); });
         }
+        this->condition.notify_one();
+        return result;
     }
     
-    inline void setLights(const std::vector<Light>& lights) { this->lights = lights; }
-    inline void setLights(std::vector<Light>&& lights) noexcept { this->lights = std::move(lights); }
+    inline uint getThreadCount() const { return (uint)this->workers.size(); }
     
-    inline void addLight(const Light& light) { this->lights.push_back(light); }
-    inline void addLight(Light&& light) noexcept { this->lights.push_back(light); }
+private:
+    void work() {
+        while(true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                this->condition.wait(lock, [this]() { return (this->stopping || !this->tasks.empty()); });
+                if(this->stopping && this->tasks.empty()) { return; }
+                task = std::move(this->tasks.front());
+                this->tasks.pop();
+            }
+            task();
+        }
+    }
     
 };
 
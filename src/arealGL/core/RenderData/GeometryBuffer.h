@@ -0,0 +1,167 @@
+//  GeometryBuffer.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef GeometryBuffer_h
+#define GeometryBuffer_h
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+#include "Types.h"
+#include "VertexFormat.h"
+
+#include <vec3.hpp>
+
+namespace arealGL {
+
+// Geometry of one mesh in memory, either full precision (imported) or already in its GPU
+// layout (a mapped mesh cache). Packed positions decode as position * scale + offset.
+struct GeometryData {
+    const void* vertices = nullptr;
+    size_t vertexCount = 0;
+    VertexFormat format = VertexFormat::FLOAT;      // layout of the vertices above
+    glm::vec3 positionOffset = glm::vec3(0.0f);     // quantization of the packed layout
+    glm::vec3 positionScale = glm::vec3(1.0f);
+    const void* indices = nullptr;
+    size_t indexCount = 0;
+    size_t indexSize = sizeof(uint);                // 16 or 32 bit indices
+};
+
+// One vertex and one index buffer (with their VAO), holding the geometry of a single mesh
+// or of all meshes of a model. Each mesh is a range of it, drawn with glDrawElementsBaseVertex,
+// so its indices stay local to the mesh and the whole model needs a single VAO bind.
+class GeometryBuffer {
+public:
+    struct Range {
+        uint baseVertex = 0;
+        uint firstIndex = 0;
+        uint vertexCount = 0;
+        uint indexCount = 0;
+    };
+    
+private:
+    uint VAO = 0, VBO = 0, EBO = 0;
+    VertexFormat format = VertexFormat::FLOAT;
+    uint indexType = GL_UNSIGNED_INT;
+    
+public:
+    // Allocate the buffers. 16 bit indices can be used if no single range has more than 65536 vertices.
+    GeometryBuffer(VertexFormat format, size_t vertexCount, size_t indexCount, bool shortIndices)
+    : format(format), indexType(shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT) {
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(vertexSize(format) * vertexCount), nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(this->getIndexSize() * indexCount), nullptr, GL_STATIC_DRAW);
+        // Set the vertex attribute pointers
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+        glEnableVertexAttribArray(3);
+        if(format == VertexFormat::PACKED) {
+            // The normal and tangent arrive as (x, y, 0) and are decoded in the vertex shader
+            glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (GLvoid *)offsetof(PackedVertex, position));
+            glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (GLvoid *)offsetof(PackedVertex, normal));
+            glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (GLvoid *)offsetof(PackedVertex, tangent));
+            glVertexAttribPointer(3, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (GLvoid *)offsetof(PackedVertex, texcoords));
+        } else {
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid *)0);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid *)offsetof(Vertex, normal));
+            glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid *)offsetof(Vertex, tangent));
+            glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid *)offsetof(Vertex, texcoords));
+        }
+        glBindVertexArray(0);
+    }
+    
+    // Buffer for a single mesh, filled right away (with 16 bit indices if they fit)
+    static std::shared_ptr<GeometryBuffer> create(VertexFormat format, const GeometryData& data) {
+        std::shared_ptr<GeometryBuffer> buffer = std::make_shared<GeometryBuffer>(format, data.vertexCount, data.indexCount, (data.vertexCount <= 65536));
+        buffer->upload(0, 0, data);
+        return buffer;
+    }
+    
+    GeometryBuffer(const GeometryBuffer& rhs) = delete;
+    GeometryBuffer& operator=(const GeometryBuffer& rhs) = delete;
+    
+    ~GeometryBuffer() {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+    }
+    
+    // Fill a range. Vertices and indices already in the buffer's layout are uploaded as they are,
+    // only imported (full precision) vertices are packed and indices that were not narrowed at
+    // import (e.g. built in code) are converted here.
+    void upload(size_t baseVertex, size_t firstIndex, const GeometryData& data) {
+        const size_t vertexCount = data.vertexCount, indexCount = data.indexCount;
+        const size_t indexSize = this->getIndexSize();
+        const size_t stride = vertexSize(this->format);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        if(data.format == this->format) {
+            glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)(stride * baseVertex), (GLsizeiptr)(stride * vertexCount), data.vertices);
+        } else if(this->format == VertexFormat::PACKED) {
+            const std::vector<PackedVertex> packed = packVertices(static_cast<const Vertex*>(data.vertices), vertexCount, data.positionOffset, data.positionScale);
+            glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)(stride * baseVertex), (GLsizeiptr)(stride * vertexCount), packed.data());
+        } else {
+            const std::vector<Vertex> unpacked = unpackVertices(static_cast<const PackedVertex*>(data.vertices), vertexCount, data.positionOffset, data.positionScale);
+            glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)(stride * baseVertex), (GLsizeiptr)(stride * vertexCount), unpacked.data());
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        // The element buffer binding is VAO state
+        glBindVertexArray(VAO);
+        if(data.indexSize == indexSize) {
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (GLintptr)(indexSize * firstIndex), (GLsizeiptr)(indexSize * indexCount), data.indices);
+        } else if(this->indexType == GL_UNSIGNED_SHORT) {
+            const uint* indexData = static_cast<const uint*>(data.indices);
+            const std::vector<uint16_t> shortIndices(indexData, indexData + indexCount);
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (GLintptr)(indexSize * firstIndex), (GLsizeiptr)(indexSize * indexCount), shortIndices.data());
+        } else {
+            const uint16_t* indexData = static_cast<const uint16_t*>(data.indices);
+            const std::vector<uint> indices(indexData, indexData + indexCount);
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (GLintptr)(indexSize * firstIndex), (GLsizeiptr)(indexSize * indexCount), indices.data());
+        }
+        glBindVertexArray(0);
+    }
+    
+    inline uint getVAO() const { return this->VAO; }
+    inline VertexFormat getVertexFormat() const { return this->format; }
+    inline uint getIndexType() const { return this->indexType; }
+    inline size_t getIndexSize() const { return (this->indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint)); }
+    
+};
+
+}
+
+#endif
@@ -0,0 +1,101 @@
+//  InstanceBuffer.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef InstanceBuffer_h
+#define InstanceBuffer_h
+
+#include <vector>
+
+#include "Types.h"
+#include "Config.h"
+#include "Mat3x4.h"
+
+// ---------------------------------------------------------------------------
+// Per instance model transforms as three vec4 rows (arealGLx::mat3x4).
+// Matching vertex shader declaration and decode:
+//
+//   layout (location = 4) in vec4 i_transformRow0;
+//   layout (location = 5) in vec4 i_transformRow1;
+//   layout (location = 6) in vec4 i_transformRow2;
+//
+//   vec3 worldPos = vec3(dot(i_transformRow0, p), dot(i_transformRow1, p), dot(i_transformRow2, p));   // p = vec4(position, 1.0)
+//   mat4 model = transpose(mat4(i_transformRow0, i_transformRow1, i_transformRow2, vec4(0.0, 0.0, 0.0, 1.0)));
+// ---------------------------------------------------------------------------
+
+namespace arealGL {
+
+class InstanceBuffer {
+private:
+    uint VBO = 0;
+    size_t capacity = 0;
+    size_t count = 0;
+    
+public:
+    InstanceBuffer() { glGenBuffers(1, &VBO); }
+    InstanceBuffer(const InstanceBuffer& rhs) = delete;
+    InstanceBuffer& operator=(const InstanceBuffer& rhs) = delete;
+    ~InstanceBuffer() { glDeleteBuffers(1, &VBO); }
+    
+    // Upload the transforms (the buffer only grows, smaller uploads reuse the storage)
+    void upload(const arealGLx::mat3x4* transforms, size_t instances) {
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        if(instances > capacity) {
+            capacity = instances;
+            glBufferData(GL_ARRAY_BUFFER, (sizeof(arealGLx::mat3x4) * capacity), transforms, GL_DYNAMIC_DRAW);
+        } else if(instances > 0) {
+            glBufferSubData(GL_ARRAY_BUFFER, 0, (sizeof(arealGLx::mat3x4) * instances), transforms);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        count = instances;
+    }
+    inline void upload(const std::vector<arealGLx::mat3x4>& transforms) { upload(transforms.data(), transforms.size()); }
+    
+    // Add the three row attributes (advancing once per instance) to a meshs VAO
+    void attach(uint VAO) const {
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        for(uint i = 0; i < 3; i++) {
+            glEnableVertexAttribArray(INSTANCE_ATTRIB_LOCATION + i);
+            glVertexAttribPointer(INSTANCE_ATTRIB_LOCATION + i, 4, GL_FLOAT, GL_FALSE, sizeof(arealGLx::mat3x4), (GLvoid*)(sizeof(float) * 4 * i));
+            glVertexAttribDivisor(INSTANCE_ATTRIB_LOCATION + i, 1);
+        }
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    
+    inline size_t getCount() const { return this->count; }
+    inline uint getVBO() const { return this->VBO; }
+    
+};
+
+}
+
+#endif
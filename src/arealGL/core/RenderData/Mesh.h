@@ -35,74 +35,229 @@
 #include <string>
 #include <sstream>
 #include <vector>
+#include <memory>
+#include <algorithm>
 
 #include "Types.h"
 #include "Config.h"
 #include "Camera.h"
 #include "Texture.h"
+#include "VertexFormat.h"
+#include "GeometryBuffer.h"
 
 #include <vec2.hpp>
 #include <vec3.hpp>
+#include <common.hpp>
 #include "Importer.hpp"
 
 namespace arealGL {
     
-class Mesh;
-typedef std::vector<Mesh> Model;
+// CPU side mesh data (importer or cache output) before the GPU upload
+struct MeshData {
+    std::vector<Vertex> vertices;
+    std::vector<uint> indices;
+    std::vector<uint16_t> shortIndices;             // used instead of indices once they are narrowed
+    size_t indexSize = sizeof(uint);                // bytes per index, as stored and uploaded
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    Material material = { 0.0f, 0.0f, 0.0f, 10.0f };
+    VertexFormat format = VertexFormat::FLOAT;      // GPU layout, chosen at import
+    // texture file names relative to the model directory ("" if not set)
+    std::string textureDiffuse;
+    std::string textureSpecular;
+    std::string textureNormal;
     
+    void computeBounds() {
+        this->boundsMin = this->boundsMax = (vertices.empty() ? glm::vec3() : vertices[0].position);
+        for(const Vertex& v : vertices) {
+            this->boundsMin = glm::min(this->boundsMin, v.position);
+            this->boundsMax = glm::max(this->boundsMax, v.position);
+        }
+    }
+    
+    inline size_t getIndexCount() const { return (this->indexSize == sizeof(uint16_t) ? this->shortIndices.size() : this->indices.size()); }
+    
+    // Store the indices in 16 bit (after all processing), if the mesh has no more than 65536 vertices
+    void narrowIndices() {
+        if(this->indexSize == sizeof(uint16_t) || this->vertices.size() > 65536) { return; }
+        this->shortIndices.assign(this->indices.begin(), this->indices.end());
+        std::vector<uint>().swap(this->indices);
+        this->indexSize = sizeof(uint16_t);
+    }
     
-struct Vertex {
-    glm::vec3 position;
-    glm::vec3 normal;
-    glm::vec3 tangent;
-    glm::vec2 texcoords;
+    // The full precision geometry, packed vertices are quantized to the bounds
+    GeometryData getGeometry() const {
+        GeometryData data;
+        data.vertices = this->vertices.data();
+        data.vertexCount = this->vertices.size();
+        data.positionOffset = this->boundsMin;
+        data.positionScale = packedPositionScale(this->boundsMin, this->boundsMax);
+        data.indices = (this->indexSize == sizeof(uint16_t) ? (const void*)this->shortIndices.data() : (const void*)this->indices.data());
+        data.indexCount = this->getIndexCount();
+        data.indexSize = this->indexSize;
+        return data;
+    }
+};
+
+
+// What a Mesh keeps of its geometry in CPU memory after the upload
+enum class GeometryRetention {
+    BOUNDS,             // only bounds and counts (render only assets)
+    COLLISION,          // welded positions and indices (physics / picking)
+    FULL                // all vertices and indices
+};
+
+// Position only triangle mesh (vertices welded by position, degenerate triangles removed)
+struct CollisionProxy {
+    std::vector<glm::vec3> positions;
+    std::vector<uint> indices;
     
-    Vertex() {}
-    Vertex(const Vertex& rhs) = default;
-    Vertex(Vertex&& rhs) noexcept = default;
-    Vertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec2& texcoords)
-    : position(position), normal(normal), texcoords(texcoords) { }
-    Vertex(glm::vec3&& position, glm::vec3&& normal, glm::vec2&& texcoords) noexcept
-    : position(std::move(position)), normal(std::move(normal)), texcoords(std::move(texcoords)) { }
+    template <typename Index>
+    static CollisionProxy build(const Vertex* vertices, size_t vertexCount, const Index* indices, size_t indexCount) {
+        CollisionProxy proxy;
+        // Sort the vertices by position, equal positions share one proxy vertex
+        std::vector<uint> order(vertexCount);
+        for(size_t i = 0; i < vertexCount; i++) { order[i] = (uint)i; }
+        auto less = [vertices](uint a, uint b) {
+            const glm::vec3& p = vertices[a].position;
+            const glm::vec3& q = vertices[b].position;
+            return (p.x != q.x ? p.x < q.x : (p.y != q.y ? p.y < q.y : p.z < q.z));
+        };
+        std::sort(order.begin(), order.end(), less);
+        std::vector<uint> remap(vertexCount);
+        for(size_t i = 0; i < vertexCount; i++) {
+            if(i == 0 || less(order[i - 1], order[i])) { proxy.positions.push_back(vertices[order[i]].position); }
+            remap[order[i]] = (uint)proxy.positions.size() - 1;
+        }
+        proxy.indices.reserve(indexCount);
+        for(size_t i = 0; i + 2 < indexCount; i += 3) {
+            const uint a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+            if(a == b || b == c || a == c) { continue; }
+            proxy.indices.insert(proxy.indices.end(), { a, b, c });
+        }
+        return proxy;
+    }
 };
 
 
+// A range of a GeometryBuffer (its own, or the one shared by all meshes of a model) and its textures.
+// Owns its textures, so it can only be moved (into a Model).
 class Mesh {
-public:
-    const std::vector<Vertex> vertices;
-    const std::vector<uint> indices;
-    const Texture texture;
-    const std::string directory;
 private:
-    uint VAO = 0, VBO = 0, EBO = 0;
+    Texture texture;
+    std::string directory;
+    std::shared_ptr<const GeometryBuffer> buffer;
+    GeometryBuffer::Range range;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    VertexFormat format = VertexFormat::FLOAT;
+    glm::vec3 positionOffset;           // quantization of the packed positions
+    glm::vec3 positionScale;
+    GeometryRetention retention = GeometryRetention::BOUNDS;
+    // CPU side geometry, depending on the retention (always full precision, indices as uploaded)
+    std::vector<Vertex> vertices;
+    std::vector<uint> indices;
+    std::vector<uint16_t> shortIndices;
+    CollisionProxy collision;
     
 public:
-    Mesh(const std::vector<Vertex>& vertices, const std::vector<uint>& indices,
-         const Texture& texture, const std::string& directory)
-    : vertices(vertices), indices(indices), texture(texture), directory(directory) {
-        // Create the buffers
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-        glBindVertexArray(VAO);
-        // Load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, (sizeof(Vertex) * vertices.size()), &vertices[0], GL_STATIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (sizeof(uint) * indices.size()), &indices[0], GL_STATIC_DRAW);
-        // Set the vertex attribute pointers
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid *)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid *)offsetof(Vertex, normal));
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid *)offsetof(Vertex, tangent));
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid *)offsetof(Vertex, texcoords));
-        glBindVertexArray(0);
+    // Upload imported data, with FULL retention its vectors are taken over instead of copied
+    Mesh(MeshData&& data, Texture&& texture, const std::string& directory, GeometryRetention retention = GeometryRetention::BOUNDS)
+    : Mesh(GeometryBuffer::create(data.format, data.getGeometry()), wholeRange(data.vertices.size(), data.getIndexCount()),
+           std::move(data), std::move(texture), directory, retention) { }
+    
+    // Upload straight from external memory in its GPU layout (e.g. a mapped mesh cache)
+    Mesh(const GeometryData& data, const glm::vec3& boundsMin, const glm::vec3& boundsMax, Texture&& texture, const std::string& directory,
+         GeometryRetention retention = GeometryRetention::BOUNDS)
+    : Mesh(GeometryBuffer::create(data.format, data), wholeRange(data.vertexCount, data.indexCount),
+           data, boundsMin, boundsMax, std::move(texture), directory, retention) { }
+    
+    // Range of an already filled buffer, the data is only used for the retention
+    Mesh(std::shared_ptr<const GeometryBuffer> buffer, const GeometryBuffer::Range& range, MeshData&& data, Texture&& texture,
+         const std::string& directory, GeometryRetention retention = GeometryRetention::BOUNDS)
+    : texture(std::move(texture)), directory(directory), buffer(std::move(buffer)), range(range), boundsMin(data.boundsMin), boundsMax(data.boundsMax),
+      format(this->buffer->getVertexFormat()), positionOffset(data.boundsMin), positionScale(packedPositionScale(data.boundsMin, data.boundsMax)),
+      retention(retention) {
+        if(retention == GeometryRetention::FULL) {
+            this->vertices = std::move(data.vertices);
+            this->indices = std::move(data.indices);
+            this->shortIndices = std::move(data.shortIndices);
+        } else {
+            this->retain(data.getGeometry());
+        }
+    }
+    
+    Mesh(std::shared_ptr<const GeometryBuffer> buffer, const GeometryBuffer::Range& range, const GeometryData& data,
+         const glm::vec3& boundsMin, const glm::vec3& boundsMax, Texture&& texture, const std::string& directory,
+         GeometryRetention retention = GeometryRetention::BOUNDS)
+    : texture(std::move(texture)), directory(directory), buffer(std::move(buffer)), range(range), boundsMin(boundsMin), boundsMax(boundsMax),
+      format(this->buffer->getVertexFormat()), positionOffset(data.positionOffset), positionScale(data.positionScale), retention(retention) {
+        this->retain(data);
+    }
+    
+    Mesh(const Mesh& rhs) = delete;
+    Mesh(Mesh&& rhs) noexcept = default;
+    Mesh& operator=(const Mesh& rhs) = delete;
+    Mesh& operator=(Mesh&& rhs) noexcept = default;
+    
+    inline const Texture& getTexture() const { return this->texture; }
+    inline Texture& getTexture() { return this->texture; }
+    inline const std::string& getDirectory() const { return this->directory; }
+    inline uint getVAO() const { return this->buffer->getVAO(); }
+    inline uint getVertexCount() const { return this->range.vertexCount; }
+    inline uint getIndexCount() const { return this->range.indexCount; }
+    inline uint getIndexType() const { return this->buffer->getIndexType(); }
+    inline const GeometryBuffer::Range& getRange() const { return this->range; }
+    // Arguments of glDrawElementsBaseVertex
+    inline const GLvoid* getIndexOffset() const { return (const GLvoid*)(this->buffer->getIndexSize() * this->range.firstIndex); }
+    inline GLint getBaseVertex() const { return (GLint)this->range.baseVertex; }
+    inline glm::vec3 getBoundsMin() const { return this->boundsMin; }
+    inline glm::vec3 getBoundsMax() const { return this->boundsMax; }
+    inline VertexFormat getVertexFormat() const { return this->format; }
+    inline GeometryRetention getRetention() const { return this->retention; }
+    
+    // Retained geometry (empty unless the retention is FULL / COLLISION)
+    // The indices are in one of the two vectors, depending on the index type
+    inline const std::vector<Vertex>& getVertices() const { return this->vertices; }
+    inline const std::vector<uint>& getIndices() const { return this->indices; }
+    inline const std::vector<uint16_t>& getShortIndices() const { return this->shortIndices; }
+    inline const CollisionProxy& getCollisionProxy() const { return this->collision; }
+    
+    // Position decode for the vertex shader (position * scale + offset)
+    inline glm::vec3 getPositionOffset() const { return (this->format == VertexFormat::PACKED ? this->positionOffset : glm::vec3(0.0f)); }
+    inline glm::vec3 getPositionScale() const { return (this->format == VertexFormat::PACKED ? this->positionScale : glm::vec3(1.0f)); }
+    
+private:
+    void retain(const GeometryData& data) {
+        if(this->retention == GeometryRetention::BOUNDS) { return; }
+        // Packed (cached) vertices are decoded
+        std::vector<Vertex> unpacked;
+        if(data.format == VertexFormat::PACKED) {
+            unpacked = unpackVertices(static_cast<const PackedVertex*>(data.vertices), data.vertexCount, data.positionOffset, data.positionScale);
+        }
+        const Vertex* vertexData = (data.format == VertexFormat::PACKED ? unpacked.data() : static_cast<const Vertex*>(data.vertices));
+        const uint* indexData = static_cast<const uint*>(data.indices);
+        const uint16_t* shortIndexData = static_cast<const uint16_t*>(data.indices);
+        if(this->retention == GeometryRetention::FULL) {
+            this->vertices = (data.format == VertexFormat::PACKED ? std::move(unpacked) : std::vector<Vertex>(vertexData, vertexData + data.vertexCount));
+            if(data.indexSize == sizeof(uint16_t)) {
+                this->shortIndices = std::vector<uint16_t>(shortIndexData, shortIndexData + data.indexCount);
+            } else {
+                this->indices = std::vector<uint>(indexData, indexData + data.indexCount);
+            }
+        } else if(data.indexSize == sizeof(uint16_t)) {
+            this->collision = CollisionProxy::build(vertexData, data.vertexCount, shortIndexData, data.indexCount);
+        } else {
+            this->collision = CollisionProxy::build(vertexData, data.vertexCount, indexData, data.indexCount);
+        }
     }
     
-    inline uint getVAO() const { return this->VAO; }
+    static GeometryBuffer::Range wholeRange(size_t vertexCount, size_t indexCount) {
+        GeometryBuffer::Range range;
+        range.vertexCount = (uint)vertexCount;
+        range.indexCount = (uint)indexCount;
+        return range;
+    }
     
 };
     
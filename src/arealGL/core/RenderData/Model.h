@@ -0,0 +1,79 @@
+//  Model.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef Model_h
+#define Model_h
+
+#include <vector>
+#include <memory>
+
+#include "Mesh.h"
+
+namespace arealGL {
+
+// The meshes of a loaded model. Models are shared (std::shared_ptr) but never copied,
+// a model that is still loading shows the meshes of its placeholder instead.
+class Model {
+private:
+    std::vector<Mesh> meshes;
+    std::shared_ptr<const Model> placeholder;
+    
+public:
+    Model() { }
+    explicit Model(std::vector<Mesh>&& meshes) : meshes(std::move(meshes)) { }
+    explicit Model(std::shared_ptr<const Model> placeholder) : placeholder(std::move(placeholder)) { }
+    
+    Model(const Model& rhs) = delete;
+    Model(Model&& rhs) noexcept = default;
+    Model& operator=(const Model& rhs) = delete;
+    Model& operator=(Model&& rhs) noexcept = default;
+    
+    // Take over the loaded meshes (drops the placeholder)
+    void setMeshes(std::vector<Mesh>&& meshes) {
+        this->meshes = std::move(meshes);
+        this->placeholder.reset();
+    }
+    
+    inline void addMesh(Mesh&& mesh) { this->meshes.push_back(std::move(mesh)); }
+    
+    inline const std::vector<Mesh>& getMeshes() const { return (this->placeholder ? this->placeholder->getMeshes() : this->meshes); }
+    inline bool isPlaceholder() const { return (this->placeholder != nullptr); }
+    inline size_t size() const { return this->getMeshes().size(); }
+    inline bool empty() const { return this->getMeshes().empty(); }
+    
+    inline std::vector<Mesh>::const_iterator begin() const { return this->getMeshes().begin(); }
+    inline std::vector<Mesh>::const_iterator end() const { return this->getMeshes().end(); }
+    
+};
+
+}
+
+#endif
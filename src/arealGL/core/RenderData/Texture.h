@@ -35,6 +35,9 @@
 #include <string>
 
 #include "Types.h"
+#include "TextureCache.h"
+
+#include <vec4.hpp>
 
 namespace arealGL {
 
@@ -53,17 +56,39 @@ private:
     uint textureDiffuse;
     uint normalMap;
     uint specularMap;
+    // Diffuse UV scale (xy) and offset (zw), set if the diffuse lives in an atlas page
+    glm::vec4 diffuseTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
     
 public:
-    Texture(const Texture& rhs) = default;
-    Texture(Texture&& rhs) noexcept = default;
+    // Holds a reference to each GL texture (see TextureCache), released on destruction
     Texture(uint textureID, uint normalID, uint specularID, const std::string& path)
-    : textureDiffuse(textureID), normalMap(normalID), specularMap(specularID), path(path) { }
+    : textureDiffuse(textureID), normalMap(normalID), specularMap(specularID), path(path) { acquire(); }
     Texture(uint textureID, uint normalID, uint specularID, const Material& mat, const std::string& path)
-    : textureDiffuse(textureID), normalMap(normalID), specularMap(specularID), material(mat), path(path) { }
+    : textureDiffuse(textureID), normalMap(normalID), specularMap(specularID), material(mat), path(path) { acquire(); }
+    
+    Texture(const Texture& rhs) = delete;
+    Texture(Texture&& rhs) noexcept
+    : material(rhs.material), path(std::move(rhs.path)), textureDiffuse(rhs.textureDiffuse), normalMap(rhs.normalMap), specularMap(rhs.specularMap),
+      diffuseTransform(rhs.diffuseTransform) {
+        rhs.textureDiffuse = rhs.normalMap = rhs.specularMap = 0;
+    }
+    
+    Texture& operator=(const Texture& rhs) = delete;
+    Texture& operator=(Texture&& rhs) noexcept {
+        if(this != &rhs) {
+            this->release();
+            this->material = rhs.material;
+            this->path = std::move(rhs.path);
+            this->textureDiffuse = rhs.textureDiffuse;
+            this->normalMap = rhs.normalMap;
+            this->specularMap = rhs.specularMap;
+            this->diffuseTransform = rhs.diffuseTransform;
+            rhs.textureDiffuse = rhs.normalMap = rhs.specularMap = 0;
+        }
+        return *this;
+    }
     
-    Texture& operator=(const Texture& rhs) = default;
-    Texture& operator=(Texture&& rhs) = default;
+    ~Texture() { this->release(); }
     
     void bindTexture() const {
         glActiveTexture(GL_TEXTURE0);
@@ -104,9 +129,24 @@ public:
     inline void setDiffuseReflectivity(float dRef) { this->material.diffuseReflectivity = dRef; }
     inline void setSpectralReflectivity(float sRef) { this->material.spectralReflectivity = sRef; }
     inline void setShineDamper(float sDamp) { this->material.shineDamper = sDamp; }
+    inline void setDiffuseTransform(const glm::vec4& transform) { this->diffuseTransform = transform; }
     
+    inline uint getTextureID() const { return this->textureDiffuse; }
+    inline uint getNormalMapID() const { return this->normalMap; }
+    inline uint getSpecularMapID() const { return this->specularMap; }
+    inline const glm::vec4& getDiffuseTransform() const { return this->diffuseTransform; }
     inline Material getMaterial() const { return this->material; }
     inline std::string getPath() const { return this->path; }
+    
+private:
+    void acquire() const {
+        for(uint textureID : { this->textureDiffuse, this->normalMap, this->specularMap }) { TextureCache::instance().acquire(textureID); }
+    }
+    
+    void release() {
+        for(uint textureID : { this->textureDiffuse, this->normalMap, this->specularMap }) { TextureCache::instance().release(textureID); }
+        this->textureDiffuse = this->normalMap = this->specularMap = 0;
+    }
 
 };
 
@@ -0,0 +1,336 @@
+//  TextureStreamer.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef TextureStreamer_h
+#define TextureStreamer_h
+
+#include <map>
+#include <cmath>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <vector>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+
+#include "Mesh.h"
+#include "MipChain.h"
+#include "CompressedTexture.h"
+#include "ThreadPool.h"
+#include "Types.h"
+#include "Config.h"
+
+#include <glm.hpp>
+
+namespace arealGL {
+
+// Streams the mip levels of textures in and out by on-screen texel density.
+// New textures only get their small mips (<= STREAM_MIN_RESIDENT_SIZE). Renderers report the
+// finest level each visible mesh needs, update() then uploads finer levels (one at a time,
+// through a ring of PBOs) under a per frame byte budget, and drops unneeded fine levels
+// again when the resident size exceeds STREAM_MEMORY_BUDGET.
+// GL 4.1 has no sparse textures, so the resident range is GL_TEXTURE_BASE_LEVEL .. last level.
+// Only the always resident levels are kept in CPU memory. Finer levels are decoded from the
+// source again (on a worker) when they are requested, and dropped once they are uploaded.
+// Block compressed (KTX / DDS) textures are uploaded straight from their file mapping,
+// so their fine levels need no decode and only occupy the pages the driver reads.
+class TextureStreamer {
+private:
+    struct StreamedTexture {
+        MipChain mips;                  // pixels of the always resident levels (and of fine levels waiting for upload)
+        std::shared_ptr<const CompressedTexture> compressed;    // instead of the mips: all levels, in the mapping
+        std::function<MipChain()> reload;       // decodes the whole chain from the source again (worker thread)
+        std::future<MipChain> reloading;
+        bool reloadFailed = false;
+        uint residentLevel = 0;         // finest level on the GPU (GL_TEXTURE_BASE_LEVEL)
+        uint minimumLevel = 0;          // finest of the always resident levels
+        uint requestedLevel = 0;        // finest level requested by the visible meshes
+        uint lastRequestFrame = 0;
+        
+        inline uint getLevelCount() const { return (this->compressed ? this->compressed->getLevelCount() : this->mips.getLevelCount()); }
+        inline glm::ivec2 getLevelSize(uint level) const {
+            return (this->compressed ? glm::ivec2(this->compressed->getLevel(level).width, this->compressed->getLevel(level).height) : this->mips.sizes[level]);
+        }
+        inline size_t getLevelBytes(uint level) const { return (this->compressed ? this->compressed->getLevel(level).size : this->mips.getLevelBytes(level)); }
+        inline bool hasLevel(uint level) const { return (this->compressed ? true : this->mips.hasLevel(level)); }
+        inline const void* getLevelData(uint level) const {
+            return (this->compressed ? (const void*)this->compressed->getLevel(level).data : (const void*)this->mips.levels[level].data());
+        }
+    };
+    
+    std::map<uint, StreamedTexture> textures;
+    std::unique_ptr<ThreadPool> workers;
+    uint pixelBuffers[STREAM_PBO_COUNT] = { 0 };
+    uint nextPixelBuffer = 0;
+    uint frame = 0;
+    size_t residentBytes = 0;
+    float viewportHeight = 768.0f;
+    
+public:
+    TextureStreamer() { }
+    TextureStreamer(const TextureStreamer& rhs) = delete;
+    TextureStreamer& operator=(const TextureStreamer& rhs) = delete;
+    
+    // Textures still in use are deleted directly by their last owner from now on
+    ~TextureStreamer() {
+        if(this->pixelBuffers[0] != 0) { glDeleteBuffers(STREAM_PBO_COUNT, this->pixelBuffers); }
+        TextureCache::instance().setDeleter([](uint textureID) { glDeleteTextures(1, &textureID); });
+    }
+    
+    // Create a texture with only its small mips resident. Without a reload function all
+    // levels have to stay in CPU memory.
+    uint createTexture(MipChain&& mips, std::function<MipChain()> reload = nullptr) {
+        StreamedTexture tex;
+        tex.mips = std::move(mips);
+        tex.reload = std::move(reload);
+        return this->addTexture(std::move(tex));
+    }
+    
+    // Create a block compressed texture with only its small mips resident (the finer
+    // levels are uploaded from the texture's mapping when they are requested)
+    uint createTexture(std::shared_ptr<const CompressedTexture> compressed) {
+        if(compressed == nullptr || !compressed->isValid()) { return 0; }
+        StreamedTexture tex;
+        tex.compressed = std::move(compressed);
+        return this->addTexture(std::move(tex));
+    }
+    
+    // Delete a streamed texture, false if the streamer does not own it
+    bool releaseTexture(uint textureID) {
+        auto it = this->textures.find(textureID);
+        if(it == this->textures.end()) { return false; }
+        for(uint level = it->second.residentLevel; level < it->second.getLevelCount(); level++) {
+            this->residentBytes -= it->second.getLevelBytes(level);
+        }
+        glDeleteTextures(1, &textureID);
+        this->textures.erase(it);
+        return true;
+    }
+    
+    inline void setViewportHeight(float height) { this->viewportHeight = height; }
+    
+    // Request the finest level a texture needs this frame
+    void requestLevel(uint textureID, uint level) {
+        auto it = this->textures.find(textureID);
+        if(it == this->textures.end()) { return; }
+        StreamedTexture& tex = it->second;
+        if(tex.lastRequestFrame != this->frame) {
+            tex.requestedLevel = tex.minimumLevel;
+            tex.lastRequestFrame = this->frame;
+        }
+        tex.requestedLevel = std::min(tex.requestedLevel, level);
+    }
+    
+    // Request the levels of a mesh's textures by its projected size: a mesh covering
+    // N pixels on screen needs about N texels across (UVs assumed to span the mesh once)
+    void requestMesh(const Mesh& mesh, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection) {
+        const glm::vec3 center = 0.5f * (mesh.getBoundsMin() + mesh.getBoundsMax());
+        const float scale = glm::max(glm::length(glm::vec3(model[0])), glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        const float radius = 0.5f * glm::length(mesh.getBoundsMax() - mesh.getBoundsMin()) * scale;
+        const float depth = glm::max(-(view * model * glm::vec4(center, 1.0f)).z, 0.01f);
+        const float pixels = glm::max(radius * projection[1][1] * this->viewportHeight / depth, 1.0f);
+        for(uint textureID : { mesh.getTexture().getTextureID(), mesh.getTexture().getNormalMapID(), mesh.getTexture().getSpecularMapID() }) {
+            auto it = this->textures.find(textureID);
+            if(it == this->textures.end()) { continue; }
+            const glm::ivec2 size = it->second.getLevelSize(0);
+            const float level = std::log2((float)glm::max(size.x, size.y) / pixels) + STREAM_LOD_BIAS;
+            this->requestLevel(textureID, (uint)glm::clamp(level, 0.0f, (float)(it->second.getLevelCount() - 1)));
+        }
+    }
+    
+    // Drop unneeded levels while over the memory budget, then stream in finer levels
+    // (largest deficit first) within the byte budget. Levels that are not in CPU memory are
+    // decoded in the background first. Call once per frame, after rendering.
+    void update(size_t uploadBudget = STREAM_UPLOAD_BUDGET) {
+        std::vector<std::pair<int, uint>> candidates;
+        for(auto& entry : this->textures) {
+            StreamedTexture& tex = entry.second;
+            // Textures not requested this frame fall back to their always resident levels
+            if(tex.lastRequestFrame != this->frame) { tex.requestedLevel = tex.minimumLevel; }
+            this->collectReload(tex);
+            if(tex.reload) {
+                // Decoded levels finer than requested are not needed (anymore)
+                for(uint level = 0; level < tex.requestedLevel; level++) { tex.mips.dropLevel(level); }
+            }
+            if(tex.requestedLevel >= tex.residentLevel) { continue; }
+            if(tex.hasLevel(tex.residentLevel - 1)) {
+                candidates.push_back(std::make_pair((int)tex.residentLevel - (int)tex.requestedLevel, entry.first));
+            } else {
+                this->startReload(tex);
+            }
+        }
+        this->evict();
+        std::sort(candidates.begin(), candidates.end(), [](const std::pair<int, uint>& a, const std::pair<int, uint>& b) { return a.first > b.first; });
+        size_t uploaded = 0;
+        for(const auto& candidate : candidates) {
+            StreamedTexture& tex = this->textures[candidate.second];
+            const size_t bytes = tex.getLevelBytes(tex.residentLevel - 1);
+            // Always allow one upload per frame, so levels larger than the budget still arrive
+            if(uploaded > 0 && (uploaded + bytes) > uploadBudget) { continue; }
+            if((this->residentBytes + bytes) > STREAM_MEMORY_BUDGET) { continue; }
+            this->uploadLevel(candidate.second, tex, tex.residentLevel - 1);
+            uploaded += bytes;
+        }
+        this->frame++;
+    }
+    
+    inline size_t getResidentBytes() const { return this->residentBytes; }
+    
+private:
+    // Upload the small levels and register the texture
+    uint addTexture(StreamedTexture&& tex) {
+        const uint levels = tex.getLevelCount();
+        tex.minimumLevel = levels - 1;
+        while(tex.minimumLevel > 0 && glm::max(tex.getLevelSize(tex.minimumLevel - 1).x, tex.getLevelSize(tex.minimumLevel - 1).y) <= STREAM_MIN_RESIDENT_SIZE) {
+            tex.minimumLevel--;
+        }
+        tex.residentLevel = tex.requestedLevel = tex.minimumLevel;
+        tex.lastRequestFrame = this->frame;
+        // Upload the small levels directly
+        uint textureID = 0;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        for(uint level = tex.minimumLevel; level < levels; level++) {
+            specifyLevel(tex, level, tex.getLevelData(level));
+            this->residentBytes += tex.getLevelBytes(level);
+        }
+        if(tex.reload) {
+            for(uint level = 0; level < tex.minimumLevel; level++) { tex.mips.dropLevel(level); }
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, tex.residentLevel);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        if(ANISOTROPIC_FILTERING) {
+            GLfloat largest_supported_anisotropy;
+            glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &largest_supported_anisotropy);
+            glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, largest_supported_anisotropy);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        this->textures.insert(std::make_pair(textureID, std::move(tex)));
+        return textureID;
+    }
+    
+    void uploadLevel(uint textureID, StreamedTexture& tex, uint level) {
+        if(this->pixelBuffers[0] == 0) { glGenBuffers(STREAM_PBO_COUNT, this->pixelBuffers); }
+        const size_t bytes = tex.getLevelBytes(level);
+        // Orphan the next PBO of the ring and copy the level into it
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, this->pixelBuffers[this->nextPixelBuffer]);
+        this->nextPixelBuffer = (this->nextPixelBuffer + 1) % STREAM_PBO_COUNT;
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        void* mapping = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if(mapping != nullptr) {
+            std::memcpy(mapping, tex.getLevelData(level), bytes);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindTexture(GL_TEXTURE_2D, textureID);
+            specifyLevel(tex, level, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            tex.residentLevel = level;
+            this->residentBytes += bytes;
+            // Fine levels are decoded again if they are dropped and requested later
+            if(tex.reload && level < tex.minimumLevel) { tex.mips.dropLevel(level); }
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    
+    // Specify a level of the bound texture (data is an offset into the bound PBO, if there is one)
+    static void specifyLevel(const StreamedTexture& tex, uint level, const void* data) {
+        const glm::ivec2 size = tex.getLevelSize(level);
+        if(tex.compressed) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, blockGLFormat(tex.compressed->getFormat()), size.x, size.y, 0, (GLsizei)tex.getLevelBytes(level), data);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGB, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        }
+    }
+    
+    void startReload(StreamedTexture& tex) {
+        if(!tex.reload || tex.reloadFailed || tex.reloading.valid()) { return; }
+        if(this->workers == nullptr) { this->workers.reset(new ThreadPool(STREAM_DECODE_THREADS)); }
+        tex.reloading = this->workers->enqueue(tex.reload);
+    }
+    
+    // Keep the decoded levels that are still requested and not resident
+    void collectReload(StreamedTexture& tex) {
+        if(!tex.reloading.valid() || tex.reloading.wait_for(std::chrono::seconds(0)) != std::future_status::ready) { return; }
+        MipChain chain = tex.reloading.get();
+        if(chain.sizes != tex.mips.sizes) {
+            // The source file changed (or is gone), the texture keeps its current levels
+            std::cerr <<" ERROR: streamed texture source changed, fine levels not reloaded" <<std::endl;
+            tex.reloadFailed = true;
+            return;
+        }
+        for(uint level = tex.requestedLevel; level < tex.residentLevel; level++) {
+            if(!tex.mips.hasLevel(level)) { tex.mips.levels[level] = std::move(chain.levels[level]); }
+        }
+    }
+    
+    void dropLevel(uint textureID, StreamedTexture& tex) {
+        const uint level = tex.residentLevel;
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+        // Respecify the level as empty, so the driver can release its storage
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGB, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        tex.residentLevel = level + 1;
+        this->residentBytes -= tex.getLevelBytes(level);
+    }
+    
+    // Drop fine levels that are not needed while over the memory budget
+    // (most surplus levels first, then the least recently requested texture)
+    void evict() {
+        while(this->residentBytes > STREAM_MEMORY_BUDGET) {
+            uint victim = 0;
+            int bestSurplus = 0;
+            uint oldestFrame = 0;
+            for(auto& entry : this->textures) {
+                const StreamedTexture& tex = entry.second;
+                const int surplus = (int)tex.requestedLevel - (int)tex.residentLevel;
+                if(surplus > bestSurplus || (surplus == bestSurplus && surplus > 0 && tex.lastRequestFrame < oldestFrame)) {
+                    victim = entry.first;
+                    bestSurplus = surplus;
+                    oldestFrame = tex.lastRequestFrame;
+                }
+            }
+            if(victim == 0) { return; }
+            this->dropLevel(victim, this->textures[victim]);
+        }
+    }
+    
+};
+
+}
+
+#endif
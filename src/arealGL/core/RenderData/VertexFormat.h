@@ -0,0 +1,157 @@
+//  VertexFormat.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef VertexFormat_h
+#define VertexFormat_h
+
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "Types.h"
+#include "Config.h"
+
+#include <vec2.hpp>
+#include <vec3.hpp>
+#include <common.hpp>
+#include <gtc/packing.hpp>
+
+namespace arealGL {
+    
+// Full precision vertex, as imported and stored in the mesh cache (44 bytes)
+struct Vertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec3 tangent;
+    glm::vec2 texcoords;
+    
+    Vertex() {}
+    Vertex(const Vertex& rhs) = default;
+    Vertex(Vertex&& rhs) noexcept = default;
+    Vertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec2& texcoords)
+    : position(position), normal(normal), texcoords(texcoords) { }
+    Vertex(glm::vec3&& position, glm::vec3&& normal, glm::vec2&& texcoords) noexcept
+    : position(std::move(position)), normal(std::move(normal)), texcoords(std::move(texcoords)) { }
+};
+
+// Quantized vertex for the GPU (20 bytes):
+//  - position: 16 bit unorm relative to the mesh bounds (decoded with u_positionOffset / u_positionScale)
+//  - normal, tangent: octahedral encoding in 2 x 16 bit snorm
+//  - texcoords: half floats
+struct PackedVertex {
+    uint16_t position[4];           // xyz + padding (keeps the attributes 4 byte aligned)
+    int16_t normal[2];
+    int16_t tangent[2];
+    uint16_t texcoords[2];
+};
+
+enum class VertexFormat : uint32_t {
+    FLOAT = 0,
+    PACKED = 1
+};
+
+inline size_t vertexSize(VertexFormat format) { return (format == VertexFormat::PACKED ? sizeof(PackedVertex) : sizeof(Vertex)); }
+
+
+// Octahedral unit vector encoding (the vector is projected onto an octahedron, the lower half is folded over)
+inline glm::vec2 octEncode(const glm::vec3& v) {
+    const glm::vec3 n = v / std::max(std::abs(v.x) + std::abs(v.y) + std::abs(v.z), 1e-20f);
+    if(n.z >= 0.0f) { return glm::vec2(n.x, n.y); }
+    return glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                     (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+}
+
+inline glm::vec3 octDecode(const glm::vec2& e) {
+    glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+    const float t = std::max(-n.z, 0.0f);
+    n.x += (n.x >= 0.0f ? -t : t);
+    n.y += (n.y >= 0.0f ? -t : t);
+    return glm::normalize(n);
+}
+
+// Position dequantization: position = packed * scale + offset
+inline glm::vec3 packedPositionScale(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    return glm::max(boundsMax - boundsMin, glm::vec3(1e-20f));
+}
+
+inline PackedVertex packVertex(const Vertex& v, const glm::vec3& boundsMin, const glm::vec3& scale) {
+    PackedVertex p;
+    const glm::vec3 position = (v.position - boundsMin) / scale;
+    for(int i = 0; i < 3; i++) { p.position[i] = glm::packUnorm1x16(position[i]); }
+    p.position[3] = 0;
+    const glm::vec2 normal = octEncode(v.normal);
+    const glm::vec2 tangent = octEncode(v.tangent);
+    for(int i = 0; i < 2; i++) {
+        p.normal[i] = (int16_t)glm::packSnorm1x16(normal[i]);
+        p.tangent[i] = (int16_t)glm::packSnorm1x16(tangent[i]);
+        p.texcoords[i] = glm::packHalf1x16(v.texcoords[i]);
+    }
+    return p;
+}
+
+inline std::vector<PackedVertex> packVertices(const Vertex* vertices, size_t count, const glm::vec3& offset, const glm::vec3& scale) {
+    std::vector<PackedVertex> packed(count);
+    for(size_t i = 0; i < count; i++) { packed[i] = packVertex(vertices[i], offset, scale); }
+    return packed;
+}
+
+inline Vertex unpackVertex(const PackedVertex& p, const glm::vec3& offset, const glm::vec3& scale) {
+    Vertex v;
+    for(int i = 0; i < 3; i++) { v.position[i] = glm::unpackUnorm1x16(p.position[i]) * scale[i] + offset[i]; }
+    v.normal = octDecode(glm::vec2(glm::unpackSnorm1x16((uint16_t)p.normal[0]), glm::unpackSnorm1x16((uint16_t)p.normal[1])));
+    v.tangent = octDecode(glm::vec2(glm::unpackSnorm1x16((uint16_t)p.tangent[0]), glm::unpackSnorm1x16((uint16_t)p.tangent[1])));
+    v.texcoords = glm::vec2(glm::unpackHalf1x16(p.texcoords[0]), glm::unpackHalf1x16(p.texcoords[1]));
+    return v;
+}
+
+inline std::vector<Vertex> unpackVertices(const PackedVertex* packed, size_t count, const glm::vec3& offset, const glm::vec3& scale) {
+    std::vector<Vertex> vertices;
+    vertices.reserve(count);
+    for(size_t i = 0; i < count; i++) { vertices.push_back(unpackVertex(packed[i], offset, scale)); }
+    return vertices;
+}
+
+// Per mesh choice: pack unless the position quantization step would exceed VERTEX_PACK_MAX_ERROR
+// (model units) or texture coordinates leave +-VERTEX_PACK_MAX_UV (half floats lose precision)
+inline VertexFormat chooseVertexFormat(const std::vector<Vertex>& vertices, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    if(!VERTEX_PACKING || vertices.empty()) { return VertexFormat::FLOAT; }
+    const glm::vec3 step = (boundsMax - boundsMin) / 65535.0f;
+    if(std::max(step.x, std::max(step.y, step.z)) > VERTEX_PACK_MAX_ERROR) { return VertexFormat::FLOAT; }
+    for(const Vertex& v : vertices) {
+        if(std::abs(v.texcoords.x) > VERTEX_PACK_MAX_UV || std::abs(v.texcoords.y) > VERTEX_PACK_MAX_UV) { return VertexFormat::FLOAT; }
+    }
+    return VertexFormat::PACKED;
+}
+    
+}
+
+#endif
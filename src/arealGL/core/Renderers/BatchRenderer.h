@@ -55,28 +55,49 @@ public:
     }
     
     void render(const Camera& cam, const glm::mat4& projection) {
+        uint boundVAO = 0;
+        uint boundTexture = UINT_MAX;
+        const Shader* boundShader = nullptr;
         for(const auto& renderpair : this->renderables) {
-            auto shader = renderpair.first;
-            shader->bind();
             for(auto entity : renderpair.second) {
-                shader->setLightUniforms();
-                shader->setModelUniforms(entity->getTransformation(), cam.getView(), projection, entity->getColor());
+                const Shader* entityShader = nullptr;
                 for(const Mesh& mesh : *entity->model) {
-                    // Activate and bind all the textures
-                    mesh.texture.bindTexture();
-                    mesh.texture.bindNormalMap();
-                    entity->shader->setMaterialUniforms(mesh.texture.getMaterial().spectralReflectivity, mesh.texture.getMaterial().shineDamper);
-                    // Get the show on the road
-                    glBindVertexArray(mesh.getVAO());
-                    glDrawElements(GL_TRIANGLES, (int)mesh.indices.size(), GL_UNSIGNED_INT, nullptr);
-                    glBindVertexArray(0);
+                    if(this->textureStreamer) { this->textureStreamer->requestMesh(mesh, entity->getTransformation(), cam.getView(), projection); }
+                    // Cheapest variant of the shader for the mesh textures (model and light uniforms are per program)
+                    const Shader& shader = entity->shader->getVariant(shaderFeatures(mesh.getTexture()));
+                    if(&shader != entityShader) {
+                        if(&shader != boundShader) {
+                            boundShader = &shader;
+                            shader.bind();
+                        }
+                        shader.setLightUniforms();
+                        shader.setModelUniforms(entity->getTransformation(), cam.getView(), projection, entity->getColor());
+                        entityShader = &shader;
+                    }
+                    // Activate and bind all the textures (meshes in one atlas page share the diffuse)
+                    if(mesh.getTexture().getTextureID() != boundTexture) {
+                        boundTexture = mesh.getTexture().getTextureID();
+                        mesh.getTexture().bindTexture();
+                    }
+                    mesh.getTexture().bindNormalMap();
+                    shader.setMaterialUniforms(mesh.getTexture().getMaterial().spectralReflectivity, mesh.getTexture().getMaterial().shineDamper);
+                    shader.setTextureUniforms(mesh.getTexture().getDiffuseTransform());
+                    shader.setVertexUniforms(mesh.getPositionOffset(), mesh.getPositionScale(), (mesh.getVertexFormat() == VertexFormat::PACKED));
+                    // Get the show on the road (the meshes of a model usually share one VAO)
+                    if(mesh.getVAO() != boundVAO) {
+                        boundVAO = mesh.getVAO();
+                        glBindVertexArray(boundVAO);
+                    }
+                    glDrawElementsBaseVertex(GL_TRIANGLES, (int)mesh.getIndexCount(), mesh.getIndexType(), mesh.getIndexOffset(), mesh.getBaseVertex());
                     // Set everything back to defaults
-                    mesh.texture.unbindNormalMap();
-                    mesh.texture.unbindTexture();
+                    mesh.getTexture().unbindNormalMap();
                 }
             }
-            shader->unbind();
         }
+        if(boundShader != nullptr) { boundShader->unbind(); }
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, 0);
         renderables.clear();
     }
     
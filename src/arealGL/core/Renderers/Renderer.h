@@ -36,17 +36,25 @@
 #include <vector>
 #include <queue>
 #include <memory>
+#include <climits>
 
 #include "Renderable3D.h"
 #include "RenderQuad.h"
 #include "Camera.h"
 #include "FrameBuffer.h"
+#include "TextureStreamer.h"
 #include <mat4x4.hpp>
 
 namespace arealGL {
 
 class Renderer {
+protected:
+    TextureStreamer* textureStreamer = nullptr;
+    
 public:
+    // Report the on-screen texel density of rendered meshes to the streamer
+    inline void setTextureStreamer(TextureStreamer* streamer) { this->textureStreamer = streamer; }
+    
     virtual void submit(std::shared_ptr<Renderable3D> entity) = 0;
     
     virtual void render(const Camera& cam, const glm::mat4& projection) = 0;
@@ -32,41 +32,23 @@
 #ifndef BasicShader_h
 #define BasicShader_h
 
-#include "Shader.h"
+#include "ShaderFamily.h"
 
 namespace arealGL {
 
-class BasicShader : public Shader {
+// Unlit shader family: object color, times the diffuse texture if the mesh has one
+class BasicShader : public ShaderFamily {
 public:
-    BasicShader() : Shader(SHADER_BASEPATH + "basicShader.vert", SHADER_BASEPATH + "basicShader.frag", true) {
-        // Set the Attributes
-        setAttribute(0, "position");
-        setAttribute(1, "normal");
-        setAttribute(2, "tangent");
-        setAttribute(3, "texCoords");
-        // Textures
-        setUniform("texture_diffuse");
-        // Set the Uniforms
-        setUniform("u_transform");
-        setUniform("u_projection");
-        setUniform("u_view");
-        setUniform("u_objectColor");
-    }
-    
-    void setModelUniforms(const glm::mat4& transform, const glm::mat4& view, const glm::mat4& projection, const Color& color) const override {
-        uniformVec3("u_objectColor", color.getRGB());
-        uniformMat4("u_transform", transform);
-        uniformMat4("u_projection", projection);
-        uniformMat4("u_view", view);
-    }
+    BasicShader() : ShaderFamily(SHADER_BASEPATH + "basicShader.vert", SHADER_BASEPATH + "basicShader.frag",
+                                 SHADER_TEXTURE | SHADER_INSTANCING | SHADER_SKINNING) { }
     
-    void setMaterialUniforms(float spectralReflectivity, float shineDamper) const override {
-        // Only set the Texture samplers
-        uniformInt("texture_diffuse", 0);
+protected:
+    std::unique_ptr<Shader> createVariant(const std::string& vertex, const std::string& fragment, uint key) override {
+        return std::unique_ptr<Shader>(new ShaderVariant(vertex, fragment, key));
     }
     
 };
-    
+
 }
 
 #endif
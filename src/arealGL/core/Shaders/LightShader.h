@@ -32,70 +32,56 @@
 #ifndef LightShader_h
 #define LightShader_h
 
-#include "Shader.h"
+#include "ShaderFamily.h"
 
 namespace arealGL {
 
-class LightShader : public Shader {
+// Lit shader family (diffuse and specular point lights). The light count is part of the
+// variant key, so the light loop only runs for the lights there are (up to MAX_LIGHTS).
+class LightShader : public ShaderFamily {
 private:
     std::vector<Light> lights;
     
-public:
-    LightShader(const std::vector<Light>& lights) : Shader(SHADER_BASEPATH + "lightShader.vert", SHADER_BASEPATH + "lightShader.frag", true) {
-        this->lights = lights;
-        // Set the Attributes
-        setAttribute(0, "position");
-        setAttribute(1, "normal");
-        setAttribute(2, "tangent");
-        setAttribute(3, "texCoords");
-        // Textures
-        setUniform("texture_diffuse");
-        setUniform("normal_MAP");
-        // Set the Uniforms
-        setUniform("u_transform");
-        setUniform("u_projection");
-        setUniform("u_view");
-        setUniform("u_objectColor");
-        setUniform("u_spectralReflectivity");
-        setUniform("u_shineDamper");
-        for(int i = 0; i < MAX_LIGHTS; i++) {
-            setUniform("u_lightPosition[" + std::to_string(i) + "]");
-            setUniform("u_lightColor[" + std::to_string(i) + "]");
-            setUniform("u_intensity[" + std::to_string(i) + "]");
-            setUniform("u_attenuation[" + std::to_string(i) + "]");
+    class Variant : public ShaderVariant {
+    private:
+        const LightShader& family;
+        int lightCount;
+        
+    public:
+        Variant(const std::string& vertex, const std::string& fragment, uint key, const LightShader& family, int lightCount)
+        : ShaderVariant(vertex, fragment, key), family(family), lightCount(lightCount) {
+            setUniform("u_spectralReflectivity");
+            setUniform("u_shineDamper");
+            for(int i = 0; i < lightCount; i++) {
+                setUniform("u_lightPosition[" + std::to_string(i) + "]");
+                setUniform("u_lightColor[" + std::to_string(i) + "]");
+                setUniform("u_intensity[" + std::to_string(i) + "]");
+                setUniform("u_attenuation[" + std::to_string(i) + "]");
+            }
         }
-    }
-    
-    void setModelUniforms(const glm::mat4& transform, const glm::mat4& view, const glm::mat4& projection, const Color& color) const override {
-        uniformVec3("u_objectColor", color.getRGB());
-        uniformMat4("u_transform", transform);
-        uniformMat4("u_projection", projection);
-        uniformMat4("u_view", view);
-    }
-    
-    void setMaterialUniforms(float spectralReflectivity, float shineDamper) const override {
-        uniformFloat("u_spectralReflectivity", spectralReflectivity);
-        uniformFloat("u_shineDamper", shineDamper);
-        // Also set the Texture samplers
-        uniformInt("texture_diffuse", 0);
-        uniformInt("normal_MAP", 1);
-    }
-    
-    void setLightUniforms() const override {
-        for(int i = 0; i < MAX_LIGHTS; i++) {
-            if(i < lights.size()) {
+        
+        void setMaterialUniforms(float spectralReflectivity, float shineDamper) const override {
+            uniformFloat("u_spectralReflectivity", spectralReflectivity);
+            uniformFloat("u_shineDamper", shineDamper);
+            // Also set the Texture samplers
+            ShaderVariant::setMaterialUniforms(spectralReflectivity, shineDamper);
+        }
+        
+        void setLightUniforms() const override {
+            const std::vector<Light>& lights = this->family.lights;
+            for(int i = 0; i < this->lightCount && i < lights.size(); i++) {
                 uniformVec3("u_lightPosition[" + std::to_string(i) + "]", lights[i].getDirection());
                 uniformVec3("u_lightColor[" + std::to_string(i) + "]", lights[i].getColor().getRGB());
                 uniformFloat("u_intensity[" + std::to_string(i) + "]", lights[i].getIntensity());
                 uniformVec3("u_attenuation[" + std::to_string(i) + "]", lights[i].getAttenuation());
-            } else {
-                uniformVec3("u_lightPosition[" + std::to_string(i) + "]", glm::vec3(0.0f));
-                uniformVec3("u_lightColor[" + std::to_string(i) + "]", glm::vec3(0.0f));
-                uniformFloat("u_intensity[" + std::to_string(i) + "]", 1.0f);
-                uniformVec3("u_attenuation[" + std::to_string(i) + "]", glm::vec3(1.0f, 0.0f, 0.0f));
             }
         }
-    }
+    };
+    
+public:
+    LightShader(const std::vector<Light>& lights)
+    : ShaderFamily(SHADER_BASEPATH + "lightShader.vert", SHADER_BASEPATH + "lightShader.frag",
+                   SHADER_TEXTURE | SHADER_NORMAL_MAP | SHADER_INSTANCING | SHADER_SKINNING), lights(lights) { }
     
     inline void setLights(const std::vector<Light>& lights) { this->lights = lights; }
     inline void setLights(std::vector<Light>&& lights) noexcept { this->lights = std::move(lights); }
@@ -103,6 +89,21 @@ public:
     inline void addLight(const Light& light) { this->lights.push_back(light); }
     inline void addLight(Light&& light) noexcept { this->lights.push_back(light); }
     
+    inline const std::vector<Light>& getLights() const { return this->lights; }
+    
+protected:
+    inline int getLightCount() const { return std::min((int)this->lights.size(), MAX_LIGHTS); }
+    
+    uint variantKey(uint features) const override { return (features | ((uint)this->getLightCount() << 8)); }
+    
+    std::string variantDefines(uint key) const override {
+        return ShaderFamily::variantDefines(key) + "#define LIGHT_COUNT " + std::to_string(key >> 8) + "\n";
+    }
+    
+    std::unique_ptr<Shader> createVariant(const std::string& vertex, const std::string& fragment, uint key) override {
+        return std::unique_ptr<Shader>(new Variant(vertex, fragment, key, *this, (int)(key >> 8)));
+    }
+    
 };
 
 }
@@ -0,0 +1,187 @@
+//  ProgramCache.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef ProgramCache_h
+#define ProgramCache_h
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+#include <cstdint>
+
+#include "Hash.h"
+#include "MappedFile.h"
+#include "Types.h"
+#include "Config.h"
+
+namespace arealGL {
+
+// Linked program binaries on disk (glGetProgramBinary / glProgramBinary), one file per
+// source hash. A binary is only used if it was written by the same driver (vendor,
+// renderer and version string), else the program is compiled again and the file replaced.
+class ProgramCache {
+public:
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t sourceHash;
+        uint64_t driverHash;
+        uint32_t binaryFormat;
+        uint32_t binarySize;
+    };
+    
+    static const uint32_t MAGIC = 0x50474C41;      // "ALGP"
+    static const uint32_t VERSION = 1;
+    
+private:
+    std::string directory = SHADER_CACHE_PATH;
+    bool enabled = SHADER_BINARY_CACHE;
+    uint64_t driverHash = 0;
+    
+    ProgramCache() { }
+    
+public:
+    static ProgramCache& instance() {
+        static ProgramCache cache;
+        return cache;
+    }
+    
+    ProgramCache(const ProgramCache& rhs) = delete;
+    ProgramCache& operator=(const ProgramCache& rhs) = delete;
+    
+    inline void setDirectory(const std::string& dir) { this->directory = dir; }
+    inline void setEnabled(bool enable) { this->enabled = enable; }
+    inline const std::string& getDirectory() const { return this->directory; }
+    
+    // Hash of all stage sources of a program (the key of its binary)
+    static uint64_t hashSources(const std::vector<std::string>& sources) {
+        uint64_t hash = hashFNV1a(nullptr, 0);
+        for(const std::string& source : sources) {
+            hash = hashFNV1a(source, hash);
+            hash = hashFNV1a("\0", 1, hash);
+        }
+        return hash;
+    }
+    
+    // Create a program from its cached binary, 0 if there is none or the driver rejects it
+    uint load(uint64_t sourceHash) {
+        if(!this->isSupported()) { return 0; }
+        std::ifstream in(this->binaryPath(sourceHash), std::ios::binary);
+        if(!in) { return 0; }
+        Header head;
+        if(!in.read(reinterpret_cast<char*>(&head), sizeof(Header)) || head.magic != MAGIC || head.version != VERSION
+           || head.sourceHash != sourceHash || head.driverHash != this->getDriverHash()) {
+            return 0;
+        }
+        std::vector<char> binary(head.binarySize);
+        if(!in.read(binary.data(), binary.size())) { return 0; }
+        const uint programID = glCreateProgram();
+        glProgramBinary(programID, head.binaryFormat, binary.data(), (GLsizei)binary.size());
+        GLint linked = 0;
+        glGetProgramiv(programID, GL_LINK_STATUS, &linked);
+        if(!linked) {
+            glDeleteProgram(programID);
+            return 0;
+        }
+        return programID;
+    }
+    
+    // Call before linking, so the driver keeps the binary retrievable
+    void prepare(uint programID) const {
+        if(this->enabled) { glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE); }
+    }
+    
+    // Write the binary of a linked program (to a temporary file, renamed when complete)
+    bool store(uint programID, uint64_t sourceHash) {
+        if(!this->isSupported()) { return false; }
+        GLint size = 0;
+        glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &size);
+        if(size <= 0) { return false; }
+        std::vector<char> binary((size_t)size);
+        GLenum format = 0;
+        GLsizei length = 0;
+        glGetProgramBinary(programID, size, &length, &format, binary.data());
+        if(length <= 0) { return false; }
+        if(!createDirectories(this->directory)) {
+            std::cerr <<" ERROR: creating shader cache directory " <<this->directory <<std::endl;
+            return false;
+        }
+        Header head = { MAGIC, VERSION, sourceHash, this->getDriverHash(), (uint32_t)format, (uint32_t)length };
+        const std::string path = this->binaryPath(sourceHash);
+        const std::string tmpPath = path + ".tmp";
+        {
+            std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+            if(!out) {
+                std::cerr <<" ERROR: writing shader cache " <<path <<std::endl;
+                return false;
+            }
+            out.write(reinterpret_cast<const char*>(&head), sizeof(Header));
+            out.write(binary.data(), length);
+            if(!out) { std::remove(tmpPath.c_str()); return false; }
+        }
+        return (std::rename(tmpPath.c_str(), path.c_str()) == 0);
+    }
+    
+private:
+    // Drivers without a binary format (GL_NUM_PROGRAM_BINARY_FORMATS = 0) always compile
+    bool isSupported() const {
+        if(!this->enabled) { return false; }
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return (formats > 0);
+    }
+    
+    uint64_t getDriverHash() {
+        if(this->driverHash == 0) {
+            std::string driver;
+            for(GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+                const GLubyte* str = glGetString(name);
+                driver += (str != nullptr ? reinterpret_cast<const char*>(str) : "");
+                driver += '\n';
+            }
+            this->driverHash = hashFNV1a(driver);
+        }
+        return this->driverHash;
+    }
+    
+    std::string binaryPath(uint64_t sourceHash) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.glbin", (unsigned long long)sourceHash);
+        return this->directory + name;
+    }
+    
+};
+
+}
+
+#endif
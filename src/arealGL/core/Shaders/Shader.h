@@ -36,11 +36,13 @@
 #include <string>
 #include <vector>
 #include <sstream>
-#include <fstream>
 
 #include "Light.h"
 #include "Color.h"
 #include "Config.h"
+#include "Texture.h"
+#include "FileSystem.h"
+#include "ProgramCache.h"
 
 #include <vec2.hpp>
 #include <vec3.hpp>
@@ -49,6 +51,20 @@
 
 namespace arealGL {
 
+// Feature keys of a shader family (see ShaderFamily), each one a #define in the variant source
+enum ShaderFeature : uint {
+    SHADER_TEXTURE      = 1 << 0,       // diffuse texture (else only the object color)
+    SHADER_NORMAL_MAP   = 1 << 1,       // tangent space normal map
+    SHADER_INSTANCING   = 1 << 2,       // transforms from an InstanceBuffer instead of u_transform
+    SHADER_SKINNING     = 1 << 3        // bone indices / weights (SKIN_ATTRIB_LOCATION) and u_bones
+};
+
+// Features the textures of a mesh need
+inline uint shaderFeatures(const Texture& texture) {
+    return ((texture.getTextureID() != 0 ? (uint)SHADER_TEXTURE : 0) | (texture.getNormalMapID() != 0 ? (uint)SHADER_NORMAL_MAP : 0));
+}
+
+
 class Shader {
 public:
     uint programID;
@@ -60,13 +76,21 @@ public:
     
 public:
     Shader(const std::string& vertex, const std::string& fragment, bool isFile) {
-        // create the shaders (load a shader from file or pass the string directly)
-        uint vertexShader = createShader((isFile ? loadShader(vertex) : vertex), GL_VERTEX_SHADER);
-        uint fragmentShader = createShader((isFile ? loadShader(fragment) : fragment), GL_FRAGMENT_SHADER);
+        // load a shader from file or pass the string directly
+        const std::string vertexSource = (isFile ? loadShader(vertex) : vertex);
+        const std::string fragmentSource = (isFile ? loadShader(fragment) : fragment);
+        // A binary linked from the same sources by the same driver skips the compilation
+        const uint64_t sourceHash = ProgramCache::hashSources({ vertexSource, fragmentSource });
+        programID = ProgramCache::instance().load(sourceHash);
+        if(programID != 0) { return; }
+        // create the shaders
+        uint vertexShader = createShader(vertexSource, GL_VERTEX_SHADER);
+        uint fragmentShader = createShader(fragmentSource, GL_FRAGMENT_SHADER);
         // Set up the overall shader program
         programID = glCreateProgram();
         glAttachShader(programID, vertexShader);
         glAttachShader(programID, fragmentShader);
+        ProgramCache::instance().prepare(programID);
         // Link the program and check for errors
         glLinkProgram(programID);
         glValidateProgram(programID);
@@ -74,6 +98,8 @@ public:
         if (!success) {
             glGetProgramInfoLog(programID, 1024, NULL, infoLog);
             std::cout <<"ERROR: SHADER LINKING\n" <<infoLog <<std::endl;
+        } else {
+            ProgramCache::instance().store(programID, sourceHash);
         }
         // The attached Shaders can be cleaned up
         glDetachShader(programID, vertexShader);
@@ -82,6 +108,9 @@ public:
         glDeleteShader(fragmentShader);
     }
     
+    // The program to draw with for a set of features (a family returns one of its variants)
+    virtual Shader& getVariant(uint features) { return *this; }
+    
     // bind the shader to a program
     inline void bind() const { glUseProgram(programID); }
     inline void unbind() const { glUseProgram(0); }
@@ -89,10 +118,16 @@ public:
     virtual void setModelUniforms(const glm::mat4& transform, const glm::mat4& view, const glm::mat4& projection, const Color& color) const { }
     virtual void setMaterialUniforms(float spectralReflectivity, float shineDamper) const { }
     virtual void setLightUniforms() const { }
+    virtual void setVertexUniforms(const glm::vec3& positionOffset, const glm::vec3& positionScale, bool packedVertex) const { }
+    virtual void setTextureUniforms(const glm::vec4& diffuseTransform) const { }
+    virtual void setSkinUniforms(const glm::mat4* bones, size_t count) const { }
 
     virtual ~Shader() { glDeleteProgram(programID); }
     
 protected:
+    // Families only hold the sources, they have no program of their own
+    Shader() : programID(0), success(0) { }
+    
     void setAttribute(int index, const std::string name) {
         glBindAttribLocation(this->programID, index, name.c_str());
         this->attributes.insert(std::make_pair(name, index));
@@ -105,12 +140,22 @@ protected:
     
     // Apply basic uniform variables
     inline void uniformMat4(const std::string& name, const glm::mat4& mat) const { glUniformMatrix4fv(uniforms.at(name), 1, false, &mat[0][0]); }
+    inline void uniformMat4Array(const std::string& name, const glm::mat4* mat, size_t count) const { glUniformMatrix4fv(uniforms.at(name), (GLsizei)count, false, &mat[0][0][0]); }
     inline void uniformVec4(const std::string& name, const glm::vec4& vec) const { glUniform4fv(uniforms.at(name),1 , &vec[0] ); }
     inline void uniformVec3(const std::string& name, const glm::vec3& vec) const { glUniform3fv(uniforms.at(name),1 , &vec[0] ); }
     inline void uniformVec2(const std::string& name, const glm::vec2& vec) const { glUniform2fv(uniforms.at(name),1 , &vec[0] ); }
     inline void uniformFloat(const std::string& name, float val) const { glUniform1f(uniforms.at(name), val); }
     inline void uniformInt(const std::string& name, int val) const { glUniform1i(uniforms.at(name), val); }
     
+    // function to read a shader file (from the harddrive or a mounted pack)
+    static std::string loadShader(const std::string& filename) {
+        const FileData file = FileSystem::instance().read(filename);
+        if (!file.isOpen()) {
+            std::cerr << " Unable to read file " <<filename <<std::endl;
+            return "";
+        }
+        return std::string(reinterpret_cast<const char*>(file.getData()), file.getSize());
+    }
     
 private:
     // add an OpenGL shader from a file to the program
@@ -129,26 +174,6 @@ private:
         return shader;
     }
     
-    // function to read a shader file from harddrive
-    std::string loadShader(const std::string& filename) const {
-        std::string tmp = "";
-        std::fstream file;
-        file.open(filename, std::ifstream::in | std::ifstream::binary);
-        if (file.is_open()) {
-            try {
-                file.seekg(0, std::ios::end);
-                const size_t length = file.tellg();
-                tmp.reserve(length);
-                file.seekg(0, std::ios::beg);
-                tmp.assign((std::istreambuf_iterator<char>(file)),std::istreambuf_iterator<char>());
-            } catch (const std::ios_base::failure& e) {
-                std::cerr << " Unable to read file \n" <<e.what() <<std::endl;
-            }
-        }
-        file.close();;
-        return tmp;
-    }
-    
 };
     
 }
@@ -0,0 +1,162 @@
+//  ShaderFamily.h
+/*************************************************************************************
+ *  arealGL (OpenGL graphics library)                                                *
+ *-----------------------------------------------------------------------------------*
+ *  Copyright (c) 2015, Peter Baumann                                                *
+ *  All rights reserved.                                                             *
+ *                                                                                   *
+ *  Redistribution and use in source and binary forms, with or without               *
+ *  modification, are permitted provided that the following conditions are met:      *
+ *    1. Redistributions of source code must retain the above copyright              *
+ *       notice, this list of conditions and the following disclaimer.               *
+ *    2. Redistributions in binary form must reproduce the above copyright           *
+ *       notice, this list of conditions and the following disclaimer in the         *
+ *       documentation and/or other materials provided with the distribution.        *
+ *    3. Neither the name of the organization nor the                                *
+ *       names of its contributors may be used to endorse or promote products        *
+ *       derived from this software without specific prior written permission.       *
+ *                                                                                   *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND  *
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED    *
+ *  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE           *
+ *  DISCLAIMED. IN NO EVENT SHALL PETER BAUMANN BE LIABLE FOR ANY                    *
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES       *
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;     *
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND      *
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS    *
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                     *
+ *                                                                                   *
+ *************************************************************************************/
+
+#ifndef ShaderFamily_h
+#define ShaderFamily_h
+
+#include <map>
+#include <memory>
+#include <string>
+#include <algorithm>
+
+#include "Shader.h"
+
+namespace arealGL {
+
+// One GLSL source per stage for a whole family of shaders. Each combination of feature keys
+// (the variant key, families can add to it) is compiled on first use and kept, so a draw only
+// pays for what its material uses. The keys are #defines inserted after the #version line.
+class ShaderFamily : public Shader {
+private:
+    std::string vertexSource;
+    std::string fragmentSource;
+    uint supported;
+    std::map<uint, std::unique_ptr<Shader>> variants;
+    
+public:
+    ShaderFamily(const std::string& vertexFile, const std::string& fragmentFile, uint supportedFeatures)
+    : vertexSource(loadShader(vertexFile)), fragmentSource(loadShader(fragmentFile)), supported(supportedFeatures) { }
+    
+    // Features the family does not have are ignored
+    Shader& getVariant(uint features) override {
+        const uint key = this->variantKey(features & this->supported);
+        auto it = this->variants.find(key);
+        if(it == this->variants.end()) {
+            const std::string defines = this->variantDefines(key);
+            it = this->variants.insert(std::make_pair(key, this->createVariant(insertDefines(this->vertexSource, defines),
+                                                                               insertDefines(this->fragmentSource, defines), key))).first;
+        }
+        return *it->second;
+    }
+    
+    inline uint getSupportedFeatures() const { return this->supported; }
+    inline size_t getVariantCount() const { return this->variants.size(); }
+    
+protected:
+    // The feature bits are the low 8 bits of a key
+    virtual uint variantKey(uint features) const { return features; }
+    
+    virtual std::string variantDefines(uint key) const {
+        std::string defines;
+        if(key & SHADER_TEXTURE) { defines += "#define HAS_TEXTURE\n"; }
+        if(key & SHADER_NORMAL_MAP) { defines += "#define HAS_NORMAL_MAP\n"; }
+        if(key & SHADER_INSTANCING) {
+            defines += "#define INSTANCING\n";
+            for(int i = 0; i < 3; i++) { defines += "#define INSTANCE_LOCATION" + std::to_string(i) + " " + std::to_string(INSTANCE_ATTRIB_LOCATION + i) + "\n"; }
+        }
+        if(key & SHADER_SKINNING) {
+            defines += "#define SKINNING\n#define MAX_BONES " + std::to_string(MAX_BONES) + "\n";
+            defines += "#define BONE_INDEX_LOCATION " + std::to_string(SKIN_ATTRIB_LOCATION) + "\n";
+            defines += "#define BONE_WEIGHT_LOCATION " + std::to_string(SKIN_ATTRIB_LOCATION + 1) + "\n";
+        }
+        return defines;
+    }
+    
+    virtual std::unique_ptr<Shader> createVariant(const std::string& vertex, const std::string& fragment, uint key) = 0;
+    
+private:
+    static std::string insertDefines(const std::string& source, const std::string& defines) {
+        const size_t version = source.find("#version");
+        const size_t line = (version == std::string::npos ? std::string::npos : source.find('\n', version));
+        if(line == std::string::npos) { return defines + source; }
+        return source.substr(0, line + 1) + defines + source.substr(line + 1);
+    }
+    
+};
+
+
+// A compiled variant of a family, with the uniforms all families share
+// (uniforms a variant does not use have location -1, setting them does nothing)
+class ShaderVariant : public Shader {
+private:
+    uint key;
+    
+public:
+    ShaderVariant(const std::string& vertex, const std::string& fragment, uint key) : Shader(vertex, fragment, false), key(key) {
+        // Textures
+        setUniform("texture_diffuse");
+        setUniform("normal_MAP");
+        // Set the Uniforms
+        setUniform("u_transform");
+        setUniform("u_projection");
+        setUniform("u_view");
+        setUniform("u_positionOffset");
+        setUniform("u_positionScale");
+        setUniform("u_packedVertex");
+        setUniform("u_diffuseTransform");
+        setUniform("u_objectColor");
+        setUniform("u_bones");
+    }
+    
+    void setModelUniforms(const glm::mat4& transform, const glm::mat4& view, const glm::mat4& projection, const Color& color) const override {
+        uniformVec3("u_objectColor", color.getRGB());
+        uniformMat4("u_transform", transform);
+        uniformMat4("u_projection", projection);
+        uniformMat4("u_view", view);
+    }
+    
+    void setVertexUniforms(const glm::vec3& positionOffset, const glm::vec3& positionScale, bool packedVertex) const override {
+        uniformVec3("u_positionOffset", positionOffset);
+        uniformVec3("u_positionScale", positionScale);
+        uniformInt("u_packedVertex", packedVertex);
+    }
+    
+    void setTextureUniforms(const glm::vec4& diffuseTransform) const override {
+        uniformVec4("u_diffuseTransform", diffuseTransform);
+    }
+    
+    void setMaterialUniforms(float spectralReflectivity, float shineDamper) const override {
+        // Only set the Texture samplers
+        uniformInt("texture_diffuse", 0);
+        uniformInt("normal_MAP", 1);
+    }
+    
+    void setSkinUniforms(const glm::mat4* bones, size_t count) const override {
+        if(count > 0) { uniformMat4Array("u_bones", bones, std::min(count, (size_t)MAX_BONES)); }
+    }
+    
+    inline uint getKey() const { return this->key; }
+    
+};
+
+}
+
+#endif